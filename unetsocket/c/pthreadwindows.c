@@ -66,4 +66,15 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex) {
   return !ReleaseMutex(mutex->handle);
 }
 
+int pthread_once(pthread_once_t *once_control, void (*init_routine)(void)) {
+  // 0: not run, 1: running, 2: done
+  if (InterlockedCompareExchange(&once_control->state, 1, 0) == 0) {
+    init_routine();
+    InterlockedExchange(&once_control->state, 2);
+  } else {
+    while (InterlockedCompareExchange(&once_control->state, 2, 2) != 2) Sleep(0);
+  }
+  return 0;
+}
+
 #endif
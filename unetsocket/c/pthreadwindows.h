@@ -25,6 +25,12 @@ typedef struct pthread_mutexattr_tag {
 
 typedef DWORD pthread_key_t;
 
+typedef struct pthread_once_tag {
+  volatile LONG state;
+} pthread_once_t;
+
+#define PTHREAD_ONCE_INIT {0}
+
 int pthread_create(pthread_t *thread, const pthread_attr_t *attr, void
 		   *(*start_routine)(void *), void *arg);
 
@@ -42,6 +48,8 @@ int pthread_mutex_trylock(pthread_mutex_t *mutex);
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex);
 
+int pthread_once(pthread_once_t *once_control, void (*init_routine)(void));
+
 #else
 
 #include <pthread.h>
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Monitor ambient noise by logging the power spectral density of the
+// passband signal.
+//
+// One line is written per frame, with the frame time, sequence number, first
+// bin frequency, bin spacing and the level of each bin in dB.
+//
+// In terminal window (an example):
+//
+// $ make samples
+// $ ./noisemon <ip_address> <file> <seconds> [frame] [nfft] [port]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include "../unet.h"
+#include "../unet_ext.h"
+#include "../unet_stream.h"
+#include "../unet_psd.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+#endif
+
+static FILE *fp;
+static unet_psd_t psd = NULL;
+static double frame = 1;
+static int nfft = 1024;
+static double duration;
+static double recorded = 0;
+
+static int error(const char *msg) {
+  printf("\n*** ERROR: %s\n\n", msg);
+  return -1;
+}
+
+static int monitor(void *ctx, const unet_block_t *blk) {
+  (void)ctx;
+  if (psd == NULL) {
+    // segments overlap by half, so a frame of t seconds averages 2 t fs / nfft of them
+    int navg = (int)(2 * frame * blk->fs / nfft);
+    psd = unet_psd_create(blk->fs, 0, nfft, SIGGEN_HANN, 0.5f, navg > 0 ? navg : 1, unet_psd_log, fp);
+    if (psd == NULL) return 1;
+  }
+  int rv = unet_psd_block(psd, blk);
+  if (rv != 0) return rv;
+  recorded += (double)blk->nsamples / blk->fs;
+  return recorded >= duration ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  unetsocket_t sock;
+  int port = 1100;
+  if (argc <= 3) {
+    return error("Usage : noisemon <ip_address> <file> <seconds> [frame] [nfft] [port] \n"
+      "ip_address: IP address of the modem. \n"
+      "file: file to log spectral frames to. \n"
+      "seconds: duration of the monitoring. \n"
+      "frame: seconds averaged per frame (default 1). \n"
+      "nfft: FFT size, a power of 2 (default 1024). \n"
+      "port: port number of the modem. \n"
+      "A usage example: \n"
+      "noisemon 192.168.1.20 noise.csv 3600 10 1024 1100\n");
+  } else {
+    duration = strtod(argv[3], NULL);
+    if (argc > 4) frame = strtod(argv[4], NULL);
+    if (argc > 5) nfft = (int)strtol(argv[5], NULL, 10);
+    if (argc > 6) port = (int)strtol(argv[6], NULL, 10);
+  }
+
+#ifndef _WIN32
+  // Check valid ip address
+  struct hostent *server = gethostbyname(argv[1]);
+  if (server == NULL) return error("Enter a valid ip addreess\n");
+#endif
+
+  fp = fopen(argv[2], "w");
+  if (fp == NULL) return error("Couldn't open output file");
+
+  sock = unetsocket_open(argv[1], port);
+  if (sock == NULL) {
+    fclose(fp);
+    return error("Couldn't open unet socket");
+  }
+
+  int rv = unetsocket_ext_pbstream(sock, PBSBLK, monitor, NULL);
+
+  unet_psd_destroy(psd);
+  unetsocket_close(sock);
+  fclose(fp);
+  if (rv < 0 || psd == NULL) return error("Monitoring failed");
+  printf("Monitored %.1f seconds to %s\n", recorded, argv[2]);
+  return 0;
+}
@@ -13,7 +13,7 @@
 #include <stdlib.h>
 #include "../unet.h"
 #include "../unet_ext.h"
-#include <math.h>
+#include "../unet_siggen.h"
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -21,10 +21,6 @@
 #include <sys/time.h>
 #endif
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
 static int error(const char *msg) {
   printf("\n*** ERROR: %s\n\n", msg);
   return -1;
@@ -87,9 +83,7 @@ int main(int argc, char *argv[]) {
   }
 
   // create the signal
-  for(int i = 0; i < siglen; i++) {
-    signal[i] = (float)sin(frequency * (2 * M_PI * i) / txsamplingfreq);
-  }
+  unet_siggen_cw(signal, siglen, (float)frequency, txsamplingfreq, 0);
 
   // Transmit signal
   printf("Transmitting a CW\n");
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Continuously record a passband signal to a file.
+//
+// Samples are written as raw 32-bit floats. Recording runs on a separate
+// thread and hands blocks over through a lock-free block ring, so slow disk
+// writes do not hold up the capture.
+//
+// In terminal window (an example):
+//
+// $ make samples
+// $ ./pbstream <ip_address> <file> <seconds> [port]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include "../unet.h"
+#include "../unet_ext.h"
+#include "../unet_stream.h"
+#include "../pthreadwindows.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+#endif
+
+#define NBLOCKS 16
+
+static unetsocket_t sock;
+static unet_ring_t ring;
+static int capture_rv = -1;
+
+static int error(const char *msg) {
+  printf("\n*** ERROR: %s\n\n", msg);
+  return -1;
+}
+
+static void *capture(void *arg) {
+  (void)arg;
+  capture_rv = unetsocket_ext_pbstream_ring(sock, PBSBLK, ring);
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  int port = 1100;
+  double duration;
+  if (argc <= 3) {
+    return error("Usage : pbstream <ip_address> <file> <seconds> [port] \n"
+      "ip_address: IP address of the modem. \n"
+      "file: file to write raw 32-bit float samples to. \n"
+      "seconds: duration of the recording. \n"
+      "port: port number of the modem. \n"
+      "A usage example: \n"
+      "pbstream 192.168.1.20 passband.raw 3600 1100\n");
+  } else {
+    duration = strtod(argv[3], NULL);
+    if (argc > 4) port = (int)strtol(argv[4], NULL, 10);
+  }
+
+#ifndef _WIN32
+  // Check valid ip address
+  struct hostent *server = gethostbyname(argv[1]);
+  if (server == NULL) return error("Enter a valid ip addreess\n");
+#endif
+
+  FILE *fp = fopen(argv[2], "wb");
+  if (fp == NULL) return error("Couldn't open output file");
+
+  sock = unetsocket_open(argv[1], port);
+  if (sock == NULL) {
+    fclose(fp);
+    return error("Couldn't open unet socket");
+  }
+
+  ring = unet_ring_create(NBLOCKS, PBSBLK);
+  if (ring == NULL) return error("Couldn't allocate block ring");
+  pthread_t tid;
+  pthread_create(&tid, NULL, capture, NULL);
+
+  // Write blocks as they arrive, until enough samples have been recorded
+  double recorded = 0;
+  unsigned long long next = 0;
+  while (true) {
+    unet_block_t *blk = unet_ring_peek(ring);
+    if (blk == NULL) {
+      if (unet_ring_is_closed(ring)) break;
+      Sleep(10);
+      continue;
+    }
+    if (blk->seq != next) printf("Dropped %llu blocks\n", blk->seq - next);
+    if (blk->gap != 0) printf("Gap of %lld samples at block %llu\n", blk->gap, blk->seq);
+    next = blk->seq + 1;
+    fwrite(blk->signal, sizeof(float), (size_t)blk->nsamples, fp);
+    if (blk->fs > 0) recorded += (double)blk->nsamples / blk->fs;
+    unet_ring_release(ring);
+    if (recorded >= duration) unet_ring_close(ring);
+  }
+  pthread_join(tid, NULL);
+
+  unet_ring_destroy(ring);
+  unetsocket_close(sock);
+  fclose(fp);
+  if (capture_rv < 0) return error("Recording failed");
+  printf("Recorded %.1f seconds to %s\n", recorded, argv[2]);
+  return 0;
+}
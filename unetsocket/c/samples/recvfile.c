@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Receive a file transferred by sendfile.
+//
+// In terminal window (an example):
+//
+// $ make samples
+// $ ./recvfile <ip_address> <filename> [port]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../unet.h"
+#include "../unet_xfer.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+#endif
+
+static int error(const char *msg) {
+  printf("\n*** ERROR: %s\n\n", msg);
+  return -1;
+}
+
+int main(int argc, char *argv[]) {
+  unetsocket_t sock;
+  unet_xfer_rx_t rx;
+  unsigned long long size = 0;
+  unsigned long long received = 0;
+  int port = 1100;
+  int rv;
+  if (argc <= 2) {
+    error("Usage : recvfile <ip_address> <filename> [port] \n"
+      "ip_address: IP address of the receiver modem. \n"
+      "filename: File to write, an incomplete transfer is resumed. \n"
+      "port: port number of receiver modem. \n"
+      "A usage example: \n"
+      "recvfile 192.168.1.10 log.txt 1100\n");
+    return -1;
+  } else {
+    if (argc > 3) port = (int)strtol(argv[3], NULL, 10);
+  }
+
+#ifndef _WIN32
+// Check valid ip address
+  struct hostent *server = gethostbyname(argv[1]);
+  if (server == NULL) {
+    error("Enter a valid ip addreess\n");
+    return -1;
+  }
+#endif
+
+// Open a unet socket connection to modem
+  printf("Connecting to %s:%d\n",argv[1],port);
+  sock = unetsocket_open(argv[1], port);
+  if (sock == NULL) return error("Couldn't open unet socket");
+
+  rx = unet_xfer_rx_open_file(argv[2]);
+  if (rx == NULL) {
+    unetsocket_close(sock);
+    return error("Couldn't open file");
+  }
+
+// Receive the file
+  printf("Waiting for a transfer\n");
+  rv = unetsocket_xfer_receive(sock, rx, USER, 120000);
+  unet_xfer_rx_status(rx, NULL, &size, &received);
+  unet_xfer_rx_close(rx);
+  unetsocket_close(sock);
+  if (rv != 0) {
+    printf("Received %llu of %llu bytes\n", received, size);
+    return error("Transfer incomplete, rerun to resume");
+  }
+
+  printf("Received %llu bytes to %s\n", size, argv[2]);
+
+  return 0;
+}
@@ -2,6 +2,9 @@
 //
 // Record the received data to a WAV file
 //
+// The WAV file is preallocated and memory-mapped, and blocks are written to it
+// as they arrive, so long recordings do not need to fit in memory.
+//
 // In terminal window (an example):
 //
 // $ make samples
@@ -13,14 +16,8 @@
 #include <stdlib.h>
 #include "../unet.h"
 #include "../unet_ext.h"
-
-#define DR_WAV_IMPLEMENTATION
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wimplicit-int-conversion"
-#pragma GCC diagnostic ignored "-Wformat"
-#pragma GCC diagnostic ignored "-Wsign-conversion"
-#include "dr_wav.h"
-#pragma GCC diagnostic pop
+#include "../unet_stream.h"
+#include "../unet_sink.h"
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -72,28 +69,15 @@ int main(int argc, char *argv[]) {
 
   printf("UnetStack [%s:%d] : bb.adcrate=%d \n", ipaddr, port, (int)rxsamplingfreq);
 
-  int nsamples = (int)(length * rxsamplingfreq);
-  float* buf = malloc((unsigned long)nsamples*sizeof(float));
-  printf("Recording %d samples [%fs] to %s \n", nsamples, length, fname);
+  unsigned long long nsamples = (unsigned long long)(length * rxsamplingfreq);
+  printf("Recording %llu samples [%fs] to %s \n", nsamples, length, fname);
 
-  rv = unetsocket_ext_pbrecord(sock, buf, nsamples);
-  if (rv == 0) {
-    int16_t* pSamples = malloc((unsigned long)nsamples*sizeof(int16_t));
-    for (int i = 0; i < nsamples; i++) pSamples[i] = (int16_t)(buf[i] * 32767);
-    drwav wav;
-    drwav_data_format format;
-    format.container = drwav_container_riff;     // <-- drwav_container_riff = normal WAV files, drwav_container_w64 = Sony Wave64.
-    format.format = DR_WAVE_FORMAT_PCM;          // <-- Any of the DR_WAVE_FORMAT_* codes.
-    format.channels = 1;
-    format.sampleRate = (unsigned int)rxsamplingfreq;
-    format.bitsPerSample = 16;
-    printf("Writing to file [%s]\n", fname);
-    drwav_init_file_write(&wav, fname, &format, NULL);
-    drwav_uint64 framesWritten = drwav_write_pcm_frames(&wav, (drwav_uint64) nsamples, pSamples);
-    printf("Created WAV file [%s] with %d samples\n", fname, (int)framesWritten);
-    drwav_uninit(&wav);
-  } else {
-    free(buf);
-    return error("Error recording signal");
-  }
+  unet_sink_t sink = unet_sink_mmap(fname, SINK_WAV16, rxsamplingfreq, 1, nsamples);
+  if (sink == NULL) return error("Couldn't create WAV file");
+  rv = unetsocket_ext_pbstream(sock, 0, unet_sink_block, sink);
+  if (unet_sink_close(sink) < 0) rv = -1;
+  unetsocket_close(sock);
+  if (rv < 0) return error("Error recording signal");
+  printf("Created WAV file [%s] with %llu samples\n", fname, nsamples);
+  return 0;
 }
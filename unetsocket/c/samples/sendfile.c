@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Transfer a file to another node using a selective-repeat ARQ.
+//
+// In terminal window (an example):
+//
+// $ make samples
+// $ ./sendfile <ip_address> <rx_node_address> <filename> [id] [port]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../unet.h"
+#include "../unet_xfer.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+#endif
+
+static int error(const char *msg) {
+  printf("\n*** ERROR: %s\n\n", msg);
+  return -1;
+}
+
+int main(int argc, char *argv[]) {
+  unetsocket_t sock;
+  int address = 0;
+  int port = 1100;
+  uint32_t id = 1;
+  int rv;
+  if (argc <= 3) {
+    error("Usage : sendfile <ip_address> <rx_node_address> <filename> [id] [port] \n"
+      "ip_address: IP address of the transmitter modem. \n"
+      "rx_node_address: Node address of the receiver modem. \n"
+      "filename: File to transfer. \n"
+      "id: Transfer identifier, reuse to resume an interrupted transfer. \n"
+      "port: port number of transmitter modem. \n"
+      "A usage example: \n"
+      "sendfile 192.168.1.20 5 log.txt 1 1100\n");
+    return -1;
+  } else {
+    address = (int)strtol(argv[2], NULL, 10);
+    if (argc > 4) id = (uint32_t)strtoul(argv[4], NULL, 10);
+    if (argc > 5) port = (int)strtol(argv[5], NULL, 10);
+  }
+
+#ifndef _WIN32
+// Check valid ip address
+  struct hostent *server = gethostbyname(argv[1]);
+  if (server == NULL) {
+    error("Enter a valid ip addreess\n");
+    return -1;
+  }
+#endif
+
+// Open a unet socket connection to modem
+  printf("Connecting to %s:%d\n",argv[1],port);
+  sock = unetsocket_open(argv[1], port);
+  if (sock == NULL) return error("Couldn't open unet socket");
+
+// Transfer the file
+  printf("Transferring %s to %d\n", argv[3], address);
+  rv = unetsocket_xfer_send_file(sock, address, USER, id, argv[3], 120000);
+  if (rv != 0) {
+    unetsocket_close(sock);
+    return error("Transfer incomplete, rerun with the same id to resume");
+  }
+
+// Close the unet socket
+  unetsocket_close(sock);
+
+  printf("Transfer Complete\n");
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Range a transponder that replies to a tone with another tone, such as an
+// Applied Acoustics 219A, by pinging it at a fixed interval.
+//
+// One line is printed per ping, with the ping time, the range and the SNR of
+// the reply.
+//
+// In terminal window (an example):
+//
+// $ make samples
+// $ ./transponder <ip_address> <ping_hz> <reply_hz> <turnaround_ms> <count> [interval_ms] [port]
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include "../unet.h"
+#include "../unet_ext.h"
+#include "../unet_siggen.h"
+#include "../unet_ranger.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+#endif
+
+#define TONE_LEN                 0.005f   // ping and reply duration (s)
+
+static int count;
+
+static int error(const char *msg) {
+  printf("\n*** ERROR: %s\n\n", msg);
+  return -1;
+}
+
+static int show(void *ctx, const unet_range_fix_t *fix) {
+  (void)ctx;
+  if (fix->range[0] < 0) printf("%lld: no reply\n", fix->txtime);
+  else printf("%lld: %.2f m (%.1f dB)\n", fix->txtime, fix->range[0], fix->snr[0]);
+  return --count > 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  unetsocket_t sock;
+  int port = 1100;
+  int interval = 2000;
+  float pingfreq, replyfreq, turnaround;
+  float dacrate, adcrate;
+  if (argc <= 5) {
+    return error("Usage : transponder <ip_address> <ping_hz> <reply_hz> <turnaround_ms> <count> [interval_ms] [port] \n"
+      "ip_address: IP address of the modem. \n"
+      "ping_hz: frequency of the tone that triggers the transponder. \n"
+      "reply_hz: frequency of the transponder's reply. \n"
+      "turnaround_ms: delay of the transponder's reply. \n"
+      "count: number of pings. \n"
+      "interval_ms: time between pings (default 2000). \n"
+      "port: port number of the modem. \n"
+      "A usage example: \n"
+      "transponder 192.168.1.20 22000 30500 30 10 2000 1100\n");
+  } else {
+    pingfreq = strtof(argv[2], NULL);
+    replyfreq = strtof(argv[3], NULL);
+    turnaround = strtof(argv[4], NULL) / 1000;
+    count = (int)strtol(argv[5], NULL, 10);
+    if (argc > 6) interval = (int)strtol(argv[6], NULL, 10);
+    if (argc > 7) port = (int)strtol(argv[7], NULL, 10);
+  }
+
+#ifndef _WIN32
+  // Check valid ip address
+  struct hostent *server = gethostbyname(argv[1]);
+  if (server == NULL) return error("Enter a valid ip addreess\n");
+#endif
+
+  sock = unetsocket_open(argv[1], port);
+  if (sock == NULL) return error("Couldn't open unet socket");
+  if (unetsocket_ext_fget(sock, 0, "org.arl.unet.Services.BASEBAND", "dacrate", &dacrate) < 0 ||
+      unetsocket_ext_fget(sock, 0, "org.arl.unet.Services.BASEBAND", "adcrate", &adcrate) < 0) {
+    unetsocket_close(sock);
+    return error("Couldn't get bb.dacrate and bb.adcrate");
+  }
+
+  // replies are expected from up to the range sound covers within the interval
+  int npings = (int)(TONE_LEN * dacrate);
+  int nreply = (int)(TONE_LEN * adcrate);
+  float maxrange = RANGER_SOUNDSPEED * ((float)interval / 1000 - turnaround - TONE_LEN) / 2;
+  float *ping = malloc(sizeof(float) * (size_t)npings);
+  float *reply = malloc(sizeof(float) * (size_t)nreply);
+  unet_ranger_t rng = NULL;
+  if (ping != NULL && reply != NULL && maxrange > 0) {
+    unet_siggen_cw(ping, npings, pingfreq, dacrate, 0);
+    unet_siggen_cw(reply, nreply, replyfreq, adcrate, 0);
+    rng = unet_ranger_create(adcrate, nreply, maxrange, show, NULL);
+  }
+  int rv = -1;
+  if (rng != NULL && unet_ranger_add(rng, reply, nreply, turnaround) == 0) {
+    rv = unetsocket_ext_pbrange(sock, 0, rng, ping, npings, interval);
+  }
+
+  unet_ranger_destroy(rng);
+  free(ping);
+  free(reply);
+  unetsocket_close(sock);
+  if (rv < 0) return error("Ranging failed");
+  return 0;
+}
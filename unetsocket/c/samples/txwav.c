@@ -11,17 +11,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include "../unet.h"
 #include "../unet_ext.h"
-
-#define DR_WAV_IMPLEMENTATION
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wimplicit-int-conversion"
-#pragma GCC diagnostic ignored "-Wformat"
-#pragma GCC diagnostic ignored "-Wsign-conversion"
-#include "dr_wav.h"
-#pragma GCC diagnostic pop
-
+#include "../unet_stream.h"
+#include "../unet_wav.h"
+#include "../unet_resample.h"
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -58,45 +53,64 @@ int main(int argc, char *argv[]) {
   if (fp == NULL) return error("File does not exist\n");
   fclose(fp);
 
-  unsigned int channels;
-  unsigned int sampleRate;
-  drwav_uint64 totalPCMFrameCount;
-  float* pSampleData = drwav_open_file_and_read_pcm_frames_f32(fname, &channels, &sampleRate, &totalPCMFrameCount, NULL);
-  if (pSampleData == NULL) {
-    return error("Error opening and reading wav file\n");
-  }
+  unet_wav_t wav = unet_wav_open(fname);
+  if (wav == NULL) return error("Error opening wav file\n");
 
-  printf("Wav file [%s] : fs=%d, nchannels=%d, nsamples=%llu\n", fname, sampleRate, channels, totalPCMFrameCount);
+  unsigned long long nframes = unet_wav_frames(wav);
+  printf("Wav file [%s] : fs=%d, nchannels=%d, nsamples=%llu\n", fname, (int)unet_wav_rate(wav), unet_wav_channels(wav), nframes);
 
-  if (channels != 1) return error("Only mono wav files are supported\n");
+  if (unet_wav_channels(wav) != 1) {
+    unet_wav_close(wav);
+    return error("Only mono wav files are supported\n");
+  }
 
   #ifndef _WIN32
   // Check valid ip address
     struct hostent *server = gethostbyname(ipaddr);
-    if (server == NULL) return error("Enter a valid ip addreess\n");
+    if (server == NULL) {
+      unet_wav_close(wav);
+      return error("Enter a valid ip addreess\n");
+    }
   #endif
 
   sock = unetsocket_open(ipaddr, port);
-  if (sock == NULL) return error("Couldn't open unet socket");
+  if (sock == NULL) {
+    unet_wav_close(wav);
+    return error("Couldn't open unet socket");
+  }
 
   // Get bb.dacrate parameter
   float txsamplingfreq = 0;
   if (unetsocket_ext_fget(sock, -1, "org.arl.unet.Services.BASEBAND", "dacrate", &txsamplingfreq) < 0) {
+    unet_wav_close(wav);
+    unetsocket_close(sock);
     return error("Failed to get dacrate parameter \n");
   }
 
   printf("UnetStack [%s:%d] : bb.dacrate=%d \n", ipaddr, port, (int)txsamplingfreq);
 
-  if ((unsigned int)txsamplingfreq != sampleRate) printf("Wavfile samplerate and bb.dacrate must match! %d vs %d \n", (int)txsamplingfreq, sampleRate);
-
-  rv = unetsocket_ext_tx_signal(sock, pSampleData, (int)totalPCMFrameCount, 0, NULL);
+  // stream the file in blocks, so long recordings need not fit in memory,
+  // converting it to bb.dacrate on the way if needed
+  if (lroundf(txsamplingfreq) != lroundf(unet_wav_rate(wav))) {
+    unet_resample_t rs = unet_resample_create(unet_wav_rate(wav), txsamplingfreq);
+    if (rs == NULL || unet_resample_set_source(rs, unet_wav_source, wav) < 0) {
+      unet_resample_destroy(rs);
+      unet_wav_close(wav);
+      unetsocket_close(sock);
+      return error("Can't resample wav file to bb.dacrate\n");
+    }
+    printf("Resampling from %d Hz to %d Hz\n", (int)unet_wav_rate(wav), (int)txsamplingfreq);
+    rv = unetsocket_ext_tx_stream(sock, 0, unet_resample_source, rs, 0);
+    unet_resample_destroy(rs);
+  } else {
+    rv = unetsocket_ext_tx_stream(sock, 0, unet_wav_source, wav, 0);
+  }
+  unet_wav_close(wav);
+  unetsocket_close(sock);
   if (rv == 0) {
-    printf("Transmitted %llu samples\n", totalPCMFrameCount);
+    printf("Transmitted %llu samples\n", nframes);
     return 0;
   } else {
     return error("Failed to transmit signal\n");
   }
-
-  drwav_free(pSampleData, NULL);
-  unetsocket_close(sock);
 }
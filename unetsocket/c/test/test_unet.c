@@ -8,7 +8,8 @@
 //
 // 2. Make sure a ethernet connection to one of the modem is available
 //
-// 3. Run the tests as following:
+// 3. Run the tests as following (tests that need no modem run first, and
+//    also run without arguments):
 //
 // In terminal window (an example):
 //
@@ -26,12 +27,35 @@
 // https://unetstack.net/handbook/unet-handbook_getting_started.html
 ////////////////////////////////////////////////////////////////////////////////
 
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "../unet.h"
 #include "../unet_ext.h"
+#include "../unet_xfer.h"
+#include "../unet_stream.h"
+#include "../unet_conv.h"
+#include "../unet_wav.h"
+#include "../unet_sink.h"
+#include "../unet_trigger.h"
+#include "../unet_resample.h"
+#include "../unet_ddc.h"
+#include "../unet_siggen.h"
+#include "../unet_corr.h"
+#include "../unet_psd.h"
+#include "../unet_sound.h"
+#include "../unet_ranger.h"
+#include "../unet_locate.h"
+#include "../unet_track.h"
+#include "../unet_nbr.h"
+#include "../unet_clock.h"
+#include "../unet_txtime.h"
+#include "../unet_tdma.h"
+#include "../unet_ranging.h"
+#include "../unet_time.h"
+#include "../pthreadwindows.h"
 #ifndef _WIN32
 #include <netdb.h>
 #include <sys/time.h>
@@ -59,8 +83,559 @@ static int error(const char* msg) {
   return -1;
 }
 
+static uint8_t xfer_buf[10000];
+static unetsocket_t xfer_sock;
+static int xfer_rv = -1;
+static long xfer_timeout = 120000;
+
+static int xfer_write(void *ctx, unsigned long long offset, const uint8_t *buf, int len) {
+  (void)ctx;
+  memcpy(xfer_buf + offset, buf, (size_t)len);
+  return 0;
+}
+
+static void *xfer_receiver(void *arg) {
+  (void)arg;
+  unet_xfer_rx_t rx = unet_xfer_rx_open(xfer_write, NULL);
+  xfer_rv = unetsocket_xfer_receive(xfer_sock, rx, USER, xfer_timeout);
+  unet_xfer_rx_close(rx);
+  return NULL;
+}
+
+static int stream_blocks = 0;
+static bool stream_late = false;
+
+// four silent blocks, the third of which comes too late to play if stream_late is set
+static int stream_source(void *ctx, float *buf, int nsamples) {
+  (void)ctx;
+  if (stream_blocks == 4) return 0;
+  if (++stream_blocks == 3 && stream_late) Sleep(2 * TIMEOUT);
+  memset(buf, 0, sizeof(float) * (size_t)nsamples);
+  return nsamples;
+}
+
+static long long corr_sample[2];
+static float corr_peak[2];
+static int corr_count = 0;
+
+static int corr_detect(void *ctx, const unet_detection_t *det) {
+  (void)ctx;
+  if (corr_count < 2) {
+    corr_sample[corr_count] = det->sample;
+    corr_peak[corr_count] = det->peak;
+  }
+  corr_count++;
+  return 0;
+}
+
+static long long trigger_rxtime[2];
+static int trigger_len[2];
+static float trigger_peak[2];
+static int trigger_count = 0;
+
+static int trigger_clip(void *ctx, const unet_block_t *clip) {
+  (void)ctx;
+  if (trigger_count < 2 && clip->seq == (unsigned long long)trigger_count) {
+    trigger_rxtime[trigger_count] = clip->rxtime;
+    trigger_len[trigger_count] = clip->nsamples;
+    trigger_peak[trigger_count] = 0;
+    for (int i = 0; i < clip->nsamples; i++) if (fabsf(clip->signal[i]) > trigger_peak[trigger_count]) trigger_peak[trigger_count] = fabsf(clip->signal[i]);
+  }
+  trigger_count++;
+  return 0;
+}
+
+static float psd_peak = 0;
+
+static int psd_frame(void *ctx, const unet_psd_frame_t *frame) {
+  (void)ctx;
+  int k = 0;
+  for (int i = 1; i < frame->nbins; i++) if (frame->level[i] > frame->level[k]) k = i;
+  psd_peak = frame->f0 + (float)k * frame->df;
+  return 0;
+}
+
+static float ranger_range = -1;
+
+static int ranger_fix(void *ctx, const unet_range_fix_t *fix) {
+  (void)ctx;
+  ranger_range = fix->range[0];
+  return 0;
+}
+
+// tests that need no modem
+static void test_offline(void) {
+  int rv;
+  test_assert("unet_crc32", unet_crc32(0, (const uint8_t*)"123456789", 9) == 0xCBF43926);
+  // block ring
+  unet_ring_t ring = unet_ring_create(2, 4);
+  unet_block_t *blk;
+  for (unsigned long long i = 0; i < 2; i++) {
+    blk = unet_ring_reserve(ring);
+    if (blk != NULL) {
+      blk->seq = i;
+      unet_ring_commit(ring);
+    }
+  }
+  test_assert("unet_ring_reserve", unet_ring_reserve(ring) == NULL);
+  blk = unet_ring_peek(ring);
+  test_assert("unet_ring_peek", blk != NULL && blk->seq == 0);
+  unet_ring_release(ring);
+  test_assert("unet_ring_release", unet_ring_reserve(ring) != NULL);
+  unet_ring_close(ring);
+  test_assert("unet_ring_close", unet_ring_is_closed(ring));
+  unet_ring_destroy(ring);
+
+  // joining overlapping and late recordings, at 1 ms per sample and times beyond 32 bits
+  float join_buf[200];
+  long long join_end = -1;
+  unet_block_t join_blk = { join_buf, 100, 1000, 12000, 5000000000LL, 0, 0 };
+  unet_block_join(&join_blk, &join_end);
+  rv = join_blk.nsamples == 100 && join_blk.gap == 0 && join_end == 5000100000LL ? 0 : -1;
+  join_blk = (unet_block_t){ join_buf, 100, 1000, 12000, 5000090000LL, 1, 0 };
+  unet_block_join(&join_blk, &join_end);
+  test_assert("unet_block_join (overlap)", rv == 0 && join_blk.signal == join_buf + 20 && join_blk.nsamples == 90 && join_blk.rxtime == 5000100000LL && join_blk.gap == 0 && join_end == 5000190000LL);
+  join_blk = (unet_block_t){ join_buf, 100, 1000, 12000, 5000195000LL, 2, 0 };
+  unet_block_join(&join_blk, &join_end);
+  test_assert("unet_block_join (gap)", join_blk.signal == join_buf && join_blk.nsamples == 100 && join_blk.gap == 5 && join_end == 5000295000LL);
+  join_blk = (unet_block_t){ join_buf, 100, 1000, 12000, 5000100000LL, 3, 0 };
+  unet_block_join(&join_blk, &join_end);
+  test_assert("unet_block_join (repeat)", join_blk.nsamples == 0 && join_end == 5000295000LL);
+
+  // sample conversion
+  float conv_in[19], conv_out[19], conv_ch[2][19];
+  uint8_t conv_s24[3 * 19];
+  int16_t conv_s16[19];
+  for (int i = 0; i < 19; i++) conv_in[i] = (float)(i - 9) / 8.0f;
+  unet_conv_f32_s24(conv_s24, conv_in, 19);
+  unet_conv_s24_f32(conv_out, conv_s24, 19);
+  rv = 0;
+  for (int i = 1; i < 18; i++) if (fabsf(conv_out[i] - conv_in[i]) > 1e-6f) rv = -1;
+  test_assert("unet_conv_s24", rv == 0 && fabsf(conv_out[0] + 1.0f) < 1e-6f && fabsf(conv_out[18] - 1.0f) < 1e-6f);
+  unet_conv_f32_s16(conv_s16, conv_in, 19);
+  test_assert("unet_conv_s16", conv_s16[0] == -32768 && conv_s16[18] == 32767 && conv_s16[13] == 16384);
+  // rounding and saturation over a length that takes every kernel's tail path
+  float conv_x[67];
+  int16_t conv_y[67];
+  for (int i = 0; i < 67; i++) conv_x[i] = (float)(i - 33) * 0.037f + 1e-4f;
+  conv_x[5] = NAN;
+  conv_x[6] = INFINITY;
+  conv_x[7] = -INFINITY;
+  conv_x[8] = 0.4f / 32767;
+  conv_x[9] = 0.6f / 32767;
+  conv_x[10] = -0.6f / 32767;
+  unet_conv_f32_s16(conv_y, conv_x, 67);
+  rv = conv_y[5] == 0 && conv_y[6] == 32767 && conv_y[7] == -32768 && conv_y[8] == 0 && conv_y[9] == 1 && conv_y[10] == -1 ? 0 : -1;
+  for (int i = 11; i < 67; i++) {
+    float v = conv_x[i] * 32767.0f;
+    long y = v >= 32767.0f ? 32767 : v <= -32768.0f ? -32768 : lrintf(v);
+    if (conv_y[i] != y) rv = -1;
+  }
+  test_assert("unet_conv_s16 (rounding)", rv == 0);
+  // dither turns a constant 0.3 LSB, which rounds to 0, into values averaging 0.3 LSB
+  int16_t *conv_d = malloc(sizeof(int16_t) * 4096);
+  float *conv_c = malloc(sizeof(float) * 4096);
+  rv = conv_d != NULL && conv_c != NULL ? 0 : -1;
+  if (rv == 0) {
+    uint32_t conv_seed = 1;
+    long conv_sum = 0;
+    for (int i = 0; i < 4096; i++) conv_c[i] = 0.3f / 32767;
+    conv_c[4094] = 1.0f;
+    conv_c[4095] = NAN;
+    unet_conv_f32_s16_dither(conv_d, conv_c, 4096, &conv_seed);
+    for (int i = 0; i < 4094; i++) {
+      if (conv_d[i] < -1 || conv_d[i] > 1) rv = -1;
+      conv_sum += conv_d[i];
+    }
+    if (fabs((double)conv_sum / 4094 - 0.3) > 0.05 || conv_d[4094] < 32766 || conv_d[4095] != 0 || conv_seed == 1) rv = -1;
+  }
+  test_assert("unet_conv_s16_dither", rv == 0);
+  free(conv_d);
+  free(conv_c);
+  float *conv_chp[2] = { conv_ch[0], conv_ch[1] };
+  unet_conv_deinterleave(conv_chp, conv_in, 2, 9);
+  test_assert("unet_conv_deinterleave", memcmp(&conv_ch[0][4], &conv_in[8], sizeof(float)) == 0 && memcmp(&conv_ch[1][4], &conv_in[9], sizeof(float)) == 0);
+
+  // WAV file round trip
+  unet_wav_t wav = unet_wav_create("test_unet.wav", WAV_PCM24, 48000, 1);
+  test_assert("unet_wav_create", wav != NULL && unet_wav_write(wav, conv_in, 19) == 19 && unet_wav_close(wav) == 0);
+  wav = unet_wav_open("test_unet.wav");
+  test_assert("unet_wav_open", wav != NULL && unet_wav_frames(wav) == 19 && unet_wav_format(wav) == WAV_PCM24);
+  if (wav != NULL) {
+    test_assert("unet_wav_read", unet_wav_read(wav, conv_out, 19) == 19 && fabsf(conv_out[10] - conv_in[10]) < 1e-6f);
+    unet_wav_close(wav);
+  }
+  remove("test_unet.wav");
+
+  // recording to a memory-mapped file, with a gap of 10 frames between two blocks
+  float sink_in[60], sink_out[60];
+  for (int i = 0; i < 60; i++) sink_in[i] = (float)(i - 30) / 32.0f;
+  unet_sink_t sink = unet_sink_mmap("test_unet.wav", SINK_WAV16, 48000, 1, 60);
+  unet_block_t sink_blk = { sink_in, 20, 48000, 0, 0, 0, 0 };
+  rv = sink != NULL && unet_sink_block(sink, &sink_blk) == 0 ? 0 : -1;
+  sink_blk.signal = sink_in + 20;
+  sink_blk.seq = 1;
+  sink_blk.gap = 10;
+  if (rv == 0 && unet_sink_block(sink, &sink_blk) != 0) rv = -1;
+  test_assert("unet_sink_mmap", rv == 0);
+  if (sink != NULL) test_assert("unet_sink_close (mmap)", unet_sink_close(sink) == 0);
+  wav = unet_wav_open("test_unet.wav");
+  rv = wav != NULL && unet_wav_frames(wav) == 50 && unet_wav_format(wav) == WAV_PCM16 && unet_wav_read(wav, sink_out, 60) == 50 ? 0 : -1;
+  for (int i = 0; rv == 0 && i < 50; i++) {
+    float x = i < 20 ? sink_in[i] : i < 30 ? 0.0f : sink_in[i - 10];
+    if (fabsf(sink_out[i] - x) > 1.0f / 32767) rv = -1;
+  }
+  test_assert("unet_sink_block (gap)", rv == 0);
+  if (wav != NULL) unet_wav_close(wav);
+  // a block that overflows the file fills it, and ends the recording
+  sink = unet_sink_mmap("test_unet.wav", SINK_WAV16, 48000, 1, 30);
+  sink_blk.signal = sink_in;
+  sink_blk.gap = 0;
+  sink_blk.nsamples = 20;
+  rv = sink != NULL && unet_sink_block(sink, &sink_blk) == 0 && unet_sink_block(sink, &sink_blk) == 1 ? 0 : -1;
+  if (sink != NULL && unet_sink_close(sink) < 0) rv = -1;
+  wav = unet_wav_open("test_unet.wav");
+  test_assert("unet_sink_block (full)", rv == 0 && wav != NULL && unet_wav_frames(wav) == 30);
+  if (wav != NULL) unet_wav_close(wav);
+  remove("test_unet.wav");
+
+  // recording through the asynchronous writer, over many of its buffers
+  float *sink_buf = malloc(sizeof(float) * 2 * 4096);
+  sink = unet_sink_async("test_unet.wav", SINK_WAV24, 48000, 2, 0);
+  rv = sink != NULL && sink_buf != NULL ? 0 : -1;
+  for (int i = 0; rv == 0 && i < 300000; i += 4096) {
+    int n = 300000 - i < 4096 ? 300000 - i : 4096;
+    for (int j = 0; j < 2 * n; j++) sink_buf[j] = (float)((2 * i + j) % 2001 - 1000) / 1000.0f;
+    if (unet_sink_write(sink, sink_buf, n) != n) rv = -1;
+  }
+  if (sink != NULL && unet_sink_close(sink) < 0) rv = -1;
+  test_assert("unet_sink_async", rv == 0);
+  wav = unet_wav_open("test_unet.wav");
+  rv = wav != NULL && unet_wav_frames(wav) == 300000 && unet_wav_channels(wav) == 2 && sink_buf != NULL ? 0 : -1;
+  for (int i = 0; rv == 0 && i < 300000; i += 4096) {
+    int n = 300000 - i < 4096 ? 300000 - i : 4096;
+    if (unet_wav_read(wav, sink_buf, n) != n) rv = -1;
+    for (int j = 0; rv == 0 && j < 2 * n; j++) {
+      if (fabsf(sink_buf[j] - (float)((2 * i + j) % 2001 - 1000) / 1000.0f) > 1.0f / 8388607) rv = -1;
+    }
+  }
+  test_assert("unet_sink_async (read back)", rv == 0);
+  if (wav != NULL) unet_wav_close(wav);
+  remove("test_unet.wav");
+  free(sink_buf);
+
+  // triggered recording of 100 ms before to 200 ms after a fired trigger and a
+  // burst of energy, at 1 ms per sample and times beyond 32 bits
+  float *trig_sig = malloc(sizeof(float) * 4000);
+  unet_trigger_t trig = unet_trigger_create(0.1f, 0.2f, trigger_clip, NULL);
+  rv = trig_sig != NULL && trig != NULL && unet_trigger_set_detector(trig, 10, 0.01f, 0.5f) == 0 ? 0 : -1;
+  if (rv == 0) {
+    uint32_t seed = 1;
+    for (int i = 0; i < 4000; i++) {
+      seed = seed * 1664525 + 1013904223;
+      trig_sig[i] = ((float)(seed >> 8) / 16777216.0f - 0.5f) * 0.02f;
+    }
+    for (int i = 2500; i < 2520; i++) trig_sig[i] = 1.0f;
+    for (int i = 0; i < 4; i++) {
+      unet_block_t trig_blk = { trig_sig + 1000 * i, 1000, 1000, 0, 5000000000LL + 1000000LL * i, (unsigned long long)i, 0 };
+      if (i == 1) unet_trigger_fire(trig, 5001200000LL);
+      unet_trigger_block(trig, &trig_blk);
+    }
+  }
+  test_assert("unet_trigger_fire", rv == 0 && trigger_count >= 1 && trigger_rxtime[0] == 5001100000LL && trigger_len[0] == 300 && trigger_peak[0] < 0.01f);
+  test_assert("unet_trigger_set_detector", rv == 0 && trigger_count == 2 && trigger_rxtime[1] == 5002400000LL && trigger_len[1] == 300 && trigger_peak[1] > 0.99f);
+  unet_trigger_destroy(trig);
+  free(trig_sig);
+
+  // resampling
+  unet_resample_t rs = unet_resample_create(48000, 32000);
+  float *rs_in = malloc(sizeof(float) * 4800);
+  float *rs_out = malloc(sizeof(float) * (size_t)(unet_resample_max_output(rs, 4800) + unet_resample_max_output(rs, RESAMPLE_BLK)));
+  if (rs != NULL && rs_in != NULL && rs_out != NULL) {
+    for (int i = 0; i < 4800; i++) rs_in[i] = 0.5f;
+    int n = unet_resample_process(rs, rs_in, 4800, rs_out);
+    n += unet_resample_flush(rs, rs_out + n);
+    test_assert("unet_resample", n == 3200 && fabsf(rs_out[1600] - 0.5f) < 1e-4f);
+    // tones in the passband keep their amplitude and phase, with no delay, and
+    // a tone above the output Nyquist frequency is removed
+    float rs_err[3] = { 0, 0, 0 };
+    const float rs_tone[3] = { 1000, 12000, 20000 };
+    float *rs_ref = calloc(3200, sizeof(float));
+    for (int j = 0; rs_ref != NULL && j < 3; j++) {
+      unet_resample_reset(rs);
+      unet_siggen_cw(rs_in, 4800, rs_tone[j], 48000, 0);
+      if (j < 2) unet_siggen_cw(rs_ref, 3200, rs_tone[j], 32000, 0);
+      else memset(rs_ref, 0, sizeof(float) * 3200);
+      n = unet_resample_process(rs, rs_in, 4800, rs_out);
+      n += unet_resample_flush(rs, rs_out + n);
+      for (int k = 400; k < 2800; k++) if (fabsf(rs_out[k] - rs_ref[k]) > rs_err[j]) rs_err[j] = fabsf(rs_out[k] - rs_ref[k]);
+    }
+    test_assert("unet_resample (tones)", n == 3200 && rs_ref != NULL && rs_err[0] < 2e-4f && rs_err[1] < 2e-4f && rs_err[2] < 1e-4f);
+    free(rs_ref);
+  } else test_assert("unet_resample", false);
+  unet_resample_destroy(rs);
+  free(rs_in);
+  free(rs_out);
+
+  // downconversion
+  unet_ddc_t ddc = unet_ddc_create(96000, 24000, 4000);
+  float *ddc_in = malloc(sizeof(float) * 9600);
+  float *ddc_out = malloc(sizeof(float) * 2 * (size_t)unet_ddc_max_output(ddc, 9600));
+  if (ddc != NULL && ddc_in != NULL && ddc_out != NULL) {
+    unet_siggen_cw(ddc_in, 9600, 25000, 96000, 0);
+    int n = unet_ddc_process(ddc, ddc_in, 9600, ddc_out);
+    float amp = hypotf(ddc_out[n / 2 * 2], ddc_out[n / 2 * 2 + 1]);
+    test_assert("unet_ddc", n > 0 && fabsf(amp - 0.5f) < 1e-3f);
+  } else test_assert("unet_ddc", false);
+  unet_ddc_destroy(ddc);
+  free(ddc_in);
+  free(ddc_out);
+
+  // waveform synthesis
+  float *sg = malloc(sizeof(float) * 1023);
+  if (sg != NULL) {
+    float sum = 0;
+    int n = unet_siggen_mseq(sg, 10);
+    for (int i = 0; i < n; i++) sum += sg[i];
+    test_assert("unet_siggen_mseq", n == 1023 && fabsf(sum + 1) < 1e-6f);
+  } else test_assert("unet_siggen_mseq", false);
+  free(sg);
+  // chirps against their analytic phase, a passband LFM and a baseband HFM at 2 kHz
+  float *sg_lfm = malloc(sizeof(float) * 4800);
+  float *sg_hfm = malloc(sizeof(float) * 2 * 4800);
+  if (sg_lfm != NULL && sg_hfm != NULL) {
+    const double pi = acos(-1.0);
+    const double k = 2000.0 / (3000 * 0.1);
+    float lfm_err = 0, hfm_err = 0;
+    rv = unet_siggen_lfm(sg_lfm, 4800, 1000, 3000, 48000, 0) == 0 && unet_siggen_hfm(sg_hfm, 4800, 1000, 3000, 48000, 2000) == 0 ? 0 : -1;
+    for (int i = 0; i < 4800; i++) {
+      double t = i / 48000.0;
+      double p = 2 * pi * (1000 * t + 2000 * t * t / (2 * 0.1));
+      if (fabsf(sg_lfm[i] - (float)sin(p)) > lfm_err) lfm_err = fabsf(sg_lfm[i] - (float)sin(p));
+      p = 2 * pi * (-1000 / k * log(1 - k * t) - 2000 * t);
+      if (fabsf(sg_hfm[2 * i] - (float)cos(p)) > hfm_err) hfm_err = fabsf(sg_hfm[2 * i] - (float)cos(p));
+      if (fabsf(sg_hfm[2 * i + 1] - (float)sin(p)) > hfm_err) hfm_err = fabsf(sg_hfm[2 * i + 1] - (float)sin(p));
+    }
+    test_assert("unet_siggen_lfm", rv == 0 && lfm_err < 1e-4f);
+    test_assert("unet_siggen_hfm", rv == 0 && hfm_err < 1e-4f);
+  } else {
+    test_assert("unet_siggen_lfm", false);
+    test_assert("unet_siggen_hfm", false);
+  }
+  free(sg_lfm);
+  free(sg_hfm);
+  // Gold codes of degree 7 have periodic correlation sidelobes of at most 17
+  float sg_gold[2][127];
+  rv = unet_siggen_gold(sg_gold[0], 7, 2) == 127 && unet_siggen_gold(sg_gold[1], 7, 5) == 127 ? 0 : -1;
+  for (int lag = 0; rv == 0 && lag < 127; lag++) {
+    float auto0 = 0, cross = 0;
+    for (int i = 0; i < 127; i++) {
+      auto0 += sg_gold[0][i] * sg_gold[0][(i + lag) % 127];
+      cross += sg_gold[0][i] * sg_gold[1][(i + lag) % 127];
+    }
+    if (lag == 0 ? fabsf(auto0 - 127) > 1e-3f : fabsf(auto0) > 17.5f) rv = -1;
+    if (fabsf(cross) > 17.5f) rv = -1;
+  }
+  test_assert("unet_siggen_gold", rv == 0 && unet_siggen_gold(sg_gold[0], 8, 2) == -1 && unet_siggen_gold(sg_gold[0], 40, 2) == -1);
+  // windows over 101 samples, with a baseband Hann window
+  float sg_win[4][101], sg_bb[202];
+  for (int i = 0; i < 101; i++) sg_win[0][i] = sg_win[1][i] = sg_win[2][i] = sg_win[3][i] = sg_bb[2 * i] = sg_bb[2 * i + 1] = 1.0f;
+  rv = unet_siggen_window(sg_win[0], 101, 0, SIGGEN_HAMMING, 0) == 0 ? 0 : -1;
+  if (unet_siggen_window(sg_win[1], 101, 0, SIGGEN_BLACKMAN, 0) < 0 || unet_siggen_window(sg_win[2], 101, 0, SIGGEN_TUKEY, 0.5f) < 0) rv = -1;
+  if (unet_siggen_window(sg_win[3], 101, 0, SIGGEN_TUKEY, 2) == 0 || unet_siggen_window(sg_bb, 101, 2000, SIGGEN_HANN, 0) < 0) rv = -1;
+  for (int i = 0; rv == 0 && i < 101; i++) {
+    double c = cos(2 * acos(-1.0) * i / 100);
+    double tukey = i < 25 ? 0.5 - 0.5 * cos(acos(-1.0) * i / 25) : i > 75 ? 0.5 - 0.5 * cos(acos(-1.0) * (100 - i) / 25) : 1;
+    if (fabs(sg_win[0][i] - (0.54 - 0.46 * c)) > 1e-5 || fabs(sg_win[1][i] - (0.42 - 0.5 * c + 0.08 * (2 * c * c - 1))) > 1e-5) rv = -1;
+    if (fabs(sg_win[2][i] - tukey) > 1e-5 || fabs(sg_bb[2 * i] - (0.5 - 0.5 * c)) > 1e-5 || fabs(sg_bb[2 * i + 1] - (0.5 - 0.5 * c)) > 1e-5) rv = -1;
+  }
+  test_assert("unet_siggen_window", rv == 0);
+
+  // matched filter
+  float *corr_ref = malloc(sizeof(float) * 480);
+  float *corr_sig = calloc(9600, sizeof(float));
+  unet_corr_t corr = unet_corr_create(48000, 0, 480, corr_detect, NULL);
+  if (corr_ref != NULL && corr_sig != NULL && corr != NULL) {
+    unet_siggen_lfm(corr_ref, 480, 5000, 10000, 48000, 0);
+    memcpy(corr_sig + 3000, corr_ref, sizeof(float) * 480);
+    unet_corr_add(corr, corr_ref, 480);
+    unet_corr_process(corr, corr_sig, 9600);
+    test_assert("unet_corr", corr_count == 1 && corr_sample[0] == 3000);
+  } else test_assert("unet_corr", false);
+  unet_corr_destroy(corr);
+  // a weak arrival 40 dB below a strong one, in the same block and in noise
+  corr = unet_corr_create(48000, 0, 480, corr_detect, NULL);
+  if (corr_ref != NULL && corr_sig != NULL && corr != NULL) {
+    uint32_t seed = 1;
+    for (int i = 0; i < 9600; i++) {
+      seed = seed * 1664525 + 1013904223;
+      corr_sig[i] = ((float)(seed >> 8) / 16777216.0f - 0.5f) * 0.02f;
+    }
+    for (int i = 0; i < 480; i++) {
+      corr_sig[3000 + i] += corr_ref[i];
+      corr_sig[3600 + i] += 0.01f * corr_ref[i];
+    }
+    corr_count = 0;
+    unet_corr_add(corr, corr_ref, 480);
+    unet_corr_process(corr, corr_sig, 9600);
+    test_assert("unet_corr_weak", corr_count == 2 && corr_sample[0] == 3000 && corr_sample[1] == 3600 && fabsf(corr_peak[1] - 0.01f) < 0.002f);
+  } else test_assert("unet_corr_weak", false);
+  unet_corr_destroy(corr);
+  free(corr_ref);
+  free(corr_sig);
+
+  // power spectral density
+  float *psd_sig = malloc(sizeof(float) * 4096);
+  unet_psd_t psd = unet_psd_create(48000, 0, 256, SIGGEN_HANN, 0.5f, 16, psd_frame, NULL);
+  if (psd_sig != NULL && psd != NULL) {
+    unet_siggen_cw(psd_sig, 4096, 6000, 48000, 0);
+    test_assert("unet_psd", unet_psd_process(psd, psd_sig, 4096) == 0 && fabsf(psd_peak - 6000) < 1);
+  } else test_assert("unet_psd", false);
+  unet_psd_destroy(psd);
+  free(psd_sig);
+
+  // channel sounding
+  float *snd_probe = malloc(sizeof(float) * 960);
+  float *snd_rec = calloc(9600, sizeof(float));
+  unet_sound_t snd = NULL;
+  if (snd_probe != NULL && snd_rec != NULL) {
+    unet_siggen_lfm(snd_probe, 960, 8000, 16000, 48000, 0);
+    for (int i = 0; i < 960; i++) {
+      snd_rec[2000 + i] += snd_probe[i];
+      snd_rec[2030 + i] += 0.5f * snd_probe[i];
+    }
+    snd = unet_sound_create(48000, snd_probe, 960, 128);
+  }
+  unet_sound_result_t snd_res;
+  if (snd != NULL && unet_sound_process(snd, snd_rec, 9600, 1, 0, &snd_res) == 0) {
+    float ratio = snd_res.pdp[SOUND_PRE + 30] / snd_res.pdp[SOUND_PRE];
+    test_assert("unet_sound", fabsf(snd_res.delay * 48000 - 2000) < 0.1f && fabsf(ratio - 0.25f) < 0.01f);
+  } else test_assert("unet_sound", false);
+  // four probes every 100 ms from a source closing at 1.5 m/s, which compresses
+  // the received signal by 1e-3, along two paths 30 samples apart
+  float *snd_seq = calloc(19200, sizeof(float));
+  if (snd != NULL && snd_seq != NULL) {
+    const double pi = acos(-1.0);
+    for (int i = 0; i < 19200; i++) {
+      for (int k = 0; k < 4; k++) {
+        for (int path = 0; path < 2; path++) {
+          double t = (1 + 1e-3) * i / 48000 - 0.1 * k - (2000 + 30 * path) / 48000.0;
+          if (t >= 0 && t < 0.02) snd_seq[i] += (float)((path ? 0.5 : 1) * sin(2 * pi * (8000 * t + 8000 * t * t / (2 * 0.02))));
+        }
+      }
+    }
+  }
+  if (snd != NULL && snd_seq != NULL && unet_sound_process(snd, snd_seq, 19200, 4, 0.1f, &snd_res) == 0) {
+    float ratio = snd_res.pdp[SOUND_PRE + 30] / snd_res.pdp[SOUND_PRE];
+    // the chirp's range-Doppler coupling advances the arrival by 12 Hz * 20 ms / 8 kHz
+    test_assert("unet_sound (probes)", snd_res.nprobes == 4 && fabsf(snd_res.delay * 48000 - (2000 / 1.001f - 1.44f)) < 0.3f && fabsf(ratio - 0.25f) < 0.02f);
+    test_assert("unet_sound (doppler)", fabsf(snd_res.doppler - 12) < 0.5f);
+  } else {
+    test_assert("unet_sound (probes)", false);
+    test_assert("unet_sound (doppler)", false);
+  }
+  free(snd_seq);
+  unet_sound_destroy(snd);
+  free(snd_probe);
+  free(snd_rec);
+
+  // transponder ranging
+  float *rng_reply = malloc(sizeof(float) * 480);
+  float *rng_sig = calloc(28800, sizeof(float));
+  unet_ranger_t rng = unet_ranger_create(96000, 480, 100, ranger_fix, NULL);
+  if (rng_reply != NULL && rng_sig != NULL && rng != NULL) {
+    // a reply 20 ms after the ping arrives, from a transponder 50 m away
+    unet_siggen_lfm(rng_reply, 480, 30000, 32000, 96000, 0);
+    memcpy(rng_sig + 960 + 1920 + 6400, rng_reply, sizeof(float) * 480);
+    unet_ranger_add(rng, rng_reply, 480, 0.02f);
+    unet_ranger_ping(rng, 10000);
+    unet_block_t rng_blk = { rng_sig, 28800, 96000, 0, 0, 0, 0 };
+    unet_ranger_block(rng, &rng_blk);
+    test_assert("unet_ranger", fabsf(ranger_range - 50) < 0.01f);
+  } else test_assert("unet_ranger", false);
+  unet_ranger_destroy(rng);
+  free(rng_reply);
+  free(rng_sig);
+
+  // multilateration
+  float loc_anchors[15] = { 0, 0, 0, 1000, 0, 0, 0, 1000, 0, 1000, 1000, 0, 500, 500, -200 };
+  float loc_target[6] = { 300, 400, -50, 700, 200, -20 };
+  float loc_range[10];
+  for (int i = 0; i < 5; i++) {
+    for (int t = 0; t < 2; t++) {
+      float dx = loc_target[3 * t] - loc_anchors[3 * i];
+      float dy = loc_target[3 * t + 1] - loc_anchors[3 * i + 1];
+      float dz = loc_target[3 * t + 2] - loc_anchors[3 * i + 2];
+      loc_range[2 * i + t] = sqrtf(dx * dx + dy * dy + dz * dz);
+    }
+  }
+  loc_range[2 * 1] += 40;       // outlier for the first target
+  loc_range[2 * 4 + 1] = -1;    // no range for the second target
+  unet_locate_t loc = unet_locate_create(loc_anchors, 5);
+  unet_position_t loc_pos[2];
+  if (loc != NULL) {
+    int loc_n = unet_locate_solve(loc, loc_range, NULL, 2, loc_pos);
+    test_assert("unet_locate", loc_n == 2 && loc_pos[0].rejected == 2 && loc_pos[1].nranges == 4 &&
+      fabsf(loc_pos[0].x - 300) < 0.01f && fabsf(loc_pos[0].y - 400) < 0.01f && fabsf(loc_pos[0].z + 50) < 0.01f &&
+      fabsf(loc_pos[1].x - 700) < 0.01f && fabsf(loc_pos[1].y - 200) < 0.01f && fabsf(loc_pos[1].z + 20) < 0.01f);
+  } else test_assert("unet_locate", false);
+  unet_locate_destroy(loc);
+
+  // tracking
+  unet_track_t trk = unet_track_create(4, 0.005f);
+  if (trk != NULL) {
+    // a node moving away at 1 m/s from 100 m, ranged every 10 s
+    int trk_rv = 0;
+    for (int i = 0; i <= 20; i++) trk_rv |= unet_track_range(trk, 5, i * 10000000LL, (float)(100 + i * 10) + (i % 2 ? 0.5f : -0.5f), 0.5f);
+    trk_rv |= unet_track_range(trk, 5, 205000000LL, 400, 0.5f) == 1 ? 0 : 1;
+    float trk_range, trk_rate, trk_sigma;
+    trk_rv |= unet_track_predict_range(trk, 5, 210000000LL, &trk_range, &trk_rate, &trk_sigma);
+    test_assert("unet_track", trk_rv == 0 && fabsf(trk_range - 310) < 1 && fabsf(trk_rate - 1) < 0.1f && trk_sigma < 1 &&
+      unet_track_need_range(trk, 5, 210000000LL, 1) == 0 && unet_track_need_range(trk, 6, 210000000LL, 1) == 1);
+  } else test_assert("unet_track", false);
+  unet_track_destroy(trk);
+
+  // neighbor table
+  unet_nbr_t nbrs = unet_nbr_create(100, 0.5f);
+  if (nbrs != NULL) {
+    int nbr_rv = 0;
+    for (int i = 0; i < 100; i++) nbr_rv |= unet_nbr_heard(nbrs, i * 64, i, (float)i, NAN);
+    nbr_rv |= unet_nbr_heard(nbrs, 1, 0, 0, 0) == -1 ? 0 : 1;
+    for (int i = 0; i < 100; i += 2) nbr_rv |= unet_nbr_remove(nbrs, i * 64);
+    nbr_rv |= unet_nbr_delivery(nbrs, 64, true) | unet_nbr_delivery(nbrs, 64, false);
+    unet_nbr_info_t nbr_list[100], nbr_get;
+    int nbr_n = unet_nbr_list(nbrs, nbr_list, 100);
+    for (int i = 1; i < 100; i += 2) nbr_rv |= unet_nbr_get(nbrs, i * 64, &nbr_get) < 0 || fabsf(nbr_get.rssi - (float)i) > 0 || !isnan(nbr_get.snr);
+    nbr_rv |= unet_nbr_get(nbrs, 64, &nbr_get) < 0 || fabsf(nbr_get.delivery - 0.5f) > 0 || unet_nbr_get(nbrs, 128, &nbr_get) == 0;
+    test_assert("unet_nbr", nbr_rv == 0 && nbr_n == 50);
+  } else test_assert("unet_nbr", false);
+  unet_nbr_destroy(nbrs);
+
+  // clock fit and reset, from synchronization points with a 50 ppm drift
+  unet_clock_t fitclk = unet_clock_open(NULL);
+  if (fitclk != NULL) {
+    long long fit_modem, fit_host;
+    unet_clock_info_t fit_info;
+    int fit_rv = unet_clock_sync(fitclk) == -1 && unet_clock_now(fitclk, &fit_modem) == -1 ? 0 : 1;
+    for (int i = 0; i < 10; i++) {
+      long long h = 1000000000LL + i * 10000000LL;
+      fit_rv |= unet_clock_add(fitclk, h, h + 4000000000LL + llround(50e-6 * (double)(h - 1000000000LL)), 2000);
+    }
+    fit_rv |= unet_clock_to_modem(fitclk, 1200000000LL, &fit_modem) | unet_clock_to_host(fitclk, 5200010000LL, &fit_host);
+    fit_rv |= unet_clock_get_info(fitclk, &fit_info);
+    test_assert("unet_clock (fit)", fit_rv == 0 && llabs(fit_modem - 5200010000LL) <= 2 && llabs(fit_host - 1200000000LL) <= 2 &&
+      fabsf(fit_info.drift - 50) < 0.01f && fit_info.npoints == 10 && fabsf(fit_info.error - 1000) < 1e-3f);
+    // a step of the modem clock discards the earlier points
+    fit_rv = unet_clock_add(fitclk, 1100000000LL, 5102005000LL, 2000);
+    fit_rv |= unet_clock_to_modem(fitclk, 1100000000LL, &fit_modem) | unet_clock_get_info(fitclk, &fit_info);
+    test_assert("unet_clock (reset)", fit_rv == 0 && fit_modem == 5102005000LL && fit_info.npoints == 1 && fabsf(fit_info.drift) < 1e-3f);
+  } else test_assert("unet_clock (fit)", false);
+  unet_clock_close(fitclk);
+}
+
 int main(int argc, char* argv[]) {
   printf("\n");
+  test_offline();
   int rv;
   int port_tx = 1100;
   int port_rx = 1100;
@@ -84,6 +659,7 @@ int main(int argc, char* argv[]) {
           "test_unet localhost localhost 1101 1102 \n"
           "(or) \n"
           "test_unet 192.168.1.10 192.168.1.20 1100 1100 \n");
+    test_summary();
     return -1;
   }
   if (argc > 4) {
@@ -119,6 +695,67 @@ int main(int argc, char* argv[]) {
   rv = unetsocket_ext_get_range(sock_tx, rx_node_address, &range);
   if (rv == 0) printf("Range measured is : %f \n", range);
   test_assert("Ranging", rv == 0);
+  // batch ranging
+  unet_ranging_t rgc = unet_ranging_open(sock_tx);
+  if (rgc != NULL) {
+    int nodes[2] = { rx_node_address, rx_node_address };
+    float ranges[2];
+    int status[2];
+    rv = unet_ranging_range(rgc, nodes, 2, 30000, ranges, status);
+    unet_ranging_close(rgc);
+    test_assert("unet_ranging_range", rv == 2 && status[0] == RANGING_OK && status[1] == RANGING_OK &&
+      fabsf(ranges[0] - range) < 10 && fabsf(ranges[1] - range) < 10);
+  } else test_assert("unet_ranging_open", false);
+  // clock synchronization
+  unet_clock_t clk = unet_clock_open(sock_tx);
+  long long clk_modem, clk_now, clk_host;
+  rv = clk != NULL ? unet_clock_sync(clk) : -1;
+  if (rv == 0 && unetsocket_ext_get_time(sock_tx, &clk_modem) == 0) {
+    // a fresh reading lags the estimate by up to its own round trip
+    unet_clock_now(clk, &clk_now);
+    unet_clock_to_host(clk, clk_now, &clk_host);
+    rv = llabs(clk_now - clk_modem) < 1000000 && llabs(clk_host - unet_clock_host_time()) < 1000000 ? 0 : -1;
+  }
+  test_assert("unet_clock", rv == 0);
+  unet_clock_close(clk);
+  // scheduled transmission
+  char tx_id[FRAME_ID_LEN];
+  long long tx_at, tx_actual = 0;
+  rv = unetsocket_ext_get_time(sock_tx, &tx_at);
+  if (rv == 0) {
+    tx_at += 2000000;
+    rv = unetsocket_ext_send_at(sock_tx, data_tx, 7, rx_node_address, DATA, TXTIME_DATA, tx_at, tx_id);
+    if (rv == 0) rv = unetsocket_ext_wait_tx(sock_tx, tx_id, 5 * TIMEOUT, &tx_actual);
+  }
+  test_assert("unetsocket_ext_send_at", rv == 0 && llabs(tx_actual - tx_at) < 1000);
+  // streamed transmission
+  rv = unetsocket_ext_tx_stream(sock_tx, 0, stream_source, NULL, 4800);
+  test_assert("unetsocket_ext_tx_stream", rv == 0 && stream_blocks == 4);
+  stream_blocks = 0;
+  stream_late = true;
+  rv = unetsocket_ext_tx_stream(sock_tx, 0, stream_source, NULL, 4800);
+  test_assert("unetsocket_ext_tx_stream_late", rv == -1 && stream_blocks == 3);
+  // slotted transmission
+  unet_clock_t tdma_clk = unet_clock_open(sock_tx);
+  unet_tdma_t tdma = NULL;
+  if (tdma_clk != NULL && unet_clock_sync(tdma_clk) == 0) tdma = unet_tdma_create(sock_tx, tdma_clk, 4, 1000000, 0);
+  unet_tdma_stats_t tdma_stats = { 0, 0, 0, 0, 0, 0, 0 };
+  long long tdma_slot;
+  if (tdma != NULL && unet_tdma_set_slot(tdma, 2, true) == 0 && unet_tdma_next_slot(tdma, 1, &tdma_slot) == 2 && tdma_slot == 2000000) {
+    unet_tdma_send(tdma, data_tx, 7, rx_node_address, DATA);
+    unet_tdma_send(tdma, data_tx, 7, rx_node_address, DATA);
+    unet_tdma_start(tdma);
+    for (int i = 0; i < 150 && tdma_stats.confirmed < 2; i++) {
+      Sleep(100);
+      unet_tdma_get_stats(tdma, &tdma_stats);
+    }
+    unet_tdma_stop(tdma);
+  }
+  // the modem transmits at the start of slot 2 of each 4 s frame
+  test_assert("unet_tdma", tdma_stats.confirmed == 2 && tdma_stats.refused == 0 && tdma_stats.failed == 0 &&
+    tdma_stats.txtime > 0 && llabs(tdma_stats.txtime % 4000000 - 2000000) < 1000);
+  unet_tdma_destroy(tdma);
+  unet_clock_close(tdma_clk);
   // send data
   rv = unetsocket_send(sock_tx, data_tx, 7, rx_node_address, DATA);
   test_assert("unetsocket_send", rv == 0);
@@ -179,6 +816,11 @@ int main(int argc, char* argv[]) {
     }
   }
   test_assert("unetsocket_receive(2)", strcmp("org.arl.unet.DatagramNtf", fjage_msg_get_clazz(ntf))==0 && rx_test_data_match_flag);
+  unet_nbr_t nbr = unet_nbr_create(16, 0);
+  unet_nbr_info_t nbr_info;
+  rv = unet_nbr_update(nbr, ntf);
+  test_assert("unet_nbr_update", rv == 0 && unet_nbr_get(nbr, unetsocket_get_local_address(sock_tx), &nbr_info) == 0 && nbr_info.rxcount == 1);
+  unet_nbr_destroy(nbr);
   fjage_msg_destroy(ntf);
 
   // flushing
@@ -205,6 +847,36 @@ int main(int argc, char* argv[]) {
   test_assert("unetsocket_receive_large(2)", strcmp("org.arl.unet.DatagramNtf", fjage_msg_get_clazz(ntf))==0 && rx_test_data_match_flag);
   fjage_msg_destroy(ntf);
 
+  // bulk transfer
+  uint8_t xfer_data[10000];
+  for (size_t i = 0; i < sizeof(xfer_data); i++) xfer_data[i] = (uint8_t) (i * 7 % 251);
+  pthread_t xfer_tid;
+  xfer_sock = sock_rx;
+  pthread_create(&xfer_tid, NULL, xfer_receiver, NULL);
+  long long xfer_t0 = unet_host_time_ms();
+  rv = unetsocket_xfer_send_buffer(sock_tx, rx_node_address, USER, 1, xfer_data, sizeof(xfer_data), 120000);
+  long long xfer_time = unet_host_time_ms() - xfer_t0;
+  test_assert("unetsocket_xfer_send", rv == 0);
+  pthread_join(xfer_tid, NULL);
+  test_assert("unetsocket_xfer_receive", xfer_rv == 0 && memcmp(xfer_data, xfer_buf, sizeof(xfer_data)) == 0);
+  // a transfer longer than the receiver's timeout completes while datagrams keep coming
+  memset(xfer_buf, 0, sizeof(xfer_buf));
+  xfer_timeout = xfer_time / 2 > 5 * TIMEOUT ? (long)(xfer_time / 2) : 5 * TIMEOUT;
+  pthread_create(&xfer_tid, NULL, xfer_receiver, NULL);
+  xfer_t0 = unet_host_time_ms();
+  rv = unetsocket_xfer_send_buffer(sock_tx, rx_node_address, USER, 3, xfer_data, sizeof(xfer_data), 120000);
+  xfer_time = unet_host_time_ms() - xfer_t0;
+  pthread_join(xfer_tid, NULL);
+  test_assert("unetsocket_xfer_receive (idle timeout)", rv == 0 && xfer_time > xfer_timeout && xfer_rv == 0 &&
+    memcmp(xfer_data, xfer_buf, sizeof(xfer_data)) == 0);
+  xfer_timeout = 120000;
+  memset(xfer_buf, 0, sizeof(xfer_buf));
+  pthread_create(&xfer_tid, NULL, xfer_receiver, NULL);
+  rv = unetsocket_xfer_broadcast_buffer(sock_tx, USER, 2, xfer_data, sizeof(xfer_data), 8, 4);
+  test_assert("unetsocket_xfer_broadcast", rv == 0);
+  pthread_join(xfer_tid, NULL);
+  test_assert("unetsocket_xfer_receive_broadcast", xfer_rv == 0 && memcmp(xfer_data, xfer_buf, sizeof(xfer_data)) == 0);
+
   // power level
   rv = unetsocket_ext_set_powerlevel(sock_tx, 1, -6);
   test_assert("Power level", rv == 0);
@@ -0,0 +1,36 @@
+#ifndef _UNETATOMIC_H_
+#define _UNETATOMIC_H_
+
+// Acquire and release accesses for the lock-free queues that pass buffers
+// between a producer and a consumer thread.
+
+#include <stddef.h>
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+static inline size_t unet_load_acquire(volatile size_t *p) {
+  size_t v = *p;
+  MemoryBarrier();
+  return v;
+}
+
+static inline void unet_store_release(volatile size_t *p, size_t v) {
+  MemoryBarrier();
+  *p = v;
+}
+
+#else
+
+static inline size_t unet_load_acquire(volatile size_t *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void unet_store_release(volatile size_t *p, size_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,202 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_clock.h"
+#include "unet_time.h"
+#include "pthreadwindows.h"
+#include <math.h>
+
+#define CLOCK_MAXDRIFT           200e-6   // largest drift believed, for fits over short spans
+
+typedef struct {
+  long long host;                    // host time halfway through the request
+  long long offset;                  // modem time less host time
+  long long rtt;                     // round trip of the request
+} point_t;
+
+typedef struct {
+  fjage_gw_t gw;
+  fjage_aid_t phy;
+  pthread_mutex_t lock;              // protects everything below
+  point_t hist[CLOCK_HISTORY];       // synchronization point ring
+  int npoints;
+  int next;
+  bool synced;
+  long long ref;                     // host time at which the fit is referenced
+  long long offset;                  // fitted offset at ref
+  double drift;
+  double error;
+  long long synctime;
+} _unet_clock_t;
+
+long long unet_clock_host_time(void) {
+  return unet_host_time();
+}
+
+unet_clock_t unet_clock_open(unetsocket_t sock) {
+  _unet_clock_t *clk = calloc(1, sizeof(_unet_clock_t));
+  if (clk == NULL) return NULL;
+  if (sock != NULL) {
+    clk->gw = unetsocket_get_gateway(sock);
+    clk->phy = fjage_agent_for_service(clk->gw, "org.arl.unet.Services.PHYSICAL");
+    if (clk->phy == NULL) {
+      free(clk);
+      return NULL;
+    }
+  }
+  pthread_mutex_init(&clk->lock, NULL);
+  return clk;
+}
+
+void unet_clock_close(unet_clock_t clk) {
+  if (clk == NULL) return;
+  _unet_clock_t *uclk = clk;
+  pthread_mutex_destroy(&uclk->lock);
+  if (uclk->phy != NULL) fjage_aid_destroy(uclk->phy);
+  free(uclk);
+}
+
+// Read the modem time once, as unetsocket_ext_get_time() does, timing the
+// round trip on the host clock.
+static int read_time(_unet_clock_t *clk, point_t *pt) {
+  fjage_msg_t msg = fjage_msg_create(parameterreq, FJAGE_REQUEST);
+  fjage_msg_set_recipient(msg, clk->phy);
+  fjage_msg_add_int(msg, "index", -1);
+  fjage_msg_add_string(msg, "param", "time");
+  long long t0 = unet_clock_host_time();
+  msg = fjage_request(clk->gw, msg, 5 * TIMEOUT);
+  long long t1 = unet_clock_host_time();
+  if (msg == NULL) return -1;
+  int rv = -1;
+  long long value = unet_msg_get_time(msg, "value", -1);
+  if (fjage_msg_get_performative(msg) == FJAGE_INFORM && value >= 0) {
+    pt->host = t0 + (t1 - t0) / 2;
+    pt->offset = value - pt->host;
+    pt->rtt = t1 - t0;
+    rv = 0;
+  }
+  fjage_msg_destroy(msg);
+  return rv;
+}
+
+// Fit offset and drift to the synchronization points, relative to the newest.
+static void fit(_unet_clock_t *clk) {
+  const point_t *last = clk->hist + (clk->next + CLOCK_HISTORY - 1) % CLOCK_HISTORY;
+  double sw = 0, sx = 0, sy = 0;
+  for (int i = 0; i < clk->npoints; i++) {
+    const point_t *p = clk->hist + i;
+    double w = 1 / ((double)p->rtt * (double)p->rtt + 1);
+    sw += w;
+    sx += w * (double)(p->host - last->host);
+    sy += w * (double)(p->offset - last->offset);
+  }
+  double xbar = sx / sw, ybar = sy / sw;
+  double sxx = 0, sxy = 0;
+  for (int i = 0; i < clk->npoints; i++) {
+    const point_t *p = clk->hist + i;
+    double w = 1 / ((double)p->rtt * (double)p->rtt + 1);
+    double x = (double)(p->host - last->host) - xbar;
+    double y = (double)(p->offset - last->offset) - ybar;
+    sxx += w * x * x;
+    sxy += w * x * y;
+  }
+  double drift = sxx > 0 ? sxy / sxx : 0;
+  if (drift > CLOCK_MAXDRIFT) drift = CLOCK_MAXDRIFT;
+  if (drift < -CLOCK_MAXDRIFT) drift = -CLOCK_MAXDRIFT;
+  clk->ref = last->host;
+  clk->offset = last->offset + llround(ybar - drift * xbar);
+  clk->drift = drift;
+  clk->error = (double)last->rtt / 2;
+  clk->synced = true;
+}
+
+// Add a synchronization point and refit, starting afresh if the modem clock
+// has been reset.
+static void add_point(_unet_clock_t *clk, const point_t *pt) {
+  pthread_mutex_lock(&clk->lock);
+  if (clk->synced) {
+    double predicted = (double)clk->offset + clk->drift * (double)(pt->host - clk->ref);
+    if (fabs((double)pt->offset - predicted) > CLOCK_STEP) {
+      clk->npoints = 0;
+      clk->next = 0;
+    }
+  }
+  clk->hist[clk->next] = *pt;
+  clk->next = (clk->next + 1) % CLOCK_HISTORY;
+  if (clk->npoints < CLOCK_HISTORY) clk->npoints++;
+  fit(clk);
+  clk->synctime = pt->host;
+  pthread_mutex_unlock(&clk->lock);
+}
+
+int unet_clock_sync(unet_clock_t clk) {
+  if (clk == NULL) return -1;
+  _unet_clock_t *uclk = clk;
+  if (uclk->phy == NULL) return -1;
+  point_t best, pt;
+  int n = 0;
+  for (int i = 0; i < CLOCK_BURST; i++) {
+    if (read_time(uclk, &pt) < 0) continue;
+    if (n == 0 || pt.rtt < best.rtt) best = pt;
+    n++;
+  }
+  if (n == 0) return -1;
+  add_point(uclk, &best);
+  return 0;
+}
+
+int unet_clock_add(unet_clock_t clk, long long hosttime, long long modemtime, long long rtt) {
+  if (clk == NULL || rtt < 0) return -1;
+  point_t pt = { hosttime, modemtime - hosttime, rtt };
+  add_point(clk, &pt);
+  return 0;
+}
+
+int unet_clock_to_modem(unet_clock_t clk, long long hosttime, long long *modemtime) {
+  if (clk == NULL || modemtime == NULL) return -1;
+  _unet_clock_t *uclk = clk;
+  int rv = -1;
+  pthread_mutex_lock(&uclk->lock);
+  if (uclk->synced) {
+    *modemtime = hosttime + uclk->offset + llround(uclk->drift * (double)(hosttime - uclk->ref));
+    rv = 0;
+  }
+  pthread_mutex_unlock(&uclk->lock);
+  return rv;
+}
+
+int unet_clock_to_host(unet_clock_t clk, long long modemtime, long long *hosttime) {
+  if (clk == NULL || hosttime == NULL) return -1;
+  _unet_clock_t *uclk = clk;
+  int rv = -1;
+  pthread_mutex_lock(&uclk->lock);
+  if (uclk->synced) {
+    *hosttime = uclk->ref + llround((double)(modemtime - uclk->ref - uclk->offset) / (1 + uclk->drift));
+    rv = 0;
+  }
+  pthread_mutex_unlock(&uclk->lock);
+  return rv;
+}
+
+int unet_clock_now(unet_clock_t clk, long long *modemtime) {
+  return unet_clock_to_modem(clk, unet_clock_host_time(), modemtime);
+}
+
+int unet_clock_get_info(unet_clock_t clk, unet_clock_info_t *info) {
+  if (clk == NULL || info == NULL) return -1;
+  _unet_clock_t *uclk = clk;
+  long long now = unet_clock_host_time();
+  int rv = -1;
+  pthread_mutex_lock(&uclk->lock);
+  if (uclk->synced) {
+    info->offset = uclk->offset + llround(uclk->drift * (double)(now - uclk->ref));
+    info->drift = (float)(uclk->drift * 1e6);
+    info->error = (float)uclk->error;
+    info->npoints = uclk->npoints;
+    info->synctime = uclk->synctime;
+    rv = 0;
+  }
+  pthread_mutex_unlock(&uclk->lock);
+  return rv;
+}
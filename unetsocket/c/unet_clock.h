@@ -0,0 +1,113 @@
+#ifndef _UNETCLOCK_H_
+#define _UNETCLOCK_H_
+
+#include "unet.h"
+
+typedef void *unet_clock_t;        ///< modem clock synchronizer
+
+/// State of the clock synchronization
+
+typedef struct {
+  long long offset;                ///< modem time less host time, now (us)
+  float drift;                     ///< rate of the modem clock relative to the host clock, less 1 (ppm)
+  float error;                     ///< bound on the error of the conversions, from the best round trip (us)
+  int npoints;                     ///< number of synchronization points in the estimate
+  long long synctime;              ///< host time of the last synchronization (us)
+} unet_clock_info_t;
+
+/// Number of requests per synchronization in unet_clock_sync()
+
+#define CLOCK_BURST              8
+
+/// Largest number of synchronization points used to estimate drift
+
+#define CLOCK_HISTORY            16
+
+/// Offset change beyond which the modem clock is taken to have been reset,
+/// and earlier synchronization points are discarded (us)
+
+#define CLOCK_STEP               1000000
+
+/// Open a clock synchronizer for the modem (physical layer) clock, which is
+/// the timebase of the rxTime and txTime fields of notifications and requests.
+/// Each synchronization reads the modem time several times, as
+/// unetsocket_ext_get_time() does, and keeps the reading with the shortest
+/// round trip, taking it to have been made halfway through, as NTP does.
+/// Offset and drift are then fitted to the recent synchronization points by
+/// least squares, weighted by the inverse square of their round trips.
+/// Conversions may be made from any thread while another synchronizes.
+/// Without a socket, the synchronizer is fed only by unet_clock_add().
+///
+/// @param sock             Unet socket, or NULL
+/// @return                 Clock synchronizer, or NULL on error
+
+unet_clock_t unet_clock_open(unetsocket_t sock);
+
+/// Close a clock synchronizer.
+///
+/// @param clk              Clock synchronizer
+
+void unet_clock_close(unet_clock_t clk);
+
+/// Synchronize with the modem clock. This should be repeated from time to
+/// time, more often for a host clock of poorer stability, to track drift.
+///
+/// @param clk              Clock synchronizer
+/// @return                 0 on success, -1 otherwise
+
+int unet_clock_sync(unet_clock_t clk);
+
+/// Add a synchronization point measured by other means, such as a modem time
+/// read with a known round trip or a pulse per second seen by both clocks.
+///
+/// @param clk              Clock synchronizer
+/// @param hosttime         Host time of the point (us)
+/// @param modemtime        Modem time at hosttime (us)
+/// @param rtt              Uncertainty of the point, as a round trip (us)
+/// @return                 0 on success, -1 otherwise
+
+int unet_clock_add(unet_clock_t clk, long long hosttime, long long modemtime, long long rtt);
+
+/// Get the current host time, in the timebase of the conversions. It is
+/// taken from a monotonic clock, so steps of the wall clock do not disturb
+/// synchronization.
+///
+/// @return                 Host time (us from an arbitrary origin)
+
+long long unet_clock_host_time(void);
+
+/// Convert a host time to modem time.
+///
+/// @param clk              Clock synchronizer
+/// @param hosttime         Host time (us), as from unet_clock_host_time()
+/// @param modemtime        Modem time (us)
+/// @return                 0 on success, -1 if not synchronized
+
+int unet_clock_to_modem(unet_clock_t clk, long long hosttime, long long *modemtime);
+
+/// Convert a modem time, such as the rxTime of a notification, to host time.
+///
+/// @param clk              Clock synchronizer
+/// @param modemtime        Modem time (us)
+/// @param hosttime         Host time (us), as from unet_clock_host_time()
+/// @return                 0 on success, -1 if not synchronized
+
+int unet_clock_to_host(unet_clock_t clk, long long modemtime, long long *hosttime);
+
+/// Estimate the current modem time without a request to the modem.
+///
+/// @param clk              Clock synchronizer
+/// @param modemtime        Modem time (us)
+/// @return                 0 on success, -1 if not synchronized
+
+int unet_clock_now(unet_clock_t clk, long long *modemtime);
+
+/// Get the state of the clock synchronization.
+///
+/// @param clk              Clock synchronizer
+/// @param info             State of the synchronization
+/// @return                 0 on success, -1 if not synchronized
+
+int unet_clock_get_info(unet_clock_t clk, unet_clock_info_t *info);
+
+#endif
@@ -0,0 +1,622 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "unet_conv.h"
+#include "unet_simd.h"
+#include "pthreadwindows.h"
+
+#define S16_SCALE                32767.0f
+#define S16_MAX                  32767.0f
+#define S16_MIN                  -32768.0f
+#define S24_SCALE                8388607.0f
+#define S24_MIN                  -8388608.0f
+#define S32_SCALE                2147483647.0f  // rounds to 2^31
+#define S32_LIMIT                2147483648.0f
+#define S32_MIN                  -2147483648.0f
+#define FLOAT_ONE                0x3F800000u    // bit pattern of 1.0f
+
+typedef void (*conv_s16_t)(int16_t *dst, const float *src, size_t n, uint32_t *seed);
+typedef void (*conv_from_s16_t)(float *dst, const int16_t *src, size_t n);
+typedef void (*conv_s24_t)(uint8_t *dst, const float *src, size_t n);
+typedef void (*conv_from_s24_t)(float *dst, const uint8_t *src, size_t n);
+typedef void (*conv_s32_t)(int32_t *dst, const float *src, size_t n);
+typedef void (*conv_from_s32_t)(float *dst, const int32_t *src, size_t n);
+typedef void (*conv_zip2_t)(float *dst, const float *a, const float *b, size_t n);
+typedef void (*conv_unzip2_t)(float *a, float *b, const float *src, size_t n);
+
+// kernels selected once by conv_init()
+static pthread_once_t conv_ready = PTHREAD_ONCE_INIT;
+static conv_s16_t conv_s16 = NULL;
+static conv_from_s16_t conv_from_s16 = NULL;
+static conv_s24_t conv_s24 = NULL;
+static conv_from_s24_t conv_from_s24 = NULL;
+static conv_s32_t conv_s32 = NULL;
+static conv_from_s32_t conv_from_s32 = NULL;
+static conv_zip2_t conv_zip2 = NULL;
+static conv_unzip2_t conv_unzip2 = NULL;
+
+// xorshift32 generator for dither; the state is never 0
+static uint32_t xorshift(uint32_t *s) {
+  uint32_t x = *s;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *s = x;
+  return x;
+}
+
+// uniform value in [1, 2) from the top bits of a random word
+static float uniform(uint32_t x) {
+  union { uint32_t u; float f; } v;
+  v.u = (x >> 9) | FLOAT_ONE;
+  return v.f;
+}
+
+// independent starting state for dither lane i
+static uint32_t lane_seed(uint32_t seed, unsigned int i) {
+  uint32_t z = seed + 0x9E3779B9u * (i + 1);
+  z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+  z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+  z ^= z >> 16;
+  return z | 1;
+}
+
+static int16_t to_s16(float v) {
+  if (isnan(v)) return 0;
+  if (v > S16_MAX) v = S16_MAX;
+  if (v < S16_MIN) v = S16_MIN;
+  return (int16_t)lrintf(v);
+}
+
+// a NULL seed converts without dither
+static void conv_s16_scalar(int16_t *dst, const float *src, size_t n, uint32_t *seed) {
+  if (seed == NULL) {
+    for (size_t i = 0; i < n; i++) dst[i] = to_s16(src[i] * S16_SCALE);
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    float d = uniform(xorshift(seed)) - uniform(xorshift(seed));
+    dst[i] = to_s16(src[i] * S16_SCALE + d);
+  }
+}
+
+static void conv_from_s16_scalar(float *dst, const int16_t *src, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] = (float)src[i] * (1.0f / S16_SCALE);
+}
+
+static int32_t to_s32(float v) {
+  if (isnan(v)) return 0;
+  if (v >= S32_LIMIT) return INT32_MAX;
+  if (v <= S32_MIN) return INT32_MIN;
+  return (int32_t)lrintf(v);
+}
+
+// 24-bit samples are packed little-endian in 3 bytes
+static void conv_s24_scalar(uint8_t *dst, const float *src, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    float v = src[i] * S24_SCALE;
+    if (v > S24_SCALE) v = S24_SCALE;
+    if (v < S24_MIN) v = S24_MIN;
+    uint32_t x = (uint32_t)to_s32(v);
+    dst[3 * i] = (uint8_t)x;
+    dst[3 * i + 1] = (uint8_t)(x >> 8);
+    dst[3 * i + 2] = (uint8_t)(x >> 16);
+  }
+}
+
+static void conv_from_s24_scalar(float *dst, const uint8_t *src, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    // assemble in the top 24 bits so that the arithmetic shift extends the sign
+    uint32_t x = (uint32_t)src[3 * i] << 8 | (uint32_t)src[3 * i + 1] << 16 | (uint32_t)src[3 * i + 2] << 24;
+    dst[i] = (float)((int32_t)x >> 8) * (1.0f / S24_SCALE);
+  }
+}
+
+static void conv_s32_scalar(int32_t *dst, const float *src, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] = to_s32(src[i] * S32_SCALE);
+}
+
+static void conv_from_s32_scalar(float *dst, const int32_t *src, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] = (float)src[i] * (1.0f / S32_SCALE);
+}
+
+static void conv_zip2_scalar(float *dst, const float *a, const float *b, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dst[2 * i] = a[i];
+    dst[2 * i + 1] = b[i];
+  }
+}
+
+static void conv_unzip2_scalar(float *a, float *b, const float *src, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    a[i] = src[2 * i];
+    b[i] = src[2 * i + 1];
+  }
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static __m128i xorshift_sse2(__m128i x) {
+  x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+  return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+UNET_TARGET("sse2")
+static __m128 dither_sse2(__m128i *s) {
+  __m128i one = _mm_set1_epi32((int)FLOAT_ONE);
+  __m128i a = xorshift_sse2(*s);
+  __m128i b = xorshift_sse2(a);
+  *s = b;
+  __m128 fa = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(a, 9), one));
+  __m128 fb = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(b, 9), one));
+  return _mm_sub_ps(fa, fb);
+}
+
+UNET_TARGET("sse2")
+static void conv_s16_sse2(int16_t *dst, const float *src, size_t n, uint32_t *seed) {
+  __m128 scale = _mm_set1_ps(S16_SCALE);
+  __m128 hi = _mm_set1_ps(S16_MAX);
+  __m128 lo = _mm_set1_ps(S16_MIN);
+  __m128i s = _mm_setzero_si128();
+  if (seed != NULL) s = _mm_set_epi32((int)lane_seed(*seed, 3), (int)lane_seed(*seed, 2), (int)lane_seed(*seed, 1), (int)lane_seed(*seed, 0));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+    if (seed != NULL) {
+      a = _mm_add_ps(a, dither_sse2(&s));
+      b = _mm_add_ps(b, dither_sse2(&s));
+    }
+    // zero NaNs and clamp before conversion, as out of range values
+    // convert to INT_MIN
+    a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+    b = _mm_and_ps(b, _mm_cmpord_ps(b, b));
+    a = _mm_min_ps(_mm_max_ps(a, lo), hi);
+    b = _mm_min_ps(_mm_max_ps(b, lo), hi);
+    __m128i p = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128((__m128i *)(void *)(dst + i), p);
+  }
+  if (seed != NULL) *seed = (uint32_t)_mm_cvtsi128_si32(s) | 1;
+  conv_s16_scalar(dst + i, src + i, n - i, seed);
+}
+
+UNET_TARGET("sse2")
+static void conv_from_s16_sse2(float *dst, const int16_t *src, size_t n) {
+  __m128 scale = _mm_set1_ps(1.0f / S16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(src + i));
+    // unpacking into the upper halves and shifting back extends the sign
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+  conv_from_s16_scalar(dst + i, src + i, n - i);
+}
+
+// convert 4 scaled samples to int32, saturating at both ends
+UNET_TARGET("sse2")
+static __m128i to_s32_sse2(__m128 a) {
+  a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+  a = _mm_max_ps(a, _mm_set1_ps(S32_MIN));
+  // values from 2^31 up convert to INT_MIN, which flips to INT_MAX
+  __m128i over = _mm_castps_si128(_mm_cmpge_ps(a, _mm_set1_ps(S32_LIMIT)));
+  return _mm_xor_si128(_mm_cvtps_epi32(a), over);
+}
+
+UNET_TARGET("sse2")
+static void conv_s32_sse2(int32_t *dst, const float *src, size_t n) {
+  __m128 scale = _mm_set1_ps(S32_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = to_s32_sse2(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+    __m128i b = to_s32_sse2(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+    _mm_storeu_si128((__m128i *)(void *)(dst + i), a);
+    _mm_storeu_si128((__m128i *)(void *)(dst + i + 4), b);
+  }
+  conv_s32_scalar(dst + i, src + i, n - i);
+}
+
+UNET_TARGET("sse2")
+static void conv_from_s32_sse2(float *dst, const int32_t *src, size_t n) {
+  __m128 scale = _mm_set1_ps(1.0f / S32_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(const void *)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(const void *)(src + i + 4));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+  }
+  conv_from_s32_scalar(dst + i, src + i, n - i);
+}
+
+UNET_TARGET("sse2")
+static void conv_zip2_sse2(float *dst, const float *a, const float *b, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(a + i);
+    __m128 y = _mm_loadu_ps(b + i);
+    _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(x, y));
+    _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(x, y));
+  }
+  conv_zip2_scalar(dst + 2 * i, a + i, b + i, n - i);
+}
+
+UNET_TARGET("sse2")
+static void conv_unzip2_sse2(float *a, float *b, const float *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(src + 2 * i);
+    __m128 y = _mm_loadu_ps(src + 2 * i + 4);
+    _mm_storeu_ps(a + i, _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(b + i, _mm_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  conv_unzip2_scalar(a + i, b + i, src + 2 * i, n - i);
+}
+
+// 24-bit samples are packed and unpacked 4 at a time with byte shuffles. Each
+// 16-byte load or store covers 12 bytes of samples, so the loops stop early
+// enough to keep the extra 4 bytes inside the buffer.
+
+UNET_TARGET("ssse3")
+static void conv_s24_ssse3(uint8_t *dst, const float *src, size_t n) {
+  __m128 scale = _mm_set1_ps(S24_SCALE);
+  __m128 hi = _mm_set1_ps(S24_SCALE);
+  __m128 lo = _mm_set1_ps(S24_MIN);
+  __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 4) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+    a = _mm_min_ps(_mm_max_ps(a, lo), hi);
+    __m128i p = _mm_shuffle_epi8(_mm_cvtps_epi32(a), pack);
+    _mm_storeu_si128((__m128i *)(void *)(dst + 3 * i), p);
+  }
+  conv_s24_scalar(dst + 3 * i, src + i, n - i);
+}
+
+UNET_TARGET("ssse3")
+static void conv_from_s24_ssse3(float *dst, const uint8_t *src, size_t n) {
+  __m128 scale = _mm_set1_ps(1.0f / S24_SCALE);
+  __m128i unpack = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(src + 3 * i));
+    x = _mm_srai_epi32(_mm_shuffle_epi8(x, unpack), 8);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+  }
+  conv_from_s24_scalar(dst + i, src + 3 * i, n - i);
+}
+
+UNET_TARGET("avx2")
+static __m256i xorshift_avx2(__m256i x) {
+  x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+  return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+UNET_TARGET("avx2")
+static __m256 dither_avx2(__m256i *s) {
+  __m256i one = _mm256_set1_epi32((int)FLOAT_ONE);
+  __m256i a = xorshift_avx2(*s);
+  __m256i b = xorshift_avx2(a);
+  *s = b;
+  __m256 fa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(a, 9), one));
+  __m256 fb = _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(b, 9), one));
+  return _mm256_sub_ps(fa, fb);
+}
+
+UNET_TARGET("avx2")
+static void conv_s16_avx2(int16_t *dst, const float *src, size_t n, uint32_t *seed) {
+  __m256 scale = _mm256_set1_ps(S16_SCALE);
+  __m256 hi = _mm256_set1_ps(S16_MAX);
+  __m256 lo = _mm256_set1_ps(S16_MIN);
+  __m256i s = _mm256_setzero_si256();
+  if (seed != NULL) {
+    int l[8];
+    for (unsigned int j = 0; j < 8; j++) l[j] = (int)lane_seed(*seed, j);
+    s = _mm256_set_epi32(l[7], l[6], l[5], l[4], l[3], l[2], l[1], l[0]);
+  }
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+    __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+    if (seed != NULL) {
+      a = _mm256_add_ps(a, dither_avx2(&s));
+      b = _mm256_add_ps(b, dither_avx2(&s));
+    }
+    a = _mm256_and_ps(a, _mm256_cmp_ps(a, a, _CMP_ORD_Q));
+    b = _mm256_and_ps(b, _mm256_cmp_ps(b, b, _CMP_ORD_Q));
+    a = _mm256_min_ps(_mm256_max_ps(a, lo), hi);
+    b = _mm256_min_ps(_mm256_max_ps(b, lo), hi);
+    // packs works within 128-bit lanes, so restore the sample order after it
+    __m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+    p = _mm256_permute4x64_epi64(p, 0xD8);
+    _mm256_storeu_si256((__m256i *)(void *)(dst + i), p);
+  }
+  if (seed != NULL) *seed = (uint32_t)_mm256_extract_epi32(s, 0) | 1;
+  conv_s16_scalar(dst + i, src + i, n - i, seed);
+}
+
+UNET_TARGET("avx2")
+static void conv_from_s16_avx2(float *dst, const int16_t *src, size_t n) {
+  __m256 scale = _mm256_set1_ps(1.0f / S16_SCALE);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(const void *)(src + i)));
+    __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(const void *)(src + i + 8)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), scale));
+    _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), scale));
+  }
+  conv_from_s16_scalar(dst + i, src + i, n - i);
+}
+
+UNET_TARGET("avx2")
+static void conv_s32_avx2(int32_t *dst, const float *src, size_t n) {
+  __m256 scale = _mm256_set1_ps(S32_SCALE);
+  __m256 lo = _mm256_set1_ps(S32_MIN);
+  __m256 limit = _mm256_set1_ps(S32_LIMIT);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+    a = _mm256_and_ps(a, _mm256_cmp_ps(a, a, _CMP_ORD_Q));
+    a = _mm256_max_ps(a, lo);
+    __m256i over = _mm256_castps_si256(_mm256_cmp_ps(a, limit, _CMP_GE_OQ));
+    _mm256_storeu_si256((__m256i *)(void *)(dst + i), _mm256_xor_si256(_mm256_cvtps_epi32(a), over));
+  }
+  conv_s32_scalar(dst + i, src + i, n - i);
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static uint32x4_t xorshift_neon(uint32x4_t x) {
+  x = veorq_u32(x, vshlq_n_u32(x, 13));
+  x = veorq_u32(x, vshrq_n_u32(x, 17));
+  return veorq_u32(x, vshlq_n_u32(x, 5));
+}
+
+static float32x4_t dither_neon(uint32x4_t *s) {
+  uint32x4_t one = vdupq_n_u32(FLOAT_ONE);
+  uint32x4_t a = xorshift_neon(*s);
+  uint32x4_t b = xorshift_neon(a);
+  *s = b;
+  float32x4_t fa = vreinterpretq_f32_u32(vorrq_u32(vshrq_n_u32(a, 9), one));
+  float32x4_t fb = vreinterpretq_f32_u32(vorrq_u32(vshrq_n_u32(b, 9), one));
+  return vsubq_f32(fa, fb);
+}
+
+static void conv_s16_neon(int16_t *dst, const float *src, size_t n, uint32_t *seed) {
+  float32x4_t scale = vdupq_n_f32(S16_SCALE);
+  uint32x4_t s = vdupq_n_u32(0);
+  if (seed != NULL) {
+    uint32_t l[4];
+    for (unsigned int j = 0; j < 4; j++) l[j] = lane_seed(*seed, j);
+    s = vld1q_u32(l);
+  }
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t a = vmulq_f32(vld1q_f32(src + i), scale);
+    float32x4_t b = vmulq_f32(vld1q_f32(src + i + 4), scale);
+    if (seed != NULL) {
+      a = vaddq_f32(a, dither_neon(&s));
+      b = vaddq_f32(b, dither_neon(&s));
+    }
+    // both the conversion and the narrowing saturate
+    int16x8_t p = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b)));
+    vst1q_s16(dst + i, p);
+  }
+  if (seed != NULL) *seed = vgetq_lane_u32(s, 0) | 1;
+  conv_s16_scalar(dst + i, src + i, n - i, seed);
+}
+
+static void conv_from_s16_neon(float *dst, const int16_t *src, size_t n) {
+  float32x4_t scale = vdupq_n_f32(1.0f / S16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t x = vld1q_s16(src + i);
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+  }
+  conv_from_s16_scalar(dst + i, src + i, n - i);
+}
+
+static void conv_s32_neon(int32_t *dst, const float *src, size_t n) {
+  float32x4_t scale = vdupq_n_f32(S32_SCALE);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    // the conversion saturates and maps NaN to 0
+    vst1q_s32(dst + i, vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale)));
+  }
+  conv_s32_scalar(dst + i, src + i, n - i);
+}
+
+static void conv_from_s32_neon(float *dst, const int32_t *src, size_t n) {
+  float32x4_t scale = vdupq_n_f32(1.0f / S32_SCALE);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(src + i)), scale));
+  conv_from_s32_scalar(dst + i, src + i, n - i);
+}
+
+// 16 samples are converted to int32 and their low 3 bytes stored as planes
+static void conv_s24_neon(uint8_t *dst, const float *src, size_t n) {
+  float32x4_t scale = vdupq_n_f32(S24_SCALE);
+  int32x4_t hi = vdupq_n_s32(8388607);
+  int32x4_t lo = vdupq_n_s32(-8388608);
+  int32_t tmp[16];
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    for (int j = 0; j < 16; j += 4) {
+      int32x4_t x = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i + (size_t)j), scale));
+      vst1q_s32(tmp + j, vminq_s32(vmaxq_s32(x, lo), hi));
+    }
+    uint8x16x4_t b = vld4q_u8((const uint8_t *)tmp);
+    uint8x16x3_t p;
+    p.val[0] = b.val[0];
+    p.val[1] = b.val[1];
+    p.val[2] = b.val[2];
+    vst3q_u8(dst + 3 * i, p);
+  }
+  conv_s24_scalar(dst + 3 * i, src + i, n - i);
+}
+
+static void conv_from_s24_neon(float *dst, const uint8_t *src, size_t n) {
+  float32x4_t scale = vdupq_n_f32(1.0f / S24_SCALE);
+  int32_t tmp[16];
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16x3_t p = vld3q_u8(src + 3 * i);
+    uint8x16x4_t b;
+    b.val[0] = vdupq_n_u8(0);
+    b.val[1] = p.val[0];
+    b.val[2] = p.val[1];
+    b.val[3] = p.val[2];
+    vst4q_u8((uint8_t *)tmp, b);
+    for (int j = 0; j < 16; j += 4) {
+      int32x4_t x = vshrq_n_s32(vld1q_s32(tmp + j), 8);
+      vst1q_f32(dst + i + (size_t)j, vmulq_f32(vcvtq_f32_s32(x), scale));
+    }
+  }
+  conv_from_s24_scalar(dst + i, src + 3 * i, n - i);
+}
+
+static void conv_zip2_neon(float *dst, const float *a, const float *b, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4x2_t x;
+    x.val[0] = vld1q_f32(a + i);
+    x.val[1] = vld1q_f32(b + i);
+    vst2q_f32(dst + 2 * i, x);
+  }
+  conv_zip2_scalar(dst + 2 * i, a + i, b + i, n - i);
+}
+
+static void conv_unzip2_neon(float *a, float *b, const float *src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4x2_t x = vld2q_f32(src + 2 * i);
+    vst1q_f32(a + i, x.val[0]);
+    vst1q_f32(b + i, x.val[1]);
+  }
+  conv_unzip2_scalar(a + i, b + i, src + 2 * i, n - i);
+}
+
+#endif
+
+static void conv_init(void) {
+  conv_s16 = conv_s16_scalar;
+  conv_from_s16 = conv_from_s16_scalar;
+  conv_s24 = conv_s24_scalar;
+  conv_from_s24 = conv_from_s24_scalar;
+  conv_s32 = conv_s32_scalar;
+  conv_from_s32 = conv_from_s32_scalar;
+  conv_zip2 = conv_zip2_scalar;
+  conv_unzip2 = conv_unzip2_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) {
+    conv_s16 = conv_s16_sse2;
+    conv_from_s16 = conv_from_s16_sse2;
+    conv_s32 = conv_s32_sse2;
+    conv_from_s32 = conv_from_s32_sse2;
+    conv_zip2 = conv_zip2_sse2;
+    conv_unzip2 = conv_unzip2_sse2;
+  }
+  if (UNET_HAS_SSSE3()) {
+    conv_s24 = conv_s24_ssse3;
+    conv_from_s24 = conv_from_s24_ssse3;
+  }
+  if (UNET_HAS_AVX2()) {
+    conv_s16 = conv_s16_avx2;
+    conv_from_s16 = conv_from_s16_avx2;
+    conv_s32 = conv_s32_avx2;
+  }
+#endif
+#ifdef UNET_SIMD_NEON
+  conv_s16 = conv_s16_neon;
+  conv_from_s16 = conv_from_s16_neon;
+  conv_s24 = conv_s24_neon;
+  conv_from_s24 = conv_from_s24_neon;
+  conv_s32 = conv_s32_neon;
+  conv_from_s32 = conv_from_s32_neon;
+  conv_zip2 = conv_zip2_neon;
+  conv_unzip2 = conv_unzip2_neon;
+#endif
+}
+
+void unet_conv_f32_s16(int16_t *dst, const float *src, size_t n) {
+  if (dst == NULL || src == NULL) return;
+  pthread_once(&conv_ready, conv_init);
+  conv_s16(dst, src, n, NULL);
+}
+
+void unet_conv_f32_s16_dither(int16_t *dst, const float *src, size_t n, uint32_t *seed) {
+  if (dst == NULL || src == NULL || seed == NULL) return;
+  if (*seed == 0) *seed = 1;
+  pthread_once(&conv_ready, conv_init);
+  conv_s16(dst, src, n, seed);
+}
+
+void unet_conv_s16_f32(float *dst, const int16_t *src, size_t n) {
+  if (dst == NULL || src == NULL) return;
+  pthread_once(&conv_ready, conv_init);
+  conv_from_s16(dst, src, n);
+}
+
+void unet_conv_f32_s24(uint8_t *dst, const float *src, size_t n) {
+  if (dst == NULL || src == NULL) return;
+  pthread_once(&conv_ready, conv_init);
+  conv_s24(dst, src, n);
+}
+
+void unet_conv_s24_f32(float *dst, const uint8_t *src, size_t n) {
+  if (dst == NULL || src == NULL) return;
+  pthread_once(&conv_ready, conv_init);
+  conv_from_s24(dst, src, n);
+}
+
+void unet_conv_f32_s32(int32_t *dst, const float *src, size_t n) {
+  if (dst == NULL || src == NULL) return;
+  pthread_once(&conv_ready, conv_init);
+  conv_s32(dst, src, n);
+}
+
+void unet_conv_s32_f32(float *dst, const int32_t *src, size_t n) {
+  if (dst == NULL || src == NULL) return;
+  pthread_once(&conv_ready, conv_init);
+  conv_from_s32(dst, src, n);
+}
+
+void unet_conv_interleave(float *dst, const float *const *src, int channels, size_t nframes) {
+  if (dst == NULL || src == NULL || channels <= 0) return;
+  pthread_once(&conv_ready, conv_init);
+  if (channels == 2 && src[0] != NULL && src[1] != NULL) {
+    conv_zip2(dst, src[0], src[1], nframes);
+    return;
+  }
+  size_t nch = (size_t)channels;
+  for (size_t c = 0; c < nch; c++) {
+    const float *s = src[c];
+    if (s == NULL) for (size_t i = 0; i < nframes; i++) dst[i * nch + c] = 0;
+    else for (size_t i = 0; i < nframes; i++) dst[i * nch + c] = s[i];
+  }
+}
+
+void unet_conv_deinterleave(float *const *dst, const float *src, int channels, size_t nframes) {
+  if (dst == NULL || src == NULL || channels <= 0) return;
+  pthread_once(&conv_ready, conv_init);
+  if (channels == 2 && dst[0] != NULL && dst[1] != NULL) {
+    conv_unzip2(dst[0], dst[1], src, nframes);
+    return;
+  }
+  size_t nch = (size_t)channels;
+  for (size_t c = 0; c < nch; c++) {
+    float *d = dst[c];
+    if (d == NULL) continue;
+    for (size_t i = 0; i < nframes; i++) d[i] = src[i * nch + c];
+  }
+}
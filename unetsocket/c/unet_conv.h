@@ -0,0 +1,96 @@
+#ifndef _UNETCONV_H_
+#define _UNETCONV_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample conversion between floats in the range [-1, 1] and the integer
+// formats of WAV files. Full scale maps to the largest positive integer, so
+// conversions in both directions use the same scale. NaNs convert to 0. The
+// kernels use SSE2/SSSE3/AVX2 or NEON when available, selected at run time.
+
+/// Convert samples in the range [-1, 1] to 16-bit integers, rounding to the
+/// nearest integer and saturating out of range values.
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert
+/// @param n                Number of samples
+
+void unet_conv_f32_s16(int16_t *dst, const float *src, size_t n);
+
+/// Convert samples in the range [-1, 1] to 16-bit integers with triangular
+/// (TPDF) dither of +/-1 LSB, which decorrelates the quantization error from
+/// weak signals.
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert
+/// @param n                Number of samples
+/// @param seed             Dither generator state, updated so that successive
+///                         calls continue the dither sequence (must not be 0)
+
+void unet_conv_f32_s16_dither(int16_t *dst, const float *src, size_t n, uint32_t *seed);
+
+/// Convert 16-bit integer samples to floats, the inverse of
+/// unet_conv_f32_s16().
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert
+/// @param n                Number of samples
+
+void unet_conv_s16_f32(float *dst, const int16_t *src, size_t n);
+
+/// Convert samples in the range [-1, 1] to 24-bit integers, packed in 3 bytes
+/// each in little-endian order as in WAV files, rounding to the nearest
+/// integer and saturating out of range values.
+///
+/// @param dst              Converted samples (3n bytes)
+/// @param src              Samples to convert
+/// @param n                Number of samples
+
+void unet_conv_f32_s24(uint8_t *dst, const float *src, size_t n);
+
+/// Convert packed little-endian 24-bit integer samples to floats.
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert (3n bytes)
+/// @param n                Number of samples
+
+void unet_conv_s24_f32(float *dst, const uint8_t *src, size_t n);
+
+/// Convert samples in the range [-1, 1] to 32-bit integers, rounding to the
+/// nearest representable value and saturating out of range values.
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert
+/// @param n                Number of samples
+
+void unet_conv_f32_s32(int32_t *dst, const float *src, size_t n);
+
+/// Convert 32-bit integer samples to floats.
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert
+/// @param n                Number of samples
+
+void unet_conv_s32_f32(float *dst, const int32_t *src, size_t n);
+
+/// Interleave separate channels into frames. A NULL channel is filled with
+/// zeros.
+///
+/// @param dst              Interleaved samples (channels * nframes)
+/// @param src              Samples of each channel
+/// @param channels         Number of channels
+/// @param nframes          Number of frames
+
+void unet_conv_interleave(float *dst, const float *const *src, int channels, size_t nframes);
+
+/// Split interleaved frames into separate channels. A NULL channel is skipped.
+///
+/// @param dst              Samples of each channel
+/// @param src              Interleaved samples (channels * nframes)
+/// @param channels         Number of channels
+/// @param nframes          Number of frames
+
+void unet_conv_deinterleave(float *const *dst, const float *src, int channels, size_t nframes);
+
+#endif
@@ -0,0 +1,276 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_corr.h"
+#include "unet_fft.h"
+#include "unet_conv.h"
+#include "unet_dsp.h"
+#include <string.h>
+#include <math.h>
+
+#define CORR_BLOCK               8      // FFT size over the largest reference length, so most lags in a block are clear of any peak
+#define CORR_LN2                 0.69314718f
+
+typedef struct {
+  float *rr;                         // spectrum of the reference
+  float *ri;
+  float energy;
+  int holdoff;                       // lags within which only the largest peak is reported
+  float lastp;                       // correlation power at the lag before the current block
+  bool pending;                      // candidate peak waiting for its holdoff to pass
+  long long lag;
+  float p, prev, next;               // power at the candidate and its neighbours
+  float snr;
+} _corr_ref_t;
+
+typedef struct {
+  float fs;
+  bool complex;
+  int maxlen;
+  int n;                             // FFT size
+  int hop;                           // new lags correlated per block
+  unet_fft_t fft;
+  float *xr;                         // input: maxlen - 1 samples of the previous block, then new
+  float *xi;
+  int fill;
+  long long start;                   // stream index of the first sample in x
+  float *wr;                         // input spectrum
+  float *wi;
+  float *yr;                         // correlation
+  float *yi;
+  float *pw;                         // correlation power
+  _corr_ref_t ref[CORR_MAXREFS];
+  int nrefs;
+  float threshold;                   // power ratio
+  long long refidx;                  // stream index of a sample with known time
+  long long reftime;
+  unet_detection_sink_t sink;
+  void *ctx;
+} _unet_corr_t;
+
+unet_corr_t unet_corr_create(float fs, float fc, int maxlen, unet_detection_sink_t sink, void *ctx) {
+  if (fs <= 0 || fc < 0 || maxlen < 1 || sink == NULL) return NULL;
+  int n = CORR_MINFFT;
+  while (n < CORR_BLOCK * maxlen && n <= FFT_MAXSIZE / 2) n *= 2;
+  if (n < 2 * maxlen) return NULL;
+  _unet_corr_t *corr = calloc(1, sizeof(_unet_corr_t));
+  if (corr == NULL) return NULL;
+  corr->fs = fs;
+  corr->complex = fc > 0;
+  corr->maxlen = maxlen;
+  corr->n = n;
+  corr->hop = n - maxlen + 1;
+  corr->threshold = powf(10.0f, CORR_THRESHOLD / 10);
+  corr->sink = sink;
+  corr->ctx = ctx;
+  corr->fft = unet_fft_create(n);
+  bool ok = corr->fft != NULL;
+  float **bufs[] = { &corr->xr, &corr->xi, &corr->wr, &corr->wi, &corr->yr, &corr->yi, &corr->pw };
+  for (size_t i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++) {
+    *bufs[i] = calloc((size_t)n, sizeof(float));
+    if (*bufs[i] == NULL) ok = false;
+  }
+  if (!ok) {
+    unet_corr_destroy(corr);
+    return NULL;
+  }
+  return corr;
+}
+
+void unet_corr_destroy(unet_corr_t corr) {
+  if (corr == NULL) return;
+  _unet_corr_t *ucorr = corr;
+  for (int i = 0; i < ucorr->nrefs; i++) {
+    free(ucorr->ref[i].rr);
+    free(ucorr->ref[i].ri);
+  }
+  unet_fft_destroy(ucorr->fft);
+  free(ucorr->xr);
+  free(ucorr->xi);
+  free(ucorr->wr);
+  free(ucorr->wi);
+  free(ucorr->yr);
+  free(ucorr->yi);
+  free(ucorr->pw);
+  free(ucorr);
+}
+
+// copy samples into separate real and imaginary parts, zeros for NULL
+static void split(_unet_corr_t *corr, float *re, float *im, const float *signal, int n) {
+  if (signal == NULL) {
+    memset(re, 0, sizeof(float) * (size_t)n);
+    memset(im, 0, sizeof(float) * (size_t)n);
+  } else if (corr->complex) {
+    float *chans[2] = { re, im };
+    unet_conv_deinterleave(chans, signal, 2, (size_t)n);
+  } else {
+    memcpy(re, signal, sizeof(float) * (size_t)n);
+    memset(im, 0, sizeof(float) * (size_t)n);
+  }
+}
+
+int unet_corr_add(unet_corr_t corr, const float *ref, int nsamples) {
+  if (corr == NULL || ref == NULL || nsamples < 1) return -1;
+  _unet_corr_t *ucorr = corr;
+  if (nsamples > ucorr->maxlen || ucorr->nrefs >= CORR_MAXREFS) return -1;
+  _corr_ref_t *r = &ucorr->ref[ucorr->nrefs];
+  memset(r, 0, sizeof(_corr_ref_t));
+  r->rr = calloc((size_t)ucorr->n, sizeof(float));
+  r->ri = calloc((size_t)ucorr->n, sizeof(float));
+  if (r->rr == NULL || r->ri == NULL) {
+    free(r->rr);
+    free(r->ri);
+    return -1;
+  }
+  split(ucorr, r->rr, r->ri, ref, nsamples);
+  double e = 0;
+  for (int i = 0; i < nsamples; i++) e += (double)r->rr[i] * r->rr[i] + (double)r->ri[i] * r->ri[i];
+  if (e <= 0) {
+    free(r->rr);
+    free(r->ri);
+    return -1;
+  }
+  r->energy = (float)e;
+  r->holdoff = nsamples > 2 ? nsamples : 2;
+  unet_fft_forward(ucorr->fft, r->rr, r->ri);
+  if (!ucorr->complex) {
+    // correlate passband signals against the analytic reference, so that the
+    // correlation power is the envelope rather than oscillating at the carrier
+    int n = ucorr->n;
+    for (int k = 1; k < n / 2; k++) {
+      r->rr[k] *= 2;
+      r->ri[k] *= 2;
+    }
+    memset(r->rr + n / 2 + 1, 0, sizeof(float) * (size_t)(n / 2 - 1));
+    memset(r->ri + n / 2 + 1, 0, sizeof(float) * (size_t)(n / 2 - 1));
+  }
+  return ucorr->nrefs++;
+}
+
+int unet_corr_set_threshold(unet_corr_t corr, float threshold) {
+  if (corr == NULL) return -1;
+  ((_unet_corr_t *)corr)->threshold = powf(10.0f, threshold / 10);
+  return 0;
+}
+
+// a lag is scanned once the block holding a full reference after it is
+// complete, and a peak is reported once the lags in its holdoff are scanned
+int unet_corr_latency(unet_corr_t corr) {
+  if (corr == NULL) return -1;
+  _unet_corr_t *ucorr = corr;
+  return ucorr->n + ucorr->maxlen;
+}
+
+// report a candidate peak, interpolating its position from its neighbours
+static int report(_unet_corr_t *corr, int i) {
+  _corr_ref_t *r = &corr->ref[i];
+  r->pending = false;
+  double d = 0;
+  if (r->next >= 0) {
+    double a = sqrt(r->prev), b = sqrt(r->p), c = sqrt(r->next);
+    double den = a - 2 * b + c;
+    if (den < 0) d = 0.5 * (a - c) / den;
+    if (d < -0.5) d = -0.5;
+    if (d > 0.5) d = 0.5;
+  }
+  unet_detection_t det;
+  det.ref = i;
+  det.sample = r->lag;
+  det.time = corr->reftime + llround(((double)(r->lag - corr->refidx) + d) * 1e6 / corr->fs);
+  det.peak = sqrtf(r->p) / r->energy;
+  det.snr = r->snr;
+  return corr->sink(corr->ctx, &det);
+}
+
+// find peaks in the correlation power of the lags from start
+static int scan(_unet_corr_t *corr, int i, float noise) {
+  _corr_ref_t *r = &corr->ref[i];
+  float thr = corr->threshold * noise;
+  for (int k = 0; k < corr->hop; k++) {
+    long long lag = corr->start + k;
+    float p = corr->pw[k];
+    if (r->pending && lag == r->lag + 1) r->next = p;
+    if (r->pending && lag - r->lag >= r->holdoff) {
+      // a candidate on the falling edge of an earlier peak is not a peak
+      if (r->p < r->prev) r->pending = false;
+      else {
+        int rv = report(corr, i);
+        if (rv != 0) return rv;
+      }
+    }
+    if (p > thr && noise > 0 && (!r->pending || p > r->p)) {
+      r->pending = true;
+      r->lag = lag;
+      r->p = p;
+      r->prev = k > 0 ? corr->pw[k - 1] : r->lastp;
+      r->next = -1;
+      r->snr = 10 * log10f(p / noise);
+    }
+  }
+  r->lastp = corr->pw[corr->hop - 1];
+  return 0;
+}
+
+// correlate a full block against every reference
+static int correlate(_unet_corr_t *corr) {
+  int n = corr->n;
+  memcpy(corr->wr, corr->xr, sizeof(float) * (size_t)n);
+  memcpy(corr->wi, corr->xi, sizeof(float) * (size_t)n);
+  unet_fft_forward(corr->fft, corr->wr, corr->wi);
+  for (int i = 0; i < corr->nrefs; i++) {
+    unet_cmulc(corr->yr, corr->yi, corr->wr, corr->wi, corr->ref[i].rr, corr->ref[i].ri, n);
+    unet_fft_inverse(corr->fft, corr->yr, corr->yi);
+    double sum = 0;
+    for (int k = 0; k < corr->hop; k++) {
+      corr->pw[k] = corr->yr[k] * corr->yr[k] + corr->yi[k] * corr->yi[k];
+      sum += corr->pw[k];
+    }
+    // The noise power is estimated from the median, which unlike the mean is
+    // not raised by the correlation peaks themselves. Noise correlation power
+    // is exponentially distributed, with its median ln 2 times its mean. The
+    // mean is used for blocks that are mostly silent.
+    memcpy(corr->yr, corr->pw, sizeof(float) * (size_t)corr->hop);
+    float noise = unet_select_kth(corr->yr, corr->hop, corr->hop / 2) / CORR_LN2;
+    if (noise <= 0) noise = (float)(sum / corr->hop);
+    int rv = scan(corr, i, noise);
+    if (rv != 0) return rv;
+  }
+  return 0;
+}
+
+static int feed(_unet_corr_t *corr, const float *signal, long long nsamples) {
+  int stride = corr->complex ? 2 : 1;
+  while (nsamples > 0) {
+    int k = corr->n - corr->fill;
+    if (k > nsamples) k = (int)nsamples;
+    split(corr, corr->xr + corr->fill, corr->xi + corr->fill, signal, k);
+    if (signal != NULL) signal += (size_t)k * (size_t)stride;
+    nsamples -= k;
+    corr->fill += k;
+    if (corr->fill < corr->n) break;
+    int rv = correlate(corr);
+    if (rv != 0) return rv;
+    int keep = corr->maxlen - 1;
+    memmove(corr->xr, corr->xr + corr->hop, sizeof(float) * (size_t)keep);
+    memmove(corr->xi, corr->xi + corr->hop, sizeof(float) * (size_t)keep);
+    corr->fill = keep;
+    corr->start += corr->hop;
+  }
+  return 0;
+}
+
+int unet_corr_process(unet_corr_t corr, const float *signal, int nsamples) {
+  if (corr == NULL || signal == NULL || nsamples < 0) return -1;
+  return feed(corr, signal, nsamples);
+}
+
+int unet_corr_block(void *ctx, const unet_block_t *blk) {
+  _unet_corr_t *corr = ctx;
+  if (corr == NULL || blk == NULL || corr->complex != (blk->fc > 0)) return 1;
+  if (blk->gap > 0) {
+    int rv = feed(corr, NULL, blk->gap);
+    if (rv != 0) return rv;
+  }
+  corr->refidx = corr->start + corr->fill;
+  corr->reftime = blk->rxtime;
+  return feed(corr, blk->signal, blk->nsamples);
+}
@@ -0,0 +1,108 @@
+#ifndef _UNETCORR_H_
+#define _UNETCORR_H_
+
+#include "unet_stream.h"
+
+typedef void *unet_corr_t;         ///< streaming matched filter
+
+/// Detection of a reference signal
+
+typedef struct {
+  int ref;                         ///< index of the reference signal
+  long long sample;                ///< index of the first sample of the match in the stream
+  long long time;                  ///< arrival time in modem time, interpolated between samples (us)
+  float peak;                      ///< correlation peak over the reference energy, the amplitude of the match
+  float snr;                       ///< peak correlation power over the noise power of the block (dB)
+} unet_detection_t;
+
+/// Detection sink, called for each detection. A non-zero return value stops
+/// the correlator's signal source.
+
+typedef int (*unet_detection_sink_t)(void *ctx, const unet_detection_t *det);
+
+/// Largest number of reference signals
+
+#define CORR_MAXREFS             16
+
+/// Smallest FFT size
+
+#define CORR_MINFFT              1024
+
+/// Default detection threshold (dB)
+
+#define CORR_THRESHOLD           15.0f
+
+/// Create a streaming matched filter. The signal is correlated against each
+/// reference in overlapping FFT blocks (overlap-save), with the reference
+/// spectra computed once. A detection is reported at each correlation peak
+/// whose power exceeds the threshold times the noise power of its block, and
+/// that is the largest within one reference length.
+///
+/// @param fs               Sampling rate (Hz)
+/// @param fc               Carrier frequency for baseband signals, 0 for
+///                         passband signals (Hz)
+/// @param maxlen           Largest length of a reference signal (samples)
+/// @param sink             Detection sink
+/// @param ctx              User context passed to the sink
+/// @return                 Matched filter, or NULL on error
+
+unet_corr_t unet_corr_create(float fs, float fc, int maxlen, unet_detection_sink_t sink, void *ctx);
+
+/// Destroy a matched filter.
+///
+/// @param corr             Matched filter
+
+void unet_corr_destroy(unet_corr_t corr);
+
+/// Add a reference signal to detect, in the same form as the input: real for
+/// passband, and alternating real and imaginary values for baseband. Signals
+/// from the unet_siggen.h generators can be used directly.
+///
+/// @param corr             Matched filter
+/// @param ref              Reference signal
+/// @param nsamples         Number of samples, up to maxlen
+/// @return                 Index of the reference, -1 on error
+
+int unet_corr_add(unet_corr_t corr, const float *ref, int nsamples);
+
+/// Set the detection threshold.
+///
+/// @param corr             Matched filter
+/// @param threshold        Ratio of peak to noise correlation power (dB)
+/// @return                 0 on success, -1 otherwise
+
+int unet_corr_set_threshold(unet_corr_t corr, float threshold);
+
+/// Get the largest delay between feeding a sample to a matched filter and the
+/// report of a match that starts at that sample. Once this many more samples
+/// have been fed, every match up to that sample has been reported.
+///
+/// @param corr             Matched filter
+/// @return                 Delay in samples, -1 on error
+
+int unet_corr_latency(unet_corr_t corr);
+
+/// Feed a block of a continuous signal to a matched filter. Detection times
+/// count from the time of the last block passed to unet_corr_block(), or from
+/// 0 at the start of the stream.
+///
+/// @param corr             Matched filter
+/// @param signal           Signal samples
+/// @param nsamples         Number of samples (complex samples for baseband)
+/// @return                 0 to continue, non-zero if the detection sink
+///                         asked to stop, -1 on error
+
+int unet_corr_process(unet_corr_t corr, const float *signal, int nsamples);
+
+/// Block sink that feeds a signal block to a matched filter, for use with
+/// unetsocket_ext_pbstream() or unetsocket_ext_bbstream(). Gaps are filled
+/// with zeros.
+///
+/// @param ctx              Matched filter
+/// @param blk              Signal block
+/// @return                 0 to continue, non-zero if the detection sink
+///                         asked to stop or on error
+
+int unet_corr_block(void *ctx, const unet_block_t *blk);
+
+#endif
@@ -0,0 +1,475 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_ddc.h"
+#include "unet_conv.h"
+#include "unet_simd.h"
+#include "unet_dsp.h"
+#include "pthreadwindows.h"
+#include <string.h>
+#include <math.h>
+
+#define DDC_MAXFACTOR            8      // largest decimation factor of a stage
+#define DDC_ALIGN                8      // filter taps are a multiple of this
+#define DDC_LANES                8      // oscillator phasors advanced together
+#define DDC_NCO_SEED             256    // samples between exact oscillator updates
+#define DDC_PI                   3.14159265358979323846
+
+typedef void (*mix_t)(float *xi, float *xq, const float *x, int n, const float *cr, const float *ci, float sr, float si);
+typedef void (*dot2_t)(const float *h, const float *xi, const float *xq, int n, float *yi, float *yq);
+
+static pthread_once_t ddc_ready = PTHREAD_ONCE_INIT;
+static mix_t mix = NULL;
+static dot2_t dot2 = NULL;
+
+typedef struct {
+  int factor;
+  int taps;
+  float *h;                          // low-pass filter (symmetric)
+  float *xi;                         // history followed by new input
+  float *xq;
+  int xlen;
+  int base;                          // index in x of the oldest sample for the next output
+} _ddc_stage_t;
+
+typedef struct {
+  float fs;
+  float fc;
+  float outrate;
+  int decim;
+  double delay;
+  int nstages;
+  _ddc_stage_t stage[DDC_MAXSTAGES];
+  double phase;                      // oscillator phase of the next input (cycles)
+  float *yi;                         // output of the last stage
+  float *yq;
+  long long nout;                    // output samples since reset
+  // block sink adapter
+  unet_block_sink_t sink;
+  void *sinkctx;
+  float *blkout;
+  int blkcap;
+  long long reftime;                 // time of the first block since the filters restarted
+  bool started;
+  unsigned long long seq;
+} _unet_ddc_t;
+
+// Mixing multiplies by DDC_LANES phasors, one per sample in a group, which
+// all advance by the same rotation (sr, si) from one group to the next.
+
+static void mix_scalar(float *xi, float *xq, const float *x, int n, const float *cr, const float *ci, float sr, float si) {
+  float r[DDC_LANES], q[DDC_LANES];
+  memcpy(r, cr, sizeof(r));
+  memcpy(q, ci, sizeof(q));
+  for (int i = 0; i < n; i += DDC_LANES) {
+    for (int l = 0; l < DDC_LANES && i + l < n; l++) {
+      xi[i + l] = x[i + l] * r[l];
+      xq[i + l] = x[i + l] * q[l];
+      float t = r[l] * sr - q[l] * si;
+      q[l] = r[l] * si + q[l] * sr;
+      r[l] = t;
+    }
+  }
+}
+
+// filter complex samples held as separate real and imaginary parts
+static void dot2_scalar(const float *h, const float *xi, const float *xq, int n, float *yi, float *yq) {
+  float si0 = 0, si1 = 0, sq0 = 0, sq1 = 0;
+  for (int i = 0; i < n; i += 2) {
+    si0 += h[i] * xi[i];
+    si1 += h[i + 1] * xi[i + 1];
+    sq0 += h[i] * xq[i];
+    sq1 += h[i + 1] * xq[i + 1];
+  }
+  *yi = si0 + si1;
+  *yq = sq0 + sq1;
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static void mix_sse2(float *xi, float *xq, const float *x, int n, const float *cr, const float *ci, float sr, float si) {
+  __m128 r0 = _mm_loadu_ps(cr), r1 = _mm_loadu_ps(cr + 4);
+  __m128 q0 = _mm_loadu_ps(ci), q1 = _mm_loadu_ps(ci + 4);
+  __m128 vsr = _mm_set1_ps(sr), vsi = _mm_set1_ps(si);
+  int i = 0;
+  for (; i + DDC_LANES <= n; i += DDC_LANES) {
+    __m128 a = _mm_loadu_ps(x + i), b = _mm_loadu_ps(x + i + 4);
+    _mm_storeu_ps(xi + i, _mm_mul_ps(a, r0));
+    _mm_storeu_ps(xi + i + 4, _mm_mul_ps(b, r1));
+    _mm_storeu_ps(xq + i, _mm_mul_ps(a, q0));
+    _mm_storeu_ps(xq + i + 4, _mm_mul_ps(b, q1));
+    __m128 t0 = _mm_sub_ps(_mm_mul_ps(r0, vsr), _mm_mul_ps(q0, vsi));
+    __m128 t1 = _mm_sub_ps(_mm_mul_ps(r1, vsr), _mm_mul_ps(q1, vsi));
+    q0 = _mm_add_ps(_mm_mul_ps(r0, vsi), _mm_mul_ps(q0, vsr));
+    q1 = _mm_add_ps(_mm_mul_ps(r1, vsi), _mm_mul_ps(q1, vsr));
+    r0 = t0;
+    r1 = t1;
+  }
+  if (i < n) {
+    float r[DDC_LANES], q[DDC_LANES];
+    _mm_storeu_ps(r, r0);
+    _mm_storeu_ps(r + 4, r1);
+    _mm_storeu_ps(q, q0);
+    _mm_storeu_ps(q + 4, q1);
+    mix_scalar(xi + i, xq + i, x + i, n - i, r, q, sr, si);
+  }
+}
+
+UNET_TARGET("sse2")
+static void dot2_sse2(const float *h, const float *xi, const float *xq, int n, float *yi, float *yq) {
+  __m128 si = _mm_setzero_ps(), sq = _mm_setzero_ps();
+  for (int i = 0; i < n; i += 4) {
+    __m128 c = _mm_loadu_ps(h + i);
+    si = _mm_add_ps(si, _mm_mul_ps(c, _mm_loadu_ps(xi + i)));
+    sq = _mm_add_ps(sq, _mm_mul_ps(c, _mm_loadu_ps(xq + i)));
+  }
+  float a[4], b[4];
+  _mm_storeu_ps(a, si);
+  _mm_storeu_ps(b, sq);
+  *yi = (a[0] + a[1]) + (a[2] + a[3]);
+  *yq = (b[0] + b[1]) + (b[2] + b[3]);
+}
+
+UNET_TARGET("avx2")
+static void mix_avx2(float *xi, float *xq, const float *x, int n, const float *cr, const float *ci, float sr, float si) {
+  __m256 r = _mm256_loadu_ps(cr), q = _mm256_loadu_ps(ci);
+  __m256 vsr = _mm256_set1_ps(sr), vsi = _mm256_set1_ps(si);
+  int i = 0;
+  for (; i + DDC_LANES <= n; i += DDC_LANES) {
+    __m256 a = _mm256_loadu_ps(x + i);
+    _mm256_storeu_ps(xi + i, _mm256_mul_ps(a, r));
+    _mm256_storeu_ps(xq + i, _mm256_mul_ps(a, q));
+    __m256 t = _mm256_sub_ps(_mm256_mul_ps(r, vsr), _mm256_mul_ps(q, vsi));
+    q = _mm256_add_ps(_mm256_mul_ps(r, vsi), _mm256_mul_ps(q, vsr));
+    r = t;
+  }
+  if (i < n) {
+    float rr[DDC_LANES], qq[DDC_LANES];
+    _mm256_storeu_ps(rr, r);
+    _mm256_storeu_ps(qq, q);
+    mix_scalar(xi + i, xq + i, x + i, n - i, rr, qq, sr, si);
+  }
+}
+
+UNET_TARGET("avx2")
+static void dot2_avx2(const float *h, const float *xi, const float *xq, int n, float *yi, float *yq) {
+  __m256 si = _mm256_setzero_ps(), sq = _mm256_setzero_ps();
+  for (int i = 0; i < n; i += 8) {
+    __m256 c = _mm256_loadu_ps(h + i);
+    si = _mm256_add_ps(si, _mm256_mul_ps(c, _mm256_loadu_ps(xi + i)));
+    sq = _mm256_add_ps(sq, _mm256_mul_ps(c, _mm256_loadu_ps(xq + i)));
+  }
+  // reduce both sums at once: (i0..3 + i4..7) and (q0..3 + q4..7) side by side
+  __m128 a = _mm_add_ps(_mm256_castps256_ps128(si), _mm256_extractf128_ps(si, 1));
+  __m128 b = _mm_add_ps(_mm256_castps256_ps128(sq), _mm256_extractf128_ps(sq, 1));
+  __m128 s = _mm_add_ps(_mm_unpacklo_ps(a, b), _mm_unpackhi_ps(a, b));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  float out[4];
+  _mm_storeu_ps(out, s);
+  *yi = out[0];
+  *yq = out[1];
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static void mix_neon(float *xi, float *xq, const float *x, int n, const float *cr, const float *ci, float sr, float si) {
+  float32x4_t r0 = vld1q_f32(cr), r1 = vld1q_f32(cr + 4);
+  float32x4_t q0 = vld1q_f32(ci), q1 = vld1q_f32(ci + 4);
+  int i = 0;
+  for (; i + DDC_LANES <= n; i += DDC_LANES) {
+    float32x4_t a = vld1q_f32(x + i), b = vld1q_f32(x + i + 4);
+    vst1q_f32(xi + i, vmulq_f32(a, r0));
+    vst1q_f32(xi + i + 4, vmulq_f32(b, r1));
+    vst1q_f32(xq + i, vmulq_f32(a, q0));
+    vst1q_f32(xq + i + 4, vmulq_f32(b, q1));
+    float32x4_t t0 = vmlsq_n_f32(vmulq_n_f32(r0, sr), q0, si);
+    float32x4_t t1 = vmlsq_n_f32(vmulq_n_f32(r1, sr), q1, si);
+    q0 = vmlaq_n_f32(vmulq_n_f32(q0, sr), r0, si);
+    q1 = vmlaq_n_f32(vmulq_n_f32(q1, sr), r1, si);
+    r0 = t0;
+    r1 = t1;
+  }
+  if (i < n) {
+    float r[DDC_LANES], q[DDC_LANES];
+    vst1q_f32(r, r0);
+    vst1q_f32(r + 4, r1);
+    vst1q_f32(q, q0);
+    vst1q_f32(q + 4, q1);
+    mix_scalar(xi + i, xq + i, x + i, n - i, r, q, sr, si);
+  }
+}
+
+static void dot2_neon(const float *h, const float *xi, const float *xq, int n, float *yi, float *yq) {
+  float32x4_t si = vdupq_n_f32(0), sq = vdupq_n_f32(0);
+  for (int i = 0; i < n; i += 4) {
+    float32x4_t c = vld1q_f32(h + i);
+    si = vfmaq_f32(si, c, vld1q_f32(xi + i));
+    sq = vfmaq_f32(sq, c, vld1q_f32(xq + i));
+  }
+  *yi = vaddvq_f32(si);
+  *yq = vaddvq_f32(sq);
+}
+
+#endif
+
+static void ddc_init(void) {
+  mix = mix_scalar;
+  dot2 = dot2_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) {
+    mix = mix_sse2;
+    dot2 = dot2_sse2;
+  }
+  if (UNET_HAS_AVX2()) {
+    mix = mix_avx2;
+    dot2 = dot2_avx2;
+  }
+#endif
+#ifdef UNET_SIMD_NEON
+  mix = mix_neon;
+  dot2 = dot2_neon;
+#endif
+}
+
+// largest decimation factor up to d that splits into stages of DDC_MAXFACTOR
+// or less, with the stage factors in decreasing order
+static int factorize(int d, int *factors, int *nfactors) {
+  for (; d > 1; d--) {
+    int rem = d, n = 0;
+    while (rem > 1 && n < DDC_MAXSTAGES) {
+      int f = DDC_MAXFACTOR;
+      while (f > 1 && rem % f != 0) f--;
+      if (f == 1) break;
+      factors[n++] = f;
+      rem /= f;
+    }
+    if (rem == 1) {
+      *nfactors = n;
+      return d;
+    }
+  }
+  factors[0] = 1;
+  *nfactors = 1;
+  return 1;
+}
+
+// Kaiser-windowed sinc low-pass for a stage from rate fs to fs / factor, which
+// passes the band up to pass and rejects everything that would alias into it.
+// The filter is symmetric, so it needs no reversal for the dot product.
+static int design(_ddc_stage_t *s, double fs, double pass) {
+  double fout = fs / s->factor;
+  double width = (fout - 2 * pass) / fs;
+  double beta = 0.1102 * (DDC_ATTEN - 8.7);
+  int taps = (int)ceil((DDC_ATTEN - 8) / (2.285 * 2 * DDC_PI * width)) + 1;
+  if (taps < s->factor) taps = s->factor;
+  s->taps = (taps + DDC_ALIGN - 1) / DDC_ALIGN * DDC_ALIGN;
+  s->h = malloc(sizeof(float) * (size_t)s->taps);
+  s->xi = malloc(sizeof(float) * (size_t)(s->taps + DDC_BLK));
+  s->xq = malloc(sizeof(float) * (size_t)(s->taps + DDC_BLK));
+  if (s->h == NULL || s->xi == NULL || s->xq == NULL) return -1;
+  double fc = 0.5 * fout / fs;
+  double center = (s->taps - 1) / 2.0;
+  double i0beta = unet_bessel_i0(beta);
+  double sum = 0;
+  for (int i = 0; i < s->taps; i++) {
+    double t = i - center;
+    double h = fabs(t) < 1e-9 ? 2 * fc : sin(2 * DDC_PI * fc * t) / (DDC_PI * t);
+    double u = t / (center + 0.5);
+    s->h[i] = (float)(h * unet_bessel_i0(beta * sqrt(1 - u * u)) / i0beta);
+    sum += s->h[i];
+  }
+  for (int i = 0; i < s->taps; i++) s->h[i] = (float)(s->h[i] / sum);
+  return 0;
+}
+
+unet_ddc_t unet_ddc_create(float fs, float fc, float bandwidth) {
+  if (fs <= 0 || fc < 0 || bandwidth <= 0 || bandwidth * DDC_OVERSAMPLE > fs) return NULL;
+  _unet_ddc_t *ddc = calloc(1, sizeof(_unet_ddc_t));
+  if (ddc == NULL) return NULL;
+  int factors[DDC_MAXSTAGES];
+  int d = (int)floorf(fs / (DDC_OVERSAMPLE * bandwidth));
+  ddc->fs = fs;
+  ddc->fc = fc;
+  ddc->decim = factorize(d < 1 ? 1 : d, factors, &ddc->nstages);
+  ddc->outrate = fs / (float)ddc->decim;
+  double rate = fs;
+  for (int i = 0; i < ddc->nstages; i++) {
+    _ddc_stage_t *s = &ddc->stage[i];
+    s->factor = factors[i];
+    if (design(s, rate, bandwidth / 2.0) < 0) {
+      unet_ddc_destroy(ddc);
+      return NULL;
+    }
+    ddc->delay += (s->taps - 1) / 2.0 / rate;
+    rate /= s->factor;
+  }
+  ddc->yi = malloc(sizeof(float) * DDC_BLK);
+  ddc->yq = malloc(sizeof(float) * DDC_BLK);
+  if (ddc->yi == NULL || ddc->yq == NULL) {
+    unet_ddc_destroy(ddc);
+    return NULL;
+  }
+  pthread_once(&ddc_ready, ddc_init);
+  unet_ddc_reset(ddc);
+  return ddc;
+}
+
+void unet_ddc_destroy(unet_ddc_t ddc) {
+  if (ddc == NULL) return;
+  _unet_ddc_t *uddc = ddc;
+  for (int i = 0; i < uddc->nstages; i++) {
+    free(uddc->stage[i].h);
+    free(uddc->stage[i].xi);
+    free(uddc->stage[i].xq);
+  }
+  free(uddc->yi);
+  free(uddc->yq);
+  free(uddc->blkout);
+  free(uddc);
+}
+
+// clear the filters, leaving the oscillator running
+static void restart(_unet_ddc_t *ddc) {
+  for (int i = 0; i < ddc->nstages; i++) {
+    _ddc_stage_t *s = &ddc->stage[i];
+    memset(s->xi, 0, sizeof(float) * (size_t)s->taps);
+    memset(s->xq, 0, sizeof(float) * (size_t)s->taps);
+    s->xlen = s->taps - 1;
+    s->base = 0;
+  }
+  ddc->nout = 0;
+  ddc->started = false;
+}
+
+void unet_ddc_reset(unet_ddc_t ddc) {
+  if (ddc == NULL) return;
+  _unet_ddc_t *uddc = ddc;
+  restart(uddc);
+  uddc->phase = 0;
+}
+
+float unet_ddc_rate(unet_ddc_t ddc) {
+  if (ddc == NULL) return -1;
+  return ((_unet_ddc_t *)ddc)->outrate;
+}
+
+float unet_ddc_delay(unet_ddc_t ddc) {
+  if (ddc == NULL) return -1;
+  return (float)((_unet_ddc_t *)ddc)->delay;
+}
+
+int unet_ddc_max_output(unet_ddc_t ddc, int nin) {
+  if (ddc == NULL || nin < 0) return -1;
+  return nin / ((_unet_ddc_t *)ddc)->decim + 1;
+}
+
+// mix n samples into the first stage, seeding the phasors from the exact
+// phase every DDC_NCO_SEED samples so that rounding errors do not build up
+static void mix_in(_unet_ddc_t *ddc, const float *x, int n) {
+  _ddc_stage_t *s = &ddc->stage[0];
+  double f = ddc->fc / ddc->fs;
+  float sr = (float)cos(2 * DDC_PI * f * DDC_LANES);
+  float si = (float)-sin(2 * DDC_PI * f * DDC_LANES);
+  for (int i = 0; i < n; i += DDC_NCO_SEED) {
+    int m = n - i < DDC_NCO_SEED ? n - i : DDC_NCO_SEED;
+    float cr[DDC_LANES], ci[DDC_LANES];
+    for (int l = 0; l < DDC_LANES; l++) {
+      double p = 2 * DDC_PI * (ddc->phase + f * l);
+      cr[l] = (float)cos(p);
+      ci[l] = (float)-sin(p);
+    }
+    mix(s->xi + s->xlen, s->xq + s->xlen, x + i, m, cr, ci, sr, si);
+    s->xlen += m;
+    ddc->phase = fmod(ddc->phase + f * m, 1.0);
+  }
+}
+
+// filter and decimate the samples available in stage i, into the next stage
+// or the output
+static int run(_unet_ddc_t *ddc, int i) {
+  _ddc_stage_t *s = &ddc->stage[i];
+  _ddc_stage_t *next = i + 1 < ddc->nstages ? &ddc->stage[i + 1] : NULL;
+  float *yi = next != NULL ? next->xi + next->xlen : ddc->yi;
+  float *yq = next != NULL ? next->xq + next->xlen : ddc->yq;
+  int n = 0;
+  while (s->base + s->taps <= s->xlen) {
+    dot2(s->h, s->xi + s->base, s->xq + s->base, s->taps, yi + n, yq + n);
+    n++;
+    s->base += s->factor;
+  }
+  int keep = s->xlen - s->base;
+  if (keep > 0) {
+    memmove(s->xi, s->xi + s->base, sizeof(float) * (size_t)keep);
+    memmove(s->xq, s->xq + s->base, sizeof(float) * (size_t)keep);
+  }
+  s->base = keep < 0 ? -keep : 0;
+  s->xlen = keep > 0 ? keep : 0;
+  if (next != NULL) {
+    next->xlen += n;
+    return run(ddc, i + 1);
+  }
+  return n;
+}
+
+int unet_ddc_process(unet_ddc_t ddc, const float *in, int nin, float *out) {
+  if (ddc == NULL || in == NULL || out == NULL || nin < 0) return -1;
+  _unet_ddc_t *uddc = ddc;
+  int nout = 0;
+  while (nin > 0) {
+    int n = nin < DDC_BLK ? nin : DDC_BLK;
+    mix_in(uddc, in, n);
+    in += n;
+    nin -= n;
+    int m = run(uddc, 0);
+    const float *chans[2] = { uddc->yi, uddc->yq };
+    unet_conv_interleave(out + 2 * nout, chans, 2, (size_t)m);
+    nout += m;
+  }
+  uddc->nout += nout;
+  return nout;
+}
+
+int unet_ddc_set_sink(unet_ddc_t ddc, unet_block_sink_t sink, void *ctx) {
+  if (ddc == NULL || sink == NULL) return -1;
+  _unet_ddc_t *uddc = ddc;
+  uddc->sink = sink;
+  uddc->sinkctx = ctx;
+  return 0;
+}
+
+int unet_ddc_block(void *ctx, const unet_block_t *blk) {
+  _unet_ddc_t *ddc = ctx;
+  if (ddc == NULL || ddc->sink == NULL || blk == NULL) return 1;
+  int need = unet_ddc_max_output(ddc, blk->nsamples);
+  if (need > ddc->blkcap) {
+    float *p = realloc(ddc->blkout, sizeof(float) * 2 * (size_t)need);
+    if (p == NULL) return 1;
+    ddc->blkout = p;
+    ddc->blkcap = need;
+  }
+  long long gap = 0;
+  if (ddc->started && blk->gap > 0) {
+    // keep the carrier phase coherent across the gap, and restart the filters
+    ddc->phase = fmod(ddc->phase + (double)ddc->fc / ddc->fs * (double)blk->gap, 1.0);
+    restart(ddc);
+    gap = llround((double)blk->gap / ddc->decim);
+  }
+  if (!ddc->started) {
+    ddc->started = true;
+    ddc->reftime = blk->rxtime;
+  }
+  long long first = ddc->nout;
+  int n = unet_ddc_process(ddc, blk->signal, blk->nsamples, ddc->blkout);
+  if (n < 0) return 1;
+  unet_block_t out;
+  out.signal = ddc->blkout;
+  out.nsamples = n;
+  out.fs = ddc->outrate;
+  out.fc = ddc->fc;
+  out.rxtime = ddc->reftime + llround(((double)first * ddc->decim / ddc->fs - ddc->delay) * 1e6);
+  out.seq = ddc->seq++;
+  out.gap = gap;
+  return ddc->sink(ddc->sinkctx, &out);
+}
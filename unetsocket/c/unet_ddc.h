@@ -0,0 +1,114 @@
+#ifndef _UNETDDC_H_
+#define _UNETDDC_H_
+
+#include "unet_stream.h"
+
+typedef void *unet_ddc_t;          ///< digital downconverter
+
+/// Ratio of the output sampling rate to the bandwidth
+
+#define DDC_OVERSAMPLE           1.25f
+
+/// Stopband attenuation of the decimation filters (dB)
+
+#define DDC_ATTEN                80
+
+/// Largest number of decimation stages
+
+#define DDC_MAXSTAGES            8
+
+/// Input samples processed at a time
+
+#define DDC_BLK                  4096
+
+/// Create a digital downconverter that turns a real passband signal into
+/// complex baseband. The signal is mixed down by fc with a numerically
+/// controlled oscillator and low-pass filtered and decimated in a cascade of
+/// FIR stages, to a sampling rate of at least DDC_OVERSAMPLE times the
+/// bandwidth. The decimation factor is chosen to split into stages of at most
+/// 8 each, and the output rate is fs divided by it.
+///
+/// @param fs               Input sampling rate (Hz)
+/// @param fc               Carrier frequency to mix down (Hz)
+/// @param bandwidth        Bandwidth to keep, centered on fc (Hz)
+/// @return                 Downconverter, or NULL on error or if the
+///                         bandwidth is too wide for the sampling rate
+
+unet_ddc_t unet_ddc_create(float fs, float fc, float bandwidth);
+
+/// Destroy a digital downconverter.
+///
+/// @param ddc              Downconverter
+
+void unet_ddc_destroy(unet_ddc_t ddc);
+
+/// Reset a downconverter to its initial state, discarding filter history and
+/// restarting the oscillator at zero phase.
+///
+/// @param ddc              Downconverter
+
+void unet_ddc_reset(unet_ddc_t ddc);
+
+/// Get the output sampling rate of a downconverter.
+///
+/// @param ddc              Downconverter
+/// @return                 Output sampling rate (Hz), -1 on error
+
+float unet_ddc_rate(unet_ddc_t ddc);
+
+/// Get the delay of the decimation filters, by which each output sample lags
+/// the input sample at the same index.
+///
+/// @param ddc              Downconverter
+/// @return                 Delay (s), -1 on error
+
+float unet_ddc_delay(unet_ddc_t ddc);
+
+/// Get the largest number of complex output samples that processing nin input
+/// samples can produce, for sizing output buffers.
+///
+/// @param ddc              Downconverter
+/// @param nin              Number of input samples
+/// @return                 Largest number of output samples
+
+int unet_ddc_max_output(unet_ddc_t ddc, int nin);
+
+/// Downconvert a block of a continuous passband signal.
+///
+/// @param ddc              Downconverter
+/// @param in               Passband samples
+/// @param nin              Number of passband samples
+/// @param out              Baseband samples (alternating real and imaginary
+///                         values), room for unet_ddc_max_output(ddc, nin)
+///                         complex samples
+/// @return                 Number of complex output samples, -1 on error
+
+int unet_ddc_process(unet_ddc_t ddc, const float *in, int nin, float *out);
+
+/// Set the block sink that unet_ddc_block() writes to.
+///
+/// @param ddc              Downconverter
+/// @param sink             Block sink for baseband blocks
+/// @param ctx              User context passed to the sink
+/// @return                 0 on success, -1 otherwise
+
+int unet_ddc_set_sink(unet_ddc_t ddc, unet_block_sink_t sink, void *ctx);
+
+/// Block sink that downconverts passband blocks and passes them on to the
+/// downconverter's sink as baseband blocks, for use with
+/// unetsocket_ext_pbstream(). Baseband blocks hold alternating real and
+/// imaginary values, with nsamples counting complex samples, fs the output
+/// rate and fc the carrier frequency, as from unetsocket_ext_bbstream().
+/// Block times are corrected for the filter delay. The oscillator phase
+/// carries across gaps, while the filters restart after them.
+///
+/// Several downconverters can share one passband stream by calling this
+/// function for each of them from a common block sink.
+///
+/// @param ctx              Downconverter
+/// @param blk              Passband signal block
+/// @return                 The return value of the sink, or 1 on error
+
+int unet_ddc_block(void *ctx, const unet_block_t *blk);
+
+#endif
@@ -0,0 +1,110 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_dsp.h"
+#include "unet_simd.h"
+#include "pthreadwindows.h"
+
+typedef void (*cmulc_t)(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n);
+
+static pthread_once_t dsp_ready = PTHREAD_ONCE_INIT;
+static cmulc_t cmulc = NULL;
+
+double unet_bessel_i0(double x) {
+  double sum = 1, term = 1;
+  for (int k = 1; k < 50; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+static void cmulc_scalar(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n) {
+  for (int i = 0; i < n; i++) {
+    float r = xr[i] * rr[i] + xi[i] * ri[i];
+    yi[i] = xi[i] * rr[i] - xr[i] * ri[i];
+    yr[i] = r;
+  }
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static void cmulc_sse2(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_loadu_ps(xr + i), b = _mm_loadu_ps(xi + i);
+    __m128 c = _mm_loadu_ps(rr + i), d = _mm_loadu_ps(ri + i);
+    _mm_storeu_ps(yr + i, _mm_add_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d)));
+    _mm_storeu_ps(yi + i, _mm_sub_ps(_mm_mul_ps(b, c), _mm_mul_ps(a, d)));
+  }
+  cmulc_scalar(yr + i, yi + i, xr + i, xi + i, rr + i, ri + i, n - i);
+}
+
+UNET_TARGET("avx2")
+static void cmulc_avx2(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 a = _mm256_loadu_ps(xr + i), b = _mm256_loadu_ps(xi + i);
+    __m256 c = _mm256_loadu_ps(rr + i), d = _mm256_loadu_ps(ri + i);
+    _mm256_storeu_ps(yr + i, _mm256_add_ps(_mm256_mul_ps(a, c), _mm256_mul_ps(b, d)));
+    _mm256_storeu_ps(yi + i, _mm256_sub_ps(_mm256_mul_ps(b, c), _mm256_mul_ps(a, d)));
+  }
+  cmulc_scalar(yr + i, yi + i, xr + i, xi + i, rr + i, ri + i, n - i);
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static void cmulc_neon(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t a = vld1q_f32(xr + i), b = vld1q_f32(xi + i);
+    float32x4_t c = vld1q_f32(rr + i), d = vld1q_f32(ri + i);
+    vst1q_f32(yr + i, vmlaq_f32(vmulq_f32(a, c), b, d));
+    vst1q_f32(yi + i, vmlsq_f32(vmulq_f32(b, c), a, d));
+  }
+  cmulc_scalar(yr + i, yi + i, xr + i, xi + i, rr + i, ri + i, n - i);
+}
+
+#endif
+
+static void dsp_init(void) {
+  cmulc = cmulc_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) cmulc = cmulc_sse2;
+  if (UNET_HAS_AVX2()) cmulc = cmulc_avx2;
+#endif
+#ifdef UNET_SIMD_NEON
+  cmulc = cmulc_neon;
+#endif
+}
+
+void unet_cmulc(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n) {
+  pthread_once(&dsp_ready, dsp_init);
+  cmulc(yr, yi, xr, xi, rr, ri, n);
+}
+
+float unet_select_kth(float *a, int n, int k) {
+  int lo = 0, hi = n - 1;
+  while (lo < hi) {
+    float pivot = a[(lo + hi) / 2];
+    int i = lo, j = hi;
+    while (i <= j) {
+      while (a[i] < pivot) i++;
+      while (a[j] > pivot) j--;
+      if (i <= j) {
+        float t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+        i++;
+        j--;
+      }
+    }
+    if (k <= j) hi = j;
+    else if (k >= i) lo = i;
+    else break;
+  }
+  return a[k];
+}
@@ -0,0 +1,36 @@
+#ifndef _UNETDSP_H_
+#define _UNETDSP_H_
+
+// Helpers shared by the signal processing modules. Not part of the API.
+
+/// Zeroth order modified Bessel function of the first kind, for Kaiser windows.
+///
+/// @param x                Argument
+/// @return                 I0(x)
+
+double unet_bessel_i0(double x);
+
+/// Multiply a spectrum by the conjugate of another, y = x conj(r). The output
+/// may be the input x, for an in-place product.
+///
+/// @param yr               Real part of the product
+/// @param yi               Imaginary part of the product
+/// @param xr               Real part of the spectrum
+/// @param xi               Imaginary part of the spectrum
+/// @param rr               Real part of the spectrum to conjugate
+/// @param ri               Imaginary part of the spectrum to conjugate
+/// @param n                Number of bins
+
+void unet_cmulc(float *yr, float *yi, const float *xr, const float *xi, const float *rr, const float *ri, int n);
+
+/// Find the k-th smallest of n values, such as a median, in linear time on
+/// average. The values are reordered.
+///
+/// @param a                Values
+/// @param n                Number of values
+/// @param k                Rank, from 0 for the smallest
+/// @return                 k-th smallest value
+
+float unet_select_kth(float *a, int n, int k);
+
+#endif
@@ -5,6 +5,9 @@
 #include "fjage.h"
 #include "unet.h"
 #include "unet_ext.h"
+#include "unet_stream.h"
+#include "unet_conv.h"
+#include "unet_time.h"
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
@@ -403,25 +406,48 @@ int unetsocket_ext_sget(unetsocket_t sock, int index, char *target_name, char *p
     return -1;
 }
 
+int unetsocket_ext_get_time(unetsocket_t sock, long long *time)
+{
+    if (sock == NULL || time == NULL) return -1;
+    _unetsocket_t *usock = sock;
+    fjage_msg_t msg;
+    fjage_aid_t aid;
+    aid = agent_for_service(usock, "org.arl.unet.Services.PHYSICAL");
+    if (aid == NULL) return -1;
+    msg = fjage_msg_create(parameterreq, FJAGE_REQUEST);
+    fjage_msg_set_recipient(msg, aid);
+    fjage_msg_add_int(msg, "index", -1);
+    fjage_msg_add_string(msg, "param", "time");
+    msg = request(usock, msg, 5 * TIMEOUT);
+    if (msg != NULL && fjage_msg_get_performative(msg) == FJAGE_INFORM)
+    {
+        *time = unet_msg_get_time(msg, "value", 0);
+        fjage_msg_destroy(msg);
+        fjage_aid_destroy(aid);
+        return 0;
+    }
+    fjage_msg_destroy(msg);
+    fjage_aid_destroy(aid);
+    return -1;
+}
+
 int unetsocket_ext_pbrecord(unetsocket_t sock, float *buf, int nsamples) {
   if (sock == NULL) return -1;
   if (nsamples <= 0 || buf == NULL) return -1;
   _unetsocket_t *usock = sock;
   int pbscnt = 0;
-  float tempbuf[PBSBLK];
   pbscnt = (int)ceil((float)nsamples / PBSBLK);
   fjage_subscribe_agent(usock->gw, fjage_agent_for_service(usock->gw, "org.arl.unet.Services.BASEBAND"));
-  printf("Requesting %d blocks of %d samples each...\n", pbscnt, PBSBLK);
   if (unetsocket_ext_iset(usock, 0, "org.arl.unet.Services.BASEBAND", "pbsblk", PBSBLK) < 0) return -1;
   if (unetsocket_ext_iset(usock, 0, "org.arl.unet.Services.BASEBAND", "pbscnt", pbscnt) < 0) return -1;
   for (int i = 0; i < pbscnt; i++)
   {
     fjage_msg_t rxsigntf = receive(usock, "org.arl.unet.bb.RxBasebandSignalNtf", NULL, 5 * TIMEOUT);
     if (rxsigntf == NULL) return -1;
-    fjage_msg_get_float_array(rxsigntf, "signal", tempbuf, PBSBLK);
+    // decode straight into the caller's buffer, truncating the last block
+    int remaining = nsamples - (i * PBSBLK);
+    fjage_msg_get_float_array(rxsigntf, "signal", buf + (i * PBSBLK), remaining > PBSBLK ? PBSBLK : remaining);
     fjage_msg_destroy(rxsigntf);
-    unsigned long remaining = (unsigned long) (nsamples - (i * PBSBLK));
-    memcpy(buf + (i * PBSBLK), tempbuf, remaining > PBSBLK ? (sizeof(float)*PBSBLK) : (sizeof(float)*remaining));
   }
   return 0;
 }
@@ -474,6 +500,47 @@ int unetsocket_ext_bbrecord(unetsocket_t sock, float *buf, int nsamples) {
   return -1;
 }
 
+// converts recorded blocks into a 16-bit buffer, filling gaps with zeros
+typedef struct {
+  int16_t *buf;
+  long long len;
+  long long count;
+  int width;
+  bool dither;
+  uint32_t seed;
+} _s16_record_t;
+
+static int s16_sink(void *ctx, const unet_block_t *blk) {
+  _s16_record_t *r = ctx;
+  long long gap = blk->gap > 0 ? blk->gap : 0;
+  if (gap > r->len - r->count) gap = r->len - r->count;
+  memset(r->buf + r->width * r->count, 0, sizeof(int16_t) * (size_t)(r->width * gap));
+  r->count += gap;
+  long long n = blk->nsamples;
+  if (n > r->len - r->count) n = r->len - r->count;
+  size_t m = (size_t)(r->width * n);
+  if (r->dither) unet_conv_f32_s16_dither(r->buf + r->width * r->count, blk->signal, m, &r->seed);
+  else unet_conv_f32_s16(r->buf + r->width * r->count, blk->signal, m);
+  r->count += n;
+  return r->count >= r->len ? 1 : 0;
+}
+
+int unetsocket_ext_pbrecord_s16(unetsocket_t sock, int16_t *buf, int nsamples, bool dither) {
+  if (sock == NULL) return -1;
+  if (nsamples <= 0 || buf == NULL) return -1;
+  _s16_record_t r = { buf, nsamples, 0, 1, dither, 1 };
+  if (unetsocket_ext_pbstream(sock, nsamples < PBSBLK ? nsamples : PBSBLK, s16_sink, &r) < 0) return -1;
+  return r.count == r.len ? 0 : -1;
+}
+
+int unetsocket_ext_bbrecord_s16(unetsocket_t sock, int16_t *buf, int nsamples, bool dither) {
+  if (sock == NULL) return -1;
+  if (nsamples <= 0 || buf == NULL) return -1;
+  _s16_record_t r = { buf, nsamples, 0, 2, dither, 1 };
+  if (unetsocket_ext_bbstream(sock, nsamples < STREAM_BBBLK ? nsamples : STREAM_BBBLK, s16_sink, &r) < 0) return -1;
+  return r.count == r.len ? 0 : -1;
+}
+
 #ifndef _WIN32
 
 int unetsocket_ext_rs232_wakeup(char *devname, int baud, const char *settings)
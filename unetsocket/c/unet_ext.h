@@ -169,6 +169,30 @@ int unetsocket_ext_tx_signal(unetsocket_t sock, float *signal, int nsamples, flo
 
 int unetsocket_ext_bbrecord(unetsocket_t sock, float *buf, int nsamples);
 
+/// Record a passband signal as 16-bit samples. Blocks are converted as they
+/// arrive, so no full-length float buffer is needed.
+///
+/// @param sock             Unet socket
+/// @param buf              Buffer to store the recorded signal, full scale
+///                         (1.0) being mapped to 32767
+/// @param nsamples         Number of samples
+/// @param dither           Add TPDF dither before quantizing
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_pbrecord_s16(unetsocket_t sock, int16_t *buf, int nsamples, bool dither);
+
+/// Record a baseband signal as complex 16-bit samples. Blocks are converted as
+/// they arrive, so no full-length float buffer is needed.
+///
+/// @param sock             Unet socket
+/// @param buf              Buffer of 2*nsamples values to store the recorded
+///                         signal, with alternating real and imaginary values
+/// @param nsamples         Number of complex samples
+/// @param dither           Add TPDF dither before quantizing
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_bbrecord_s16(unetsocket_t sock, int16_t *buf, int nsamples, bool dither);
+
 /// Ethernet wakeup
 ///
 /// @param macaddr          6 bytes hex array mac address of the device to wake up
@@ -187,6 +211,15 @@ int unetsocket_ext_ethernet_wakeup(unsigned char *macaddr);
 int unetsocket_ext_rs232_wakeup(char *devname, int baud, const char *settings);
 
 
+/// Get the current modem (physical layer) time. This is the timebase of the
+/// rxTime and txTime fields of notifications and requests.
+///
+/// @param sock             Unet socket
+/// @param time             Modem time in microseconds
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_get_time(unetsocket_t sock, long long *time);
+
 /// Put modem to sleep immediately.
 ///
 /// @param sock             Unet socket
@@ -0,0 +1,225 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "unet_fec.h"
+#include "unet_simd.h"
+#include "pthreadwindows.h"
+
+// GF(256) with the primitive polynomial x^8 + x^4 + x^3 + x^2 + 1
+#define GF_POLY                  0x11D
+
+typedef struct {
+  int k;
+  int m;
+  uint8_t *cauchy;      // m x k parity generator
+  uint8_t *work;        // 2 k x k decoding matrices
+} _unet_fec_t;
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static uint8_t gf_mul[256][256];
+static uint8_t gf_lo[256][16];      // c * x for x in 0..15
+static uint8_t gf_hi[256][16];      // c * (x << 4) for x in 0..15
+static pthread_once_t gf_ready = PTHREAD_ONCE_INIT;
+static void (*muladd)(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len);
+
+static uint8_t gf_mult(uint8_t a, uint8_t b) {
+  if (a == 0 || b == 0) return 0;
+  return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static uint8_t gf_inv(uint8_t a) {
+  return gf_exp[255 - gf_log[a]];
+}
+
+static void muladd_scalar(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  const uint8_t *row = gf_mul[c];
+  for (size_t i = 0; i < len; i++) dst[i] ^= row[src[i]];
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("ssse3")
+static void muladd_ssse3(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  __m128i lo = _mm_loadu_si128((const __m128i *)(const void *)gf_lo[c]);
+  __m128i hi = _mm_loadu_si128((const __m128i *)(const void *)gf_hi[c]);
+  __m128i mask = _mm_set1_epi8(0x0F);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(const void *)(src + i));
+    __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(s, mask)),
+                              _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+    __m128i d = _mm_loadu_si128((const __m128i *)(const void *)(dst + i));
+    _mm_storeu_si128((__m128i *)(void *)(dst + i), _mm_xor_si128(d, p));
+  }
+  muladd_scalar(dst + i, src + i, c, len - i);
+}
+
+UNET_TARGET("avx2")
+static void muladd_avx2(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(const void *)gf_lo[c]));
+  __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(const void *)gf_hi[c]));
+  __m256i mask = _mm256_set1_epi8(0x0F);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(const void *)(src + i));
+    __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+                                 _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(const void *)(dst + i));
+    _mm256_storeu_si256((__m256i *)(void *)(dst + i), _mm256_xor_si256(d, p));
+  }
+  muladd_scalar(dst + i, src + i, c, len - i);
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static void muladd_neon(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  uint8x16_t lo = vld1q_u8(gf_lo[c]);
+  uint8x16_t hi = vld1q_u8(gf_hi[c]);
+  uint8x16_t mask = vdupq_n_u8(0x0F);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t s = vld1q_u8(src + i);
+    uint8x16_t p = veorq_u8(vqtbl1q_u8(lo, vandq_u8(s, mask)), vqtbl1q_u8(hi, vshrq_n_u8(s, 4)));
+    vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p));
+  }
+  muladd_scalar(dst + i, src + i, c, len - i);
+}
+
+#endif
+
+static void gf_init(void) {
+  unsigned int x = 1;
+  for (int i = 0; i < 255; i++) {
+    gf_exp[i] = (uint8_t)x;
+    gf_log[x] = (uint8_t)i;
+    x <<= 1;
+    if (x & 0x100) x ^= GF_POLY;
+  }
+  for (int i = 255; i < 512; i++) gf_exp[i] = gf_exp[i - 255];
+  for (int a = 0; a < 256; a++) {
+    for (int b = 0; b < 256; b++) gf_mul[a][b] = gf_mult((uint8_t)a, (uint8_t)b);
+    for (int b = 0; b < 16; b++) {
+      gf_lo[a][b] = gf_mul[a][b];
+      gf_hi[a][b] = gf_mul[a][b << 4];
+    }
+  }
+  muladd = muladd_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSSE3()) muladd = muladd_ssse3;
+  if (UNET_HAS_AVX2()) muladd = muladd_avx2;
+#endif
+#ifdef UNET_SIMD_NEON
+  muladd = muladd_neon;
+#endif
+}
+
+void unet_gf256_muladd(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+  pthread_once(&gf_ready, gf_init);
+  if (c == 0) return;
+  muladd(dst, src, c, len);
+}
+
+unet_fec_t unet_fec_create(int k, int m) {
+  if (k <= 0 || m < 0 || k + m > FEC_MAX_SHARDS) return NULL;
+  pthread_once(&gf_ready, gf_init);
+  _unet_fec_t *fec = malloc(sizeof(_unet_fec_t));
+  if (fec == NULL) return NULL;
+  fec->k = k;
+  fec->m = m;
+  fec->cauchy = malloc((size_t)(m * k) + 1);
+  fec->work = malloc((size_t)(2 * k * k));
+  if (fec->cauchy == NULL || fec->work == NULL) {
+    free(fec->cauchy);
+    free(fec->work);
+    free(fec);
+    return NULL;
+  }
+  // Cauchy matrix 1/(x_i + y_j) with x_i = k+i and y_j = j, every square
+  // submatrix of which is invertible
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < k; j++)
+      fec->cauchy[i * k + j] = gf_inv((uint8_t)((k + i) ^ j));
+  return fec;
+}
+
+void unet_fec_destroy(unet_fec_t fec) {
+  if (fec == NULL) return;
+  _unet_fec_t *ufec = fec;
+  free(ufec->cauchy);
+  free(ufec->work);
+  free(ufec);
+}
+
+int unet_fec_encode(unet_fec_t fec, const uint8_t **data, uint8_t **parity, size_t len) {
+  if (fec == NULL || data == NULL || parity == NULL) return -1;
+  _unet_fec_t *ufec = fec;
+  for (int i = 0; i < ufec->m; i++) {
+    memset(parity[i], 0, len);
+    for (int j = 0; j < ufec->k; j++) unet_gf256_muladd(parity[i], data[j], ufec->cauchy[i * ufec->k + j], len);
+  }
+  return 0;
+}
+
+// invert a k x k matrix a into inv using Gauss-Jordan elimination, which
+// destroys a
+static int gf_invert(uint8_t *a, uint8_t *inv, int k) {
+  memset(inv, 0, (size_t)(k * k));
+  for (int i = 0; i < k; i++) inv[i * k + i] = 1;
+  for (int col = 0; col < k; col++) {
+    int pivot = col;
+    while (pivot < k && a[pivot * k + col] == 0) pivot++;
+    if (pivot == k) return -1;
+    if (pivot != col) {
+      for (int j = 0; j < k; j++) {
+        uint8_t t = a[col * k + j];
+        a[col * k + j] = a[pivot * k + j];
+        a[pivot * k + j] = t;
+        t = inv[col * k + j];
+        inv[col * k + j] = inv[pivot * k + j];
+        inv[pivot * k + j] = t;
+      }
+    }
+    uint8_t scale = gf_inv(a[col * k + col]);
+    for (int j = 0; j < k; j++) {
+      a[col * k + j] = gf_mult(a[col * k + j], scale);
+      inv[col * k + j] = gf_mult(inv[col * k + j], scale);
+    }
+    for (int i = 0; i < k; i++) {
+      uint8_t f = a[i * k + col];
+      if (i == col || f == 0) continue;
+      unet_gf256_muladd(a + i * k, a + col * k, f, (size_t)k);
+      unet_gf256_muladd(inv + i * k, inv + col * k, f, (size_t)k);
+    }
+  }
+  return 0;
+}
+
+int unet_fec_decode(unet_fec_t fec, uint8_t **shards, const bool *present, size_t len) {
+  if (fec == NULL || shards == NULL || present == NULL) return -1;
+  _unet_fec_t *ufec = fec;
+  int k = ufec->k;
+  bool missing = false;
+  for (int j = 0; j < k; j++) if (!present[j]) missing = true;
+  if (!missing) return 0;
+  int rows[FEC_MAX_SHARDS];
+  int nrows = 0;
+  for (int i = 0; i < k + ufec->m && nrows < k; i++) if (present[i]) rows[nrows++] = i;
+  if (nrows < k) return -1;
+  uint8_t *a = ufec->work;
+  uint8_t *inv = ufec->work + k * k;
+  memset(a, 0, (size_t)(k * k));
+  for (int r = 0; r < k; r++) {
+    if (rows[r] < k) a[r * k + rows[r]] = 1;
+    else memcpy(a + r * k, ufec->cauchy + (rows[r] - k) * k, (size_t)k);
+  }
+  if (gf_invert(a, inv, k) < 0) return -1;
+  for (int j = 0; j < k; j++) {
+    if (present[j]) continue;
+    memset(shards[j], 0, len);
+    for (int r = 0; r < k; r++) unet_gf256_muladd(shards[j], shards[rows[r]], inv[j * k + r], len);
+  }
+  return 0;
+}
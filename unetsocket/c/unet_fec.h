@@ -0,0 +1,63 @@
+#ifndef _UNETFEC_H_
+#define _UNETFEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void *unet_fec_t;          ///< Reed-Solomon erasure codec
+
+/// Largest total number of data and parity shards in a code
+
+#define FEC_MAX_SHARDS           256
+
+/// Multiply a buffer by a constant in GF(256) and add it to another buffer,
+/// i.e., dst[i] ^= c * src[i]. Uses SSSE3/AVX2/NEON when available.
+///
+/// @param dst              Destination buffer
+/// @param src              Source buffer
+/// @param c                Constant multiplier
+/// @param len              Number of bytes
+
+void unet_gf256_muladd(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len);
+
+/// Create a systematic Reed-Solomon erasure code with k data shards and m
+/// parity shards. The data can be reconstructed from any k of the k+m shards.
+///
+/// @param k                Number of data shards
+/// @param m                Number of parity shards
+/// @return                 Codec, or NULL if k+m exceeds FEC_MAX_SHARDS
+
+unet_fec_t unet_fec_create(int k, int m);
+
+/// Destroy an erasure codec.
+///
+/// @param fec              Codec
+
+void unet_fec_destroy(unet_fec_t fec);
+
+/// Compute parity shards.
+///
+/// @param fec              Codec
+/// @param data             k data shards of len bytes each
+/// @param parity           m buffers of len bytes to fill with parity shards
+/// @param len              Shard length in bytes
+/// @return                 0 on success, -1 otherwise
+
+int unet_fec_encode(unet_fec_t fec, const uint8_t **data, uint8_t **parity, size_t len);
+
+/// Reconstruct missing data shards. Shards 0 to k-1 are data shards and
+/// shards k to k+m-1 are parity shards. Missing data shards are written into
+/// their buffers; missing parity shards are not reconstructed. Decoding uses
+/// working memory of the codec, so a codec must not decode in several threads
+/// at once.
+///
+/// @param fec              Codec
+/// @param shards           k+m buffers of len bytes
+/// @param present          k+m flags indicating which shards were received
+/// @param len              Shard length in bytes
+/// @return                 0 on success, -1 if fewer than k shards are present
+
+int unet_fec_decode(unet_fec_t fec, uint8_t **shards, const bool *present, size_t len);
+
+#endif
@@ -0,0 +1,200 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_fft.h"
+#include "unet_simd.h"
+#include "pthreadwindows.h"
+#include <math.h>
+
+#define FFT_PI                   3.14159265358979323846
+
+// One radix-2 stage over the whole signal, combining pairs of transforms of
+// size h. w holds the h twiddle factors of the stage.
+typedef void (*stage_t)(float *re, float *im, int n, int h, const float *wr, const float *wi);
+
+static pthread_once_t fft_ready = PTHREAD_ONCE_INIT;
+static stage_t stage = NULL;
+static int stage_min = 0;            // smallest h for the vector stage
+
+typedef struct {
+  int n;
+  int *rev;                          // bit-reversed index of each index
+  float *twr;                        // twiddles of the stage of half size h at [h, 2h)
+  float *twi;
+} _unet_fft_t;
+
+static void stage_scalar(float *re, float *im, int n, int h, const float *wr, const float *wi) {
+  for (int g = 0; g < n; g += 2 * h) {
+    float *ar = re + g, *ai = im + g, *br = re + g + h, *bi = im + g + h;
+    for (int j = 0; j < h; j++) {
+      float tr = br[j] * wr[j] - bi[j] * wi[j];
+      float ti = br[j] * wi[j] + bi[j] * wr[j];
+      br[j] = ar[j] - tr;
+      bi[j] = ai[j] - ti;
+      ar[j] += tr;
+      ai[j] += ti;
+    }
+  }
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static void stage_sse2(float *re, float *im, int n, int h, const float *wr, const float *wi) {
+  for (int g = 0; g < n; g += 2 * h) {
+    float *ar = re + g, *ai = im + g, *br = re + g + h, *bi = im + g + h;
+    for (int j = 0; j < h; j += 4) {
+      __m128 xr = _mm_loadu_ps(br + j), xi = _mm_loadu_ps(bi + j);
+      __m128 cr = _mm_loadu_ps(wr + j), ci = _mm_loadu_ps(wi + j);
+      __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+      __m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+      __m128 yr = _mm_loadu_ps(ar + j), yi = _mm_loadu_ps(ai + j);
+      _mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+      _mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+      _mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+      _mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+    }
+  }
+}
+
+UNET_TARGET("avx2")
+static void stage_avx2(float *re, float *im, int n, int h, const float *wr, const float *wi) {
+  for (int g = 0; g < n; g += 2 * h) {
+    float *ar = re + g, *ai = im + g, *br = re + g + h, *bi = im + g + h;
+    for (int j = 0; j < h; j += 8) {
+      __m256 xr = _mm256_loadu_ps(br + j), xi = _mm256_loadu_ps(bi + j);
+      __m256 cr = _mm256_loadu_ps(wr + j), ci = _mm256_loadu_ps(wi + j);
+      __m256 tr = _mm256_sub_ps(_mm256_mul_ps(xr, cr), _mm256_mul_ps(xi, ci));
+      __m256 ti = _mm256_add_ps(_mm256_mul_ps(xr, ci), _mm256_mul_ps(xi, cr));
+      __m256 yr = _mm256_loadu_ps(ar + j), yi = _mm256_loadu_ps(ai + j);
+      _mm256_storeu_ps(br + j, _mm256_sub_ps(yr, tr));
+      _mm256_storeu_ps(bi + j, _mm256_sub_ps(yi, ti));
+      _mm256_storeu_ps(ar + j, _mm256_add_ps(yr, tr));
+      _mm256_storeu_ps(ai + j, _mm256_add_ps(yi, ti));
+    }
+  }
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static void stage_neon(float *re, float *im, int n, int h, const float *wr, const float *wi) {
+  for (int g = 0; g < n; g += 2 * h) {
+    float *ar = re + g, *ai = im + g, *br = re + g + h, *bi = im + g + h;
+    for (int j = 0; j < h; j += 4) {
+      float32x4_t xr = vld1q_f32(br + j), xi = vld1q_f32(bi + j);
+      float32x4_t cr = vld1q_f32(wr + j), ci = vld1q_f32(wi + j);
+      float32x4_t tr = vmlsq_f32(vmulq_f32(xr, cr), xi, ci);
+      float32x4_t ti = vmlaq_f32(vmulq_f32(xr, ci), xi, cr);
+      float32x4_t yr = vld1q_f32(ar + j), yi = vld1q_f32(ai + j);
+      vst1q_f32(br + j, vsubq_f32(yr, tr));
+      vst1q_f32(bi + j, vsubq_f32(yi, ti));
+      vst1q_f32(ar + j, vaddq_f32(yr, tr));
+      vst1q_f32(ai + j, vaddq_f32(yi, ti));
+    }
+  }
+}
+
+#endif
+
+static void fft_init(void) {
+  stage = stage_scalar;
+  stage_min = 1;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) {
+    stage = stage_sse2;
+    stage_min = 4;
+  }
+  if (UNET_HAS_AVX2()) {
+    stage = stage_avx2;
+    stage_min = 8;
+  }
+#endif
+#ifdef UNET_SIMD_NEON
+  stage = stage_neon;
+  stage_min = 4;
+#endif
+}
+
+unet_fft_t unet_fft_create(int n) {
+  if (n < 1 || n > FFT_MAXSIZE || (n & (n - 1)) != 0) return NULL;
+  _unet_fft_t *fft = calloc(1, sizeof(_unet_fft_t));
+  if (fft == NULL) return NULL;
+  fft->n = n;
+  fft->rev = malloc(sizeof(int) * (size_t)n);
+  fft->twr = malloc(sizeof(float) * (size_t)n);
+  fft->twi = malloc(sizeof(float) * (size_t)n);
+  if (fft->rev == NULL || fft->twr == NULL || fft->twi == NULL) {
+    unet_fft_destroy(fft);
+    return NULL;
+  }
+  int bits = 0;
+  while ((1 << bits) < n) bits++;
+  for (int i = 0; i < n; i++) {
+    int r = 0;
+    for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+    fft->rev[i] = r;
+  }
+  for (int h = 1; h < n; h *= 2) {
+    for (int j = 0; j < h; j++) {
+      double a = -FFT_PI * j / h;
+      fft->twr[h + j] = (float)cos(a);
+      fft->twi[h + j] = (float)sin(a);
+    }
+  }
+  pthread_once(&fft_ready, fft_init);
+  return fft;
+}
+
+void unet_fft_destroy(unet_fft_t fft) {
+  if (fft == NULL) return;
+  _unet_fft_t *ufft = fft;
+  free(ufft->rev);
+  free(ufft->twr);
+  free(ufft->twi);
+  free(ufft);
+}
+
+int unet_fft_size(unet_fft_t fft) {
+  if (fft == NULL) return -1;
+  return ((_unet_fft_t *)fft)->n;
+}
+
+// decimation in time: bit-reversed reordering, then stages of growing size
+static void transform(const _unet_fft_t *fft, float *re, float *im) {
+  int n = fft->n;
+  for (int i = 0; i < n; i++) {
+    int r = fft->rev[i];
+    if (i < r) {
+      float t = re[i];
+      re[i] = re[r];
+      re[r] = t;
+      t = im[i];
+      im[i] = im[r];
+      im[r] = t;
+    }
+  }
+  for (int h = 1; h < n; h *= 2) {
+    if (h < stage_min) stage_scalar(re, im, n, h, fft->twr + h, fft->twi + h);
+    else stage(re, im, n, h, fft->twr + h, fft->twi + h);
+  }
+}
+
+int unet_fft_forward(unet_fft_t fft, float *re, float *im) {
+  if (fft == NULL || re == NULL || im == NULL) return -1;
+  transform(fft, re, im);
+  return 0;
+}
+
+int unet_fft_inverse(unet_fft_t fft, float *re, float *im) {
+  if (fft == NULL || re == NULL || im == NULL) return -1;
+  _unet_fft_t *ufft = fft;
+  // swapping real and imaginary parts conjugates the signal up to a factor of j
+  transform(ufft, im, re);
+  float scale = 1.0f / (float)ufft->n;
+  for (int i = 0; i < ufft->n; i++) {
+    re[i] *= scale;
+    im[i] *= scale;
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef _UNETFFT_H_
+#define _UNETFFT_H_
+
+// Fast Fourier transform of complex signals held as separate arrays of real
+// and imaginary parts, for sizes that are powers of 2. The butterflies use
+// SSE2/AVX2 or NEON when available, selected at run time. A transform only
+// reads its tables after creation, so it can be shared between threads.
+
+typedef void *unet_fft_t;          ///< FFT of a fixed size
+
+/// Largest FFT size
+
+#define FFT_MAXSIZE              (1 << 24)
+
+/// Create an FFT.
+///
+/// @param n                Size, a power of 2 up to FFT_MAXSIZE
+/// @return                 FFT, or NULL on error
+
+unet_fft_t unet_fft_create(int n);
+
+/// Destroy an FFT.
+///
+/// @param fft              FFT
+
+void unet_fft_destroy(unet_fft_t fft);
+
+/// Get the size of an FFT.
+///
+/// @param fft              FFT
+/// @return                 Size, -1 on error
+
+int unet_fft_size(unet_fft_t fft);
+
+/// Compute the forward transform in place, X[k] = sum x[i] exp(-j 2 pi i k / n).
+///
+/// @param fft              FFT
+/// @param re               Real parts (n values)
+/// @param im               Imaginary parts (n values)
+/// @return                 0 on success, -1 otherwise
+
+int unet_fft_forward(unet_fft_t fft, float *re, float *im);
+
+/// Compute the inverse transform in place, scaled by 1/n so that it undoes
+/// unet_fft_forward().
+///
+/// @param fft              FFT
+/// @param re               Real parts (n values)
+/// @param im               Imaginary parts (n values)
+/// @return                 0 on success, -1 otherwise
+
+int unet_fft_inverse(unet_fft_t fft, float *re, float *im);
+
+#endif
@@ -0,0 +1,306 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_locate.h"
+#include <math.h>
+#include <string.h>
+
+#define LOCATE_EPS               1e-9   // smallest pivot of the normal equations, relative to their trace
+#define LOCATE_MAXHALVE          8      // largest number of halvings of a Gauss-Newton step
+
+typedef struct {
+  int nanchors;
+  double *anchors;
+  double threshold;
+} _unet_locate_t;
+
+// Ranges to one target, with the anchors relative to their centroid
+typedef struct {
+  int m;
+  int d;
+  int anchor[LOCATE_MAXANCHORS];
+  double a[LOCATE_MAXANCHORS][3];
+  double r[LOCATE_MAXANCHORS];
+  double z;
+} problem_t;
+
+unet_locate_t unet_locate_create(const float *anchors, int nanchors) {
+  if (anchors == NULL || nanchors < 1 || nanchors > LOCATE_MAXANCHORS) return NULL;
+  _unet_locate_t *loc = calloc(1, sizeof(_unet_locate_t));
+  if (loc == NULL) return NULL;
+  loc->anchors = malloc(sizeof(double) * 3 * (size_t)nanchors);
+  if (loc->anchors == NULL) {
+    free(loc);
+    return NULL;
+  }
+  for (int i = 0; i < 3 * nanchors; i++) loc->anchors[i] = anchors[i];
+  loc->nanchors = nanchors;
+  loc->threshold = LOCATE_OUTLIER;
+  return loc;
+}
+
+void unet_locate_destroy(unet_locate_t loc) {
+  if (loc == NULL) return;
+  _unet_locate_t *uloc = loc;
+  free(uloc->anchors);
+  free(uloc);
+}
+
+int unet_locate_set_anchor(unet_locate_t loc, int anchor, float x, float y, float z) {
+  if (loc == NULL) return -1;
+  _unet_locate_t *uloc = loc;
+  if (anchor < 0 || anchor >= uloc->nanchors) return -1;
+  uloc->anchors[3 * anchor] = x;
+  uloc->anchors[3 * anchor + 1] = y;
+  uloc->anchors[3 * anchor + 2] = z;
+  return 0;
+}
+
+int unet_locate_set_threshold(unet_locate_t loc, float threshold) {
+  if (loc == NULL || !(threshold > 0)) return -1;
+  _unet_locate_t *uloc = loc;
+  uloc->threshold = threshold;
+  return 0;
+}
+
+// Solve the symmetric positive definite d x d system n x = g in place by
+// Cholesky decomposition, leaving x in g.
+static int cholesky(double *n, double *g, int d) {
+  double tr = 0;
+  for (int i = 0; i < d; i++) tr += n[i * d + i];
+  for (int j = 0; j < d; j++) {
+    double p = n[j * d + j];
+    for (int k = 0; k < j; k++) p -= n[j * d + k] * n[j * d + k];
+    if (!(p > LOCATE_EPS * tr)) return -1;
+    p = sqrt(p);
+    n[j * d + j] = p;
+    for (int i = j + 1; i < d; i++) {
+      double s = n[i * d + j];
+      for (int k = 0; k < j; k++) s -= n[i * d + k] * n[j * d + k];
+      n[i * d + j] = s / p;
+    }
+  }
+  for (int i = 0; i < d; i++) {
+    double s = g[i];
+    for (int k = 0; k < i; k++) s -= n[i * d + k] * g[k];
+    g[i] = s / n[i * d + i];
+  }
+  for (int i = d - 1; i >= 0; i--) {
+    double s = g[i];
+    for (int k = i + 1; k < d; k++) s -= n[k * d + i] * g[k];
+    g[i] = s / n[i * d + i];
+  }
+  return 0;
+}
+
+// Linearized least squares in the first d coordinates. Differencing the
+// squared range equations from their mean cancels the square of the position,
+// and with it the z offset of anchors in a horizontal plane when d is 2 and
+// the known z is not used.
+static int linear(const problem_t *p, const int *idx, int m, int d, bool knownz, double *x) {
+  double q[LOCATE_MAXANCHORS];
+  double abar[3] = { 0, 0, 0 };
+  double qbar = 0;
+  for (int i = 0; i < m; i++) {
+    const double *a = p->a[idx[i]];
+    double r2 = p->r[idx[i]] * p->r[idx[i]];
+    if (knownz) r2 -= (p->z - a[2]) * (p->z - a[2]);
+    q[i] = -r2;
+    for (int k = 0; k < d; k++) {
+      q[i] += a[k] * a[k];
+      abar[k] += a[k];
+    }
+    qbar += q[i];
+  }
+  for (int k = 0; k < d; k++) abar[k] /= m;
+  qbar /= m;
+  double n[9], g[3];
+  memset(n, 0, sizeof(n));
+  memset(g, 0, sizeof(g));
+  for (int i = 0; i < m; i++) {
+    double da[3];
+    for (int k = 0; k < d; k++) da[k] = 2 * (p->a[idx[i]][k] - abar[k]);
+    for (int k = 0; k < d; k++) {
+      g[k] += da[k] * (q[i] - qbar);
+      for (int l = 0; l < d; l++) n[k * d + l] += da[k] * da[l];
+    }
+  }
+  if (cholesky(n, g, d) < 0) return -1;
+  for (int k = 0; k < d; k++) x[k] = g[k];
+  return 0;
+}
+
+// Initial position by linearized least squares. Without a known z, anchors in
+// a horizontal plane leave z undetermined, so the horizontal position is
+// solved on its own and the target is placed below the anchors at the mean
+// of the depths the ranges imply.
+static int initial(const problem_t *p, const int *idx, int m, double *x) {
+  if (p->d == 2) {
+    x[2] = p->z;
+    return linear(p, idx, m, 2, true, x);
+  }
+  if (linear(p, idx, m, 3, false, x) == 0) return 0;
+  if (m < 3 || linear(p, idx, m, 2, false, x) < 0) return -1;
+  double az = 0, dz2 = 0;
+  for (int i = 0; i < m; i++) {
+    const double *a = p->a[idx[i]];
+    double dx = x[0] - a[0];
+    double dy = x[1] - a[1];
+    az += a[2];
+    dz2 += p->r[idx[i]] * p->r[idx[i]] - dx * dx - dy * dy;
+  }
+  x[2] = az / m - (dz2 > 0 ? sqrt(dz2 / m) : 0);
+  return 0;
+}
+
+// Sum of squared range residuals at x, leaving the residuals in res.
+static double residuals(const problem_t *p, const int *idx, int m, const double *x, double *res) {
+  double ss = 0;
+  for (int i = 0; i < m; i++) {
+    const double *a = p->a[idx[i]];
+    double dx = x[0] - a[0];
+    double dy = x[1] - a[1];
+    double dz = x[2] - a[2];
+    res[i] = sqrt(dx * dx + dy * dy + dz * dz) - p->r[idx[i]];
+    ss += res[i] * res[i];
+  }
+  return ss;
+}
+
+// Gauss-Newton refinement on the ranges, leaving the residuals in res and
+// returning their RMS. Steps that do not reduce the residuals are halved, up
+// to LOCATE_MAXHALVE times, and a singular step keeps the position reached.
+static double refine(const problem_t *p, const int *idx, int m, double *x, double *res) {
+  int d = p->d;
+  double ss = residuals(p, idx, m, x, res);
+  for (int it = 0; it < LOCATE_MAXITER; it++) {
+    double n[9], g[3];
+    memset(n, 0, sizeof(n));
+    memset(g, 0, sizeof(g));
+    for (int i = 0; i < m; i++) {
+      const double *a = p->a[idx[i]];
+      double dx[3] = { x[0] - a[0], x[1] - a[1], x[2] - a[2] };
+      double rr = res[i] + p->r[idx[i]];
+      if (!(rr > LOCATE_TOL)) continue;
+      for (int k = 0; k < d; k++) {
+        g[k] -= dx[k] / rr * res[i];
+        for (int l = 0; l < d; l++) n[k * d + l] += dx[k] * dx[l] / (rr * rr);
+      }
+    }
+    if (cholesky(n, g, d) < 0) break;
+    double step = 0;
+    for (int k = 0; k < d; k++) step += g[k] * g[k];
+    double xn[3], resn[LOCATE_MAXANCHORS], ssn = ss;
+    int h;
+    for (h = 0; h <= LOCATE_MAXHALVE; h++) {
+      memcpy(xn, x, sizeof(xn));
+      for (int k = 0; k < d; k++) xn[k] += g[k];
+      ssn = residuals(p, idx, m, xn, resn);
+      if (ssn <= ss) break;
+      for (int k = 0; k < d; k++) g[k] /= 2;
+    }
+    if (h > LOCATE_MAXHALVE) break;
+    memcpy(x, xn, sizeof(xn));
+    memcpy(res, resn, sizeof(double) * (size_t)m);
+    ss = ssn;
+    if (step < LOCATE_TOL * LOCATE_TOL) break;
+  }
+  return sqrt(ss / m);
+}
+
+static double fit(const problem_t *p, const int *idx, int m, double *x, double *res) {
+  if (initial(p, idx, m, x) < 0) return -1;
+  return refine(p, idx, m, x, res);
+}
+
+static void locate(const _unet_locate_t *loc, const problem_t *p, double cx, double cy, double cz, unet_position_t *pos) {
+  memset(pos, 0, sizeof(unet_position_t));
+  if (p->m < p->d + 1) {
+    pos->status = LOCATE_FEWRANGES;
+    return;
+  }
+  int idx[LOCATE_MAXANCHORS];
+  int m = p->m;
+  for (int i = 0; i < m; i++) idx[i] = i;
+  double x[3], res[LOCATE_MAXANCHORS];
+  double rms = fit(p, idx, m, x, res);
+  if (rms < 0) {
+    pos->status = LOCATE_SINGULAR;
+    return;
+  }
+  while (m > p->d + 1) {
+    double worst = 0;
+    for (int i = 0; i < m; i++) if (fabs(res[i]) > worst) worst = fabs(res[i]);
+    if (!(worst > loc->threshold)) break;
+    int best = -1;
+    double bestrms = rms;
+    double bx[3];
+    for (int j = 0; j < m; j++) {
+      int sub[LOCATE_MAXANCHORS];
+      double sx[3], sres[LOCATE_MAXANCHORS];
+      for (int i = 0, k = 0; i < m; i++) if (i != j) sub[k++] = idx[i];
+      double srms = fit(p, sub, m - 1, sx, sres);
+      if (srms >= 0 && srms < bestrms) {
+        best = j;
+        bestrms = srms;
+        memcpy(bx, sx, sizeof(bx));
+      }
+    }
+    if (best < 0) break;
+    pos->rejected |= 1u << p->anchor[idx[best]];
+    for (int i = best; i < m - 1; i++) idx[i] = idx[i + 1];
+    m--;
+    memcpy(x, bx, sizeof(x));
+    rms = refine(p, idx, m, x, res);
+  }
+  pos->x = (float)(x[0] + cx);
+  pos->y = (float)(x[1] + cy);
+  pos->z = (float)(x[2] + cz);
+  pos->rms = (float)rms;
+  pos->nranges = m;
+  pos->status = LOCATE_OK;
+}
+
+int unet_locate_solve(unet_locate_t loc, const float *range, const float *z, int ntargets, unet_position_t *pos) {
+  if (loc == NULL || range == NULL || ntargets < 1 || pos == NULL) return -1;
+  _unet_locate_t *uloc = loc;
+  problem_t p;
+  int count = 0;
+  for (int t = 0; t < ntargets; t++) {
+    double cx = 0, cy = 0, cz = 0;
+    p.m = 0;
+    p.d = z != NULL ? 2 : 3;
+    for (int i = 0; i < uloc->nanchors; i++) {
+      float r = range[i * ntargets + t];
+      if (!(r >= 0)) continue;
+      const double *a = uloc->anchors + 3 * i;
+      p.anchor[p.m] = i;
+      p.r[p.m] = r;
+      for (int k = 0; k < 3; k++) p.a[p.m][k] = a[k];
+      cx += a[0];
+      cy += a[1];
+      cz += a[2];
+      p.m++;
+    }
+    if (p.m > 0) {
+      cx /= p.m;
+      cy /= p.m;
+      cz /= p.m;
+    }
+    for (int i = 0; i < p.m; i++) {
+      p.a[i][0] -= cx;
+      p.a[i][1] -= cy;
+      p.a[i][2] -= cz;
+    }
+    p.z = z != NULL ? z[t] - cz : 0;
+    locate(uloc, &p, cx, cy, cz, pos + t);
+    if (pos[t].status == LOCATE_OK) count++;
+  }
+  return count;
+}
+
+int unet_locate_fix(unet_locate_t loc, const unet_range_fix_t *fix, const float *z, unet_position_t *pos) {
+  if (loc == NULL || fix == NULL) return -1;
+  _unet_locate_t *uloc = loc;
+  if (fix->ntransponders != uloc->nanchors) return -1;
+  return unet_locate_solve(loc, fix->range, z, 1, pos) == 1 ? 0 : -1;
+}
@@ -0,0 +1,109 @@
+#ifndef _UNETLOCATE_H_
+#define _UNETLOCATE_H_
+
+#include "unet.h"
+#include "unet_ranger.h"
+
+typedef void *unet_locate_t;       ///< position solver
+
+/// Position of a target
+
+typedef struct {
+  float x, y, z;                   ///< position (m), with the z axis up as for node locations
+  float rms;                       ///< RMS residual of the ranges used (m)
+  int nranges;                     ///< number of ranges used
+  unsigned int rejected;           ///< bit mask of the anchors whose ranges were rejected as outliers
+  int status;                      ///< LOCATE_OK, LOCATE_FEWRANGES or LOCATE_SINGULAR
+} unet_position_t;
+
+/// Status of a position
+
+#define LOCATE_OK                0      ///< target located
+#define LOCATE_FEWRANGES         1      ///< too few ranges to locate the target
+#define LOCATE_SINGULAR          2      ///< anchors too close to a line or plane to locate the target
+
+/// Largest number of anchors
+
+#define LOCATE_MAXANCHORS        32
+
+/// Default residual above which a range is rejected as an outlier (m)
+
+#define LOCATE_OUTLIER           5.0f
+
+/// Largest number of Gauss-Newton iterations
+
+#define LOCATE_MAXITER           20
+
+/// Position change at which the Gauss-Newton iterations stop (m)
+
+#define LOCATE_TOL               1e-4
+
+/// Create a position solver for targets ranged from a set of anchors, such as
+/// modems at known locations or transponders. Each target is first located by
+/// linearized least squares, by differencing the range equations from their
+/// mean, and the position is then refined by Gauss-Newton iterations on the
+/// ranges themselves. As long as more ranges than needed remain, the range
+/// whose removal most reduces the residual is rejected while any residual
+/// exceeds the outlier threshold.
+///
+/// @param anchors          Anchor positions (x, y, z for each anchor, m)
+/// @param nanchors         Number of anchors, up to LOCATE_MAXANCHORS
+/// @return                 Position solver, or NULL on error
+
+unet_locate_t unet_locate_create(const float *anchors, int nanchors);
+
+/// Destroy a position solver.
+///
+/// @param loc              Position solver
+
+void unet_locate_destroy(unet_locate_t loc);
+
+/// Move an anchor, for example a buoy with GPS.
+///
+/// @param loc              Position solver
+/// @param anchor           Index of the anchor
+/// @param x                Position of the anchor (m)
+/// @param y
+/// @param z
+/// @return                 0 on success, -1 otherwise
+
+int unet_locate_set_anchor(unet_locate_t loc, int anchor, float x, float y, float z);
+
+/// Set the outlier threshold.
+///
+/// @param loc              Position solver
+/// @param threshold        Residual above which a range is rejected (m)
+/// @return                 0 on success, -1 otherwise
+
+int unet_locate_set_threshold(unet_locate_t loc, float threshold);
+
+/// Locate a batch of targets. The ranges are laid out one anchor after the
+/// other, so the ranges returned by unet_ranging_range() for a list of
+/// targets from each anchor in turn can be stored in place. A target with a
+/// known z, such as from a depth sensor, is located in the horizontal plane
+/// from 3 ranges, and otherwise in space from 4. When the anchors lie in a
+/// horizontal plane and z is not known, the target is taken to be below them.
+///
+/// @param loc              Position solver
+/// @param range            Range from each anchor to each target (m),
+///                         range[anchor * ntargets + target], negative if not
+///                         measured
+/// @param z                Known z of each target (m), or NULL if not known
+/// @param ntargets         Number of targets
+/// @param pos              Position of each target
+/// @return                 Number of targets located, -1 on error
+
+int unet_locate_solve(unet_locate_t loc, const float *range, const float *z, int ntargets, unet_position_t *pos);
+
+/// Locate a target from a range fix from a transponder ranging engine
+/// (unet_ranger.h), with the transponders as the anchors.
+///
+/// @param loc              Position solver, with an anchor per transponder
+/// @param fix              Range fix
+/// @param z                Known z of the target (m), or NULL if not known
+/// @param pos              Position of the target
+/// @return                 0 if located, -1 otherwise
+
+int unet_locate_fix(unet_locate_t loc, const unet_range_fix_t *fix, const float *z, unet_position_t *pos);
+
+#endif
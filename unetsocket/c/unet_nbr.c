@@ -0,0 +1,173 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet_nbr.h"
+#include "unet_time.h"
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+  bool used;
+  unet_nbr_info_t info;
+} slot_t;
+
+typedef struct {
+  int maxnodes;
+  int count;
+  int bits;
+  uint32_t mask;
+  float alpha;
+  slot_t *slots;
+} _unet_nbr_t;
+
+unet_nbr_t unet_nbr_create(int maxnodes, float alpha) {
+  if (maxnodes < 1 || maxnodes > (1 << 24) || alpha < 0 || alpha > 1) return NULL;
+  _unet_nbr_t *nbr = calloc(1, sizeof(_unet_nbr_t));
+  if (nbr == NULL) return NULL;
+  // at most half full, to keep probe sequences short
+  nbr->bits = 1;
+  while ((1 << nbr->bits) < 2 * maxnodes) nbr->bits++;
+  nbr->mask = (1u << nbr->bits) - 1;
+  nbr->slots = calloc((size_t)1 << nbr->bits, sizeof(slot_t));
+  if (nbr->slots == NULL) {
+    free(nbr);
+    return NULL;
+  }
+  nbr->maxnodes = maxnodes;
+  nbr->alpha = alpha > 0 ? alpha : NBR_ALPHA;
+  return nbr;
+}
+
+void unet_nbr_destroy(unet_nbr_t nbr) {
+  if (nbr == NULL) return;
+  _unet_nbr_t *unbr = nbr;
+  free(unbr->slots);
+  free(unbr);
+}
+
+// Fibonacci hashing, which spreads consecutive addresses across the table
+static uint32_t hash(const _unet_nbr_t *nbr, int node) {
+  return ((uint32_t)node * 2654435769u) >> (32 - nbr->bits);
+}
+
+static slot_t *find(_unet_nbr_t *nbr, int node, bool create) {
+  uint32_t i = hash(nbr, node);
+  while (nbr->slots[i].used) {
+    if (nbr->slots[i].info.node == node) return nbr->slots + i;
+    i = (i + 1) & nbr->mask;
+  }
+  if (!create || nbr->count >= nbr->maxnodes) return NULL;
+  slot_t *s = nbr->slots + i;
+  memset(s, 0, sizeof(slot_t));
+  s->used = true;
+  s->info.node = node;
+  s->info.rssi = NAN;
+  s->info.snr = NAN;
+  s->info.range = -1;
+  s->info.delivery = NAN;
+  nbr->count++;
+  return s;
+}
+
+static float ewma(float avg, float x, float alpha) {
+  if (isnan(x)) return avg;
+  if (isnan(avg)) return x;
+  return avg + alpha * (x - avg);
+}
+
+int unet_nbr_heard(unet_nbr_t nbr, int node, long long rxtime, float rssi, float snr) {
+  if (nbr == NULL) return -1;
+  _unet_nbr_t *unbr = nbr;
+  slot_t *s = find(unbr, node, true);
+  if (s == NULL) return -1;
+  if (rxtime > s->info.lastheard) s->info.lastheard = rxtime;
+  s->info.rxcount++;
+  s->info.rssi = ewma(s->info.rssi, rssi, unbr->alpha);
+  s->info.snr = ewma(s->info.snr, snr, unbr->alpha);
+  return 0;
+}
+
+int unet_nbr_range(unet_nbr_t nbr, int node, long long time, float range) {
+  if (nbr == NULL || !(range >= 0)) return -1;
+  _unet_nbr_t *unbr = nbr;
+  slot_t *s = find(unbr, node, true);
+  if (s == NULL) return -1;
+  s->info.range = range;
+  s->info.rangetime = time;
+  return 0;
+}
+
+int unet_nbr_delivery(unet_nbr_t nbr, int node, bool delivered) {
+  if (nbr == NULL) return -1;
+  _unet_nbr_t *unbr = nbr;
+  slot_t *s = find(unbr, node, true);
+  if (s == NULL) return -1;
+  s->info.txcount++;
+  s->info.delivery = ewma(s->info.delivery, delivered ? 1.0f : 0.0f, unbr->alpha);
+  return 0;
+}
+
+int unet_nbr_update(unet_nbr_t nbr, fjage_msg_t ntf) {
+  if (nbr == NULL || ntf == NULL) return -1;
+  const char *clazz = fjage_msg_get_clazz(ntf);
+  if (clazz == NULL) return 1;
+  if (strcmp(clazz, "org.arl.unet.DatagramNtf") == 0 || strcmp(clazz, "org.arl.unet.phy.RxFrameNtf") == 0) {
+    int from = fjage_msg_get_int(ntf, "from", -1);
+    if (from < 0) return 1;
+    return unet_nbr_heard(nbr, from, unet_msg_get_time(ntf, "rxTime", 0), fjage_msg_get_float(ntf, "rssi", NAN), fjage_msg_get_float(ntf, "snr", NAN));
+  }
+  if (strcmp(clazz, rangentf) == 0) {
+    int to = fjage_msg_get_int(ntf, "to", -1);
+    float range = fjage_msg_get_float(ntf, "range", -1);
+    if (to < 0 || range < 0) return 1;
+    return unet_nbr_range(nbr, to, unet_msg_get_time(ntf, "rxTime", 0), range);
+  }
+  bool delivered = strcmp(clazz, "org.arl.unet.DatagramDeliveryNtf") == 0;
+  if (delivered || strcmp(clazz, "org.arl.unet.DatagramFailureNtf") == 0) {
+    int to = fjage_msg_get_int(ntf, "to", -1);
+    if (to < 0) return 1;
+    return unet_nbr_delivery(nbr, to, delivered);
+  }
+  return 1;
+}
+
+int unet_nbr_get(unet_nbr_t nbr, int node, unet_nbr_info_t *info) {
+  if (nbr == NULL || info == NULL) return -1;
+  slot_t *s = find(nbr, node, false);
+  if (s == NULL) return -1;
+  *info = s->info;
+  return 0;
+}
+
+int unet_nbr_list(unet_nbr_t nbr, unet_nbr_info_t *info, int max) {
+  if (nbr == NULL || info == NULL || max < 0) return -1;
+  _unet_nbr_t *unbr = nbr;
+  int n = 0;
+  for (uint32_t i = 0; i <= unbr->mask && n < max; i++) {
+    if (unbr->slots[i].used) info[n++] = unbr->slots[i].info;
+  }
+  return n;
+}
+
+int unet_nbr_remove(unet_nbr_t nbr, int node) {
+  if (nbr == NULL) return -1;
+  _unet_nbr_t *unbr = nbr;
+  slot_t *s = find(unbr, node, false);
+  if (s == NULL) return -1;
+  // shift later entries of the probe sequence back into the hole, so that no
+  // tombstones are needed
+  uint32_t i = (uint32_t)(s - unbr->slots);
+  uint32_t j = i;
+  while (true) {
+    j = (j + 1) & unbr->mask;
+    if (!unbr->slots[j].used) break;
+    uint32_t h = hash(unbr, unbr->slots[j].info.node);
+    if (((j - h) & unbr->mask) >= ((j - i) & unbr->mask)) {
+      unbr->slots[i] = unbr->slots[j];
+      i = j;
+    }
+  }
+  unbr->slots[i].used = false;
+  unbr->count--;
+  return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef _UNETNBR_H_
+#define _UNETNBR_H_
+
+#include "unet.h"
+
+typedef void *unet_nbr_t;          ///< neighbor table
+
+/// Link statistics of a neighbor
+
+typedef struct {
+  int node;                        ///< node address
+  long long lastheard;             ///< modem time of the last frame received from the node (us), 0 if unknown
+  unsigned long rxcount;           ///< number of frames received from the node
+  float rssi;                      ///< moving average of the received signal strength (dB), NAN if never reported
+  float snr;                       ///< moving average of the SNR (dB), NAN if never reported
+  float range;                     ///< last range to the node (m), negative if never ranged
+  long long rangetime;             ///< time of the last range (us), 0 if never ranged
+  unsigned long txcount;           ///< number of reliable transmissions to the node with a known outcome
+  float delivery;                  ///< moving average of the delivery ratio, NAN if no outcome is known
+} unet_nbr_info_t;
+
+/// Default weight of a new value in the moving averages
+
+#define NBR_ALPHA                0.125f
+
+/// Create a neighbor table. The table is an open-addressing hash map keyed by
+/// node address, sized at creation, so that lookups and updates take constant
+/// time and never allocate. Statistics are exponentially weighted moving
+/// averages.
+///
+/// @param maxnodes         Largest number of neighbors
+/// @param alpha            Weight of a new value in the moving averages, or 0
+///                         for NBR_ALPHA
+/// @return                 Neighbor table, or NULL on error
+
+unet_nbr_t unet_nbr_create(int maxnodes, float alpha);
+
+/// Destroy a neighbor table.
+///
+/// @param nbr              Neighbor table
+
+void unet_nbr_destroy(unet_nbr_t nbr);
+
+/// Update the table from a notification: a DatagramNtf or RxFrameNtf, such as
+/// returned by unetsocket_receive(), counts as a frame heard from its sender,
+/// with its rxTime, rssi and snr where present; a RangeNtf gives the range to
+/// its peer; a DatagramDeliveryNtf or DatagramFailureNtf gives the outcome of
+/// a reliable transmission. Other messages are ignored. The message is not
+/// destroyed.
+///
+/// @param nbr              Neighbor table
+/// @param ntf              Notification
+/// @return                 0 if the table was updated, 1 if the message was
+///                         ignored, -1 on error or if the table is full
+
+int unet_nbr_update(unet_nbr_t nbr, fjage_msg_t ntf);
+
+/// Record a frame heard from a node.
+///
+/// @param nbr              Neighbor table
+/// @param node             Address of the sender
+/// @param rxtime           Modem time of reception (us), 0 if unknown
+/// @param rssi             Received signal strength (dB), NAN if unknown
+/// @param snr              SNR (dB), NAN if unknown
+/// @return                 0 on success, -1 on error or if the table is full
+
+int unet_nbr_heard(unet_nbr_t nbr, int node, long long rxtime, float rssi, float snr);
+
+/// Record a range to a node.
+///
+/// @param nbr              Neighbor table
+/// @param node             Node address
+/// @param time             Time of the range (us)
+/// @param range            Range (m)
+/// @return                 0 on success, -1 on error or if the table is full
+
+int unet_nbr_range(unet_nbr_t nbr, int node, long long time, float range);
+
+/// Record the outcome of a reliable transmission to a node.
+///
+/// @param nbr              Neighbor table
+/// @param node             Node address
+/// @param delivered        true if delivered, false if it failed
+/// @return                 0 on success, -1 on error or if the table is full
+
+int unet_nbr_delivery(unet_nbr_t nbr, int node, bool delivered);
+
+/// Look up a neighbor.
+///
+/// @param nbr              Neighbor table
+/// @param node             Node address
+/// @param info             Link statistics of the neighbor
+/// @return                 0 on success, -1 if the node is not in the table
+
+int unet_nbr_get(unet_nbr_t nbr, int node, unet_nbr_info_t *info);
+
+/// List the neighbors, in no particular order.
+///
+/// @param nbr              Neighbor table
+/// @param info             Link statistics of the neighbors
+/// @param max              Largest number of neighbors to list
+/// @return                 Number of neighbors listed, -1 on error
+
+int unet_nbr_list(unet_nbr_t nbr, unet_nbr_info_t *info, int max);
+
+/// Remove a neighbor.
+///
+/// @param nbr              Neighbor table
+/// @param node             Node address
+/// @return                 0 on success, -1 if the node is not in the table
+
+int unet_nbr_remove(unet_nbr_t nbr, int node);
+
+#endif
@@ -0,0 +1,268 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_psd.h"
+#include "unet_fft.h"
+#include "unet_conv.h"
+#include "unet_simd.h"
+#include "pthreadwindows.h"
+#include <string.h>
+#include <math.h>
+
+#define PSD_TUKEY_TAPER          0.5f   // fraction of the segment tapered by the Tukey window
+
+// add the power of a spectrum to an accumulator
+typedef void (*accum_t)(float *acc, const float *re, const float *im, int n);
+
+// kernel selected once by psd_init()
+static pthread_once_t psd_ready = PTHREAD_ONCE_INIT;
+static accum_t accum = NULL;
+
+typedef struct {
+  float fs;
+  float fc;
+  bool complex;
+  int nfft;
+  int hop;
+  int navg;
+  int nbins;
+  unet_fft_t fft;
+  float *win;
+  double scale;                      // from periodogram to density
+  float *xr;                         // samples of the current segment
+  float *xi;
+  int fill;
+  long long start;                   // stream index of the first sample in x
+  float *zr;                         // FFT input, two real segments packed as one complex
+  float *zi;
+  bool half;                         // zr holds a real segment waiting for a partner
+  float *acc;
+  int nseg;                          // segments in acc
+  long long fstart;                  // stream index of the first sample of the frame
+  float *level;
+  long long refidx;                  // stream index of a sample with known time
+  long long reftime;
+  unsigned long long seq;
+  unet_psd_sink_t sink;
+  void *ctx;
+} _unet_psd_t;
+
+static void accum_scalar(float *acc, const float *re, const float *im, int n) {
+  for (int i = 0; i < n; i++) acc[i] += re[i] * re[i] + im[i] * im[i];
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static void accum_sse2(float *acc, const float *re, const float *im, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_loadu_ps(re + i), b = _mm_loadu_ps(im + i);
+    __m128 p = _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b));
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), p));
+  }
+  accum_scalar(acc + i, re + i, im + i, n - i);
+}
+
+UNET_TARGET("avx2")
+static void accum_avx2(float *acc, const float *re, const float *im, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 a = _mm256_loadu_ps(re + i), b = _mm256_loadu_ps(im + i);
+    __m256 p = _mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+    _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), p));
+  }
+  accum_scalar(acc + i, re + i, im + i, n - i);
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static void accum_neon(float *acc, const float *re, const float *im, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t a = vld1q_f32(re + i), b = vld1q_f32(im + i);
+    float32x4_t p = vmlaq_f32(vmulq_f32(a, a), b, b);
+    vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), p));
+  }
+  accum_scalar(acc + i, re + i, im + i, n - i);
+}
+
+#endif
+
+static void psd_init(void) {
+  accum = accum_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) accum = accum_sse2;
+  if (UNET_HAS_AVX2()) accum = accum_avx2;
+#endif
+#ifdef UNET_SIMD_NEON
+  accum = accum_neon;
+#endif
+}
+
+unet_psd_t unet_psd_create(float fs, float fc, int nfft, int window, float overlap, int navg, unet_psd_sink_t sink, void *ctx) {
+  if (fs <= 0 || fc < 0 || nfft < 16 || nfft > PSD_MAXFFT || (nfft & (nfft - 1)) != 0) return NULL;
+  if (overlap < 0 || overlap > 0.9f || navg < 1 || sink == NULL) return NULL;
+  _unet_psd_t *psd = calloc(1, sizeof(_unet_psd_t));
+  if (psd == NULL) return NULL;
+  psd->fs = fs;
+  psd->fc = fc;
+  psd->complex = fc > 0;
+  psd->nfft = nfft;
+  psd->hop = (int)lroundf((float)nfft * (1 - overlap));
+  psd->navg = navg;
+  psd->nbins = psd->complex ? nfft : nfft / 2 + 1;
+  psd->sink = sink;
+  psd->ctx = ctx;
+  psd->fft = unet_fft_create(nfft);
+  bool ok = psd->fft != NULL;
+  float **bufs[] = { &psd->win, &psd->xr, &psd->xi, &psd->zr, &psd->zi, &psd->acc, &psd->level };
+  for (size_t i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++) {
+    *bufs[i] = calloc((size_t)nfft, sizeof(float));
+    if (*bufs[i] == NULL) ok = false;
+  }
+  if (ok) {
+    for (int i = 0; i < nfft; i++) psd->win[i] = 1;
+    if (unet_siggen_window(psd->win, nfft, 0, window, PSD_TUKEY_TAPER) < 0) ok = false;
+  }
+  if (!ok) {
+    unet_psd_destroy(psd);
+    return NULL;
+  }
+  double u = 0;
+  for (int i = 0; i < nfft; i++) u += (double)psd->win[i] * psd->win[i];
+  psd->scale = 1 / (fs * u);
+  pthread_once(&psd_ready, psd_init);
+  return psd;
+}
+
+void unet_psd_destroy(unet_psd_t psd) {
+  if (psd == NULL) return;
+  _unet_psd_t *upsd = psd;
+  unet_fft_destroy(upsd->fft);
+  free(upsd->win);
+  free(upsd->xr);
+  free(upsd->xi);
+  free(upsd->zr);
+  free(upsd->zi);
+  free(upsd->acc);
+  free(upsd->level);
+  free(upsd);
+}
+
+int unet_psd_nbins(unet_psd_t psd) {
+  if (psd == NULL) return -1;
+  return ((_unet_psd_t *)psd)->nbins;
+}
+
+static void transform(_unet_psd_t *psd) {
+  unet_fft_forward(psd->fft, psd->zr, psd->zi);
+  accum(psd->acc, psd->zr, psd->zi, psd->nfft);
+}
+
+// Convert the accumulated power to density and pass the frame on. For real
+// segments a and b packed as z = a + jb, |A[k]|^2 + |B[k]|^2 is half of
+// |Z[k]|^2 + |Z[n-k]|^2, which also holds when b is 0.
+static int emit(_unet_psd_t *psd) {
+  int n = psd->nfft;
+  double scale = psd->scale / psd->nseg;
+  if (psd->complex) {
+    for (int k = 0; k < n; k++) psd->level[k] = (float)(10 * log10(psd->acc[(k + n / 2) % n] * scale + 1e-30));
+  } else {
+    for (int k = 0; k <= n / 2; k++) {
+      double p = (psd->acc[k] + psd->acc[(n - k) % n]) / 2;
+      if (k > 0 && k < n / 2) p *= 2;
+      psd->level[k] = (float)(10 * log10(p * scale + 1e-30));
+    }
+  }
+  unet_psd_frame_t frame;
+  frame.level = psd->level;
+  frame.nbins = psd->nbins;
+  frame.f0 = psd->complex ? psd->fc - psd->fs / 2 : 0;
+  frame.df = psd->fs / (float)n;
+  frame.time = psd->reftime + llround((double)(psd->fstart - psd->refidx) * 1e6 / psd->fs);
+  frame.navg = psd->nseg;
+  frame.seq = psd->seq++;
+  memset(psd->acc, 0, sizeof(float) * (size_t)n);
+  psd->nseg = 0;
+  return psd->sink(psd->ctx, &frame);
+}
+
+// window a full segment and add its periodogram
+static int segment(_unet_psd_t *psd) {
+  int n = psd->nfft;
+  if (psd->nseg == 0 && !psd->half) psd->fstart = psd->start;
+  if (psd->complex) {
+    for (int i = 0; i < n; i++) {
+      psd->zr[i] = psd->xr[i] * psd->win[i];
+      psd->zi[i] = psd->xi[i] * psd->win[i];
+    }
+    transform(psd);
+  } else if (!psd->half) {
+    for (int i = 0; i < n; i++) psd->zr[i] = psd->xr[i] * psd->win[i];
+    psd->half = true;
+  } else {
+    for (int i = 0; i < n; i++) psd->zi[i] = psd->xr[i] * psd->win[i];
+    transform(psd);
+    psd->half = false;
+  }
+  if (++psd->nseg < psd->navg) return 0;
+  if (psd->half) {
+    memset(psd->zi, 0, sizeof(float) * (size_t)n);
+    transform(psd);
+    psd->half = false;
+  }
+  return emit(psd);
+}
+
+int unet_psd_process(unet_psd_t psd, const float *signal, int nsamples) {
+  if (psd == NULL || signal == NULL || nsamples < 0) return -1;
+  _unet_psd_t *upsd = psd;
+  while (nsamples > 0) {
+    int k = upsd->nfft - upsd->fill;
+    if (k > nsamples) k = nsamples;
+    if (upsd->complex) {
+      float *chans[2] = { upsd->xr + upsd->fill, upsd->xi + upsd->fill };
+      unet_conv_deinterleave(chans, signal, 2, (size_t)k);
+      signal += 2 * k;
+    } else {
+      memcpy(upsd->xr + upsd->fill, signal, sizeof(float) * (size_t)k);
+      signal += k;
+    }
+    nsamples -= k;
+    upsd->fill += k;
+    if (upsd->fill < upsd->nfft) break;
+    int rv = segment(upsd);
+    if (rv != 0) return rv;
+    int keep = upsd->nfft - upsd->hop;
+    memmove(upsd->xr, upsd->xr + upsd->hop, sizeof(float) * (size_t)keep);
+    if (upsd->complex) memmove(upsd->xi, upsd->xi + upsd->hop, sizeof(float) * (size_t)keep);
+    upsd->fill = keep;
+    upsd->start += upsd->hop;
+  }
+  return 0;
+}
+
+int unet_psd_block(void *ctx, const unet_block_t *blk) {
+  _unet_psd_t *psd = ctx;
+  if (psd == NULL || blk == NULL || psd->complex != (blk->fc > 0)) return 1;
+  if (blk->gap > 0) {
+    psd->start += psd->fill + blk->gap;
+    psd->fill = 0;
+  }
+  psd->refidx = psd->start + psd->fill;
+  psd->reftime = blk->rxtime;
+  int rv = unet_psd_process(psd, blk->signal, blk->nsamples);
+  return rv < 0 ? 1 : rv;
+}
+
+int unet_psd_log(void *ctx, const unet_psd_frame_t *frame) {
+  FILE *fp = ctx;
+  if (fp == NULL || frame == NULL) return 1;
+  if (fprintf(fp, "%lld,%llu,%.3f,%.6f", frame->time, frame->seq, frame->f0, frame->df) < 0) return 1;
+  for (int k = 0; k < frame->nbins; k++) {
+    if (fprintf(fp, ",%.1f", frame->level[k]) < 0) return 1;
+  }
+  return fputc('\n', fp) == EOF ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+#ifndef _UNETPSD_H_
+#define _UNETPSD_H_
+
+#include <stdio.h>
+#include "unet_stream.h"
+#include "unet_siggen.h"
+
+typedef void *unet_psd_t;          ///< streaming spectrum analyzer
+
+/// Spectral frame, the power spectral density averaged over navg segments
+
+typedef struct {
+  const float *level;              ///< density in each bin from the lowest frequency up (dB re full scale^2/Hz)
+  int nbins;                       ///< number of bins
+  float f0;                        ///< frequency of the first bin (Hz)
+  float df;                        ///< bin spacing (Hz)
+  long long time;                  ///< modem time of the first sample of the frame (us)
+  int navg;                        ///< number of segments averaged
+  unsigned long long seq;          ///< frame sequence number
+} unet_psd_frame_t;
+
+/// Spectral frame sink. A non-zero return value stops the analyzer's signal
+/// source.
+
+typedef int (*unet_psd_sink_t)(void *ctx, const unet_psd_frame_t *frame);
+
+/// Largest FFT size
+
+#define PSD_MAXFFT               65536
+
+/// Create a streaming spectrum analyzer. The signal is cut into windowed
+/// segments of nfft samples, overlapping by the given fraction, and the
+/// periodograms of navg segments are averaged into each output frame (Welch's
+/// method). With navg set to 1 the frames form a spectrogram. Passband signals
+/// give a one-sided spectrum of nfft / 2 + 1 bins from 0 to fs / 2, and
+/// baseband signals a two-sided spectrum of nfft bins centered on fc. Pairs of
+/// real segments share one complex FFT.
+///
+/// @param fs               Sampling rate (Hz)
+/// @param fc               Carrier frequency for baseband signals, 0 for
+///                         passband signals (Hz)
+/// @param nfft             Segment length, a power of 2 from 16 to PSD_MAXFFT
+/// @param window           Segment window (SIGGEN_RECT, SIGGEN_HANN,
+///                         SIGGEN_HAMMING, SIGGEN_BLACKMAN, or SIGGEN_TUKEY
+///                         with half of the segment tapered)
+/// @param overlap          Overlap between segments, 0 to 0.9
+/// @param navg             Segments per frame
+/// @param sink             Frame sink
+/// @param ctx              User context passed to the sink
+/// @return                 Analyzer, or NULL on error
+
+unet_psd_t unet_psd_create(float fs, float fc, int nfft, int window, float overlap, int navg, unet_psd_sink_t sink, void *ctx);
+
+/// Destroy a spectrum analyzer. A partly averaged frame is discarded.
+///
+/// @param psd              Analyzer
+
+void unet_psd_destroy(unet_psd_t psd);
+
+/// Get the number of bins in each frame.
+///
+/// @param psd              Analyzer
+/// @return                 Number of bins, -1 on error
+
+int unet_psd_nbins(unet_psd_t psd);
+
+/// Feed a block of a continuous signal to a spectrum analyzer. Frame times
+/// count from the time of the last block passed to unet_psd_block(), or from
+/// 0 at the start of the stream.
+///
+/// @param psd              Analyzer
+/// @param signal           Signal samples
+/// @param nsamples         Number of samples (complex samples for baseband)
+/// @return                 0 to continue, non-zero if the frame sink asked to
+///                         stop, -1 on error
+
+int unet_psd_process(unet_psd_t psd, const float *signal, int nsamples);
+
+/// Block sink that feeds a signal block to a spectrum analyzer, for use with
+/// unetsocket_ext_pbstream() or unetsocket_ext_bbstream(). A segment cut by a
+/// gap is dropped, so that missing samples do not bias the average.
+///
+/// @param ctx              Analyzer
+/// @param blk              Signal block
+/// @return                 0 to continue, non-zero if the frame sink asked to
+///                         stop or on error
+
+int unet_psd_block(void *ctx, const unet_block_t *blk);
+
+/// Frame sink that logs frames to a text file, one line per frame with the
+/// time, sequence number, first bin frequency, bin spacing and the level of
+/// each bin to 0.1 dB.
+///
+/// @param ctx              Open file (FILE *)
+/// @param frame            Spectral frame
+/// @return                 0 on success, 1 if the file could not be written
+
+int unet_psd_log(void *ctx, const unet_psd_frame_t *frame);
+
+#endif
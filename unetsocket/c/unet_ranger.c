@@ -0,0 +1,269 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_ext.h"
+#include "unet_ranger.h"
+#include "unet_txtime.h"
+#include "pthreadwindows.h"
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+  long long time;
+  float peak;
+  float snr;
+} _ranger_reply_t;
+
+typedef struct {
+  unsigned long long seq;
+  long long txtime;
+  _ranger_reply_t reply[RANGER_MAXTRANSPONDERS][RANGER_MAXREPLIES];
+  int nreplies[RANGER_MAXTRANSPONDERS];
+  float range[RANGER_MAXTRANSPONDERS];
+  long long rxtime[RANGER_MAXTRANSPONDERS];
+  float snr[RANGER_MAXTRANSPONDERS];
+} _ranger_ping_t;
+
+typedef struct {
+  float fs;
+  float maxrange;
+  float speed;
+  unet_corr_t corr;
+  float turnaround[RANGER_MAXTRANSPONDERS];
+  float maxturnaround;
+  int ntransponders;
+  pthread_mutex_t lock;              // protects fired and nfired
+  long long fired[RANGER_MAXPINGS];
+  int nfired;
+  _ranger_ping_t ping[RANGER_MAXPINGS];   // pings waiting for replies, oldest first
+  int npings;
+  unsigned long long seq;
+  unet_range_sink_t sink;
+  void *ctx;
+} _unet_ranger_t;
+
+typedef struct {
+  _unet_ranger_t *rng;
+  unetsocket_t sock;
+  fjage_gw_t gw;
+  float *ping;
+  int nsamples;
+  long long interval;                // us
+  long long next;                    // modem time of the next ping, 0 before the first block
+  char ids[RANGER_MAXPINGS][FRAME_ID_LEN];  // pings awaiting a TxFrameNtf, oldest first
+  int nids;
+  bool failed;
+} _pbrange_t;
+
+// add a reply to the oldest ping whose reply window it falls in, replacing
+// its weakest reply if it already has as many as it can keep
+static int detect(void *ctx, const unet_detection_t *det) {
+  _unet_ranger_t *rng = ctx;
+  int t = det->ref;
+  double window = 2e6 * rng->maxrange / rng->speed;
+  for (int i = 0; i < rng->npings; i++) {
+    _ranger_ping_t *p = &rng->ping[i];
+    double dt = (double)(det->time - p->txtime) - 1e6 * rng->turnaround[t];
+    if (dt < 0 || dt > window) continue;
+    _ranger_reply_t *r = p->reply[t];
+    int k = p->nreplies[t];
+    if (k == RANGER_MAXREPLIES) {
+      k = 0;
+      for (int j = 1; j < RANGER_MAXREPLIES; j++) if (r[j].peak < r[k].peak) k = j;
+      if (r[k].peak >= det->peak) break;
+      memmove(r + k, r + k + 1, sizeof(_ranger_reply_t) * (size_t)(RANGER_MAXREPLIES - 1 - k));
+      k = RANGER_MAXREPLIES - 1;
+    } else p->nreplies[t]++;
+    r[k].time = det->time;
+    r[k].peak = det->peak;
+    r[k].snr = det->snr;
+    break;
+  }
+  return 0;
+}
+
+unet_ranger_t unet_ranger_create(float fs, int maxlen, float maxrange, unet_range_sink_t sink, void *ctx) {
+  if (fs <= 0 || maxlen < 1 || maxrange <= 0 || sink == NULL) return NULL;
+  _unet_ranger_t *rng = calloc(1, sizeof(_unet_ranger_t));
+  if (rng == NULL) return NULL;
+  rng->fs = fs;
+  rng->maxrange = maxrange;
+  rng->speed = RANGER_SOUNDSPEED;
+  rng->sink = sink;
+  rng->ctx = ctx;
+  rng->corr = unet_corr_create(fs, 0, maxlen, detect, rng);
+  if (rng->corr == NULL) {
+    free(rng);
+    return NULL;
+  }
+  pthread_mutex_init(&rng->lock, NULL);
+  return rng;
+}
+
+void unet_ranger_destroy(unet_ranger_t rng) {
+  if (rng == NULL) return;
+  _unet_ranger_t *urng = rng;
+  pthread_mutex_destroy(&urng->lock);
+  unet_corr_destroy(urng->corr);
+  free(urng);
+}
+
+int unet_ranger_add(unet_ranger_t rng, const float *reply, int nsamples, float turnaround) {
+  if (rng == NULL || turnaround < 0) return -1;
+  _unet_ranger_t *urng = rng;
+  int t = unet_corr_add(urng->corr, reply, nsamples);
+  if (t < 0) return -1;
+  urng->turnaround[t] = turnaround;
+  if (turnaround > urng->maxturnaround) urng->maxturnaround = turnaround;
+  urng->ntransponders = t + 1;
+  return t;
+}
+
+int unet_ranger_set_soundspeed(unet_ranger_t rng, float speed) {
+  if (rng == NULL || speed <= 0) return -1;
+  ((_unet_ranger_t *)rng)->speed = speed;
+  return 0;
+}
+
+int unet_ranger_set_threshold(unet_ranger_t rng, float threshold) {
+  if (rng == NULL) return -1;
+  return unet_corr_set_threshold(((_unet_ranger_t *)rng)->corr, threshold);
+}
+
+int unet_ranger_ping(unet_ranger_t rng, long long txtime) {
+  if (rng == NULL) return -1;
+  _unet_ranger_t *urng = rng;
+  int rv = -1;
+  pthread_mutex_lock(&urng->lock);
+  if (urng->nfired < RANGER_MAXPINGS) {
+    urng->fired[urng->nfired++] = txtime;
+    rv = 0;
+  }
+  pthread_mutex_unlock(&urng->lock);
+  return rv;
+}
+
+// move pings registered through the API to the list waiting for replies,
+// keeping it in order of transmission, as far as there is room
+static void collect(_unet_ranger_t *rng) {
+  pthread_mutex_lock(&rng->lock);
+  int i = 0;
+  for (; i < rng->nfired && rng->npings < RANGER_MAXPINGS; i++) {
+    int j = rng->npings++;
+    while (j > 0 && rng->ping[j - 1].txtime > rng->fired[i]) {
+      rng->ping[j] = rng->ping[j - 1];
+      j--;
+    }
+    _ranger_ping_t *p = &rng->ping[j];
+    p->seq = rng->seq++;
+    p->txtime = rng->fired[i];
+    memset(p->nreplies, 0, sizeof(p->nreplies));
+  }
+  rng->nfired -= i;
+  memmove(rng->fired, rng->fired + i, sizeof(long long) * (size_t)rng->nfired);
+  pthread_mutex_unlock(&rng->lock);
+}
+
+// emit the fixes of pings whose reply windows end before time
+static int emit(_unet_ranger_t *rng, long long time) {
+  long long window = llround(1e6 * (rng->maxturnaround + 2 * rng->maxrange / rng->speed));
+  while (rng->npings > 0 && rng->ping[0].txtime + window < time) {
+    _ranger_ping_t p = rng->ping[0];
+    rng->npings--;
+    memmove(rng->ping, rng->ping + 1, sizeof(_ranger_ping_t) * (size_t)rng->npings);
+    // the direct path is the first reply within RANGER_FIRST of the strongest
+    float ratio = powf(10.0f, -RANGER_FIRST / 20);
+    for (int t = 0; t < rng->ntransponders; t++) {
+      const _ranger_reply_t *r = p.reply[t];
+      float best = 0;
+      for (int j = 0; j < p.nreplies[t]; j++) if (r[j].peak > best) best = r[j].peak;
+      int k = 0;
+      while (k < p.nreplies[t] && r[k].peak < best * ratio) k++;
+      if (k < p.nreplies[t]) {
+        double dt = (double)(r[k].time - p.txtime) - 1e6 * rng->turnaround[t];
+        p.range[t] = (float)(rng->speed * dt / 2e6);
+        p.rxtime[t] = r[k].time;
+        p.snr[t] = r[k].snr;
+      } else {
+        p.range[t] = -1;
+        p.rxtime[t] = 0;
+        p.snr[t] = 0;
+      }
+    }
+    unet_range_fix_t fix;
+    fix.seq = p.seq;
+    fix.txtime = p.txtime;
+    fix.ntransponders = rng->ntransponders;
+    fix.range = p.range;
+    fix.rxtime = p.rxtime;
+    fix.snr = p.snr;
+    int rv = rng->sink(rng->ctx, &fix);
+    if (rv != 0) return rv;
+  }
+  return 0;
+}
+
+int unet_ranger_block(void *ctx, const unet_block_t *blk) {
+  _unet_ranger_t *rng = ctx;
+  if (rng == NULL || blk == NULL || fabsf(blk->fs - rng->fs) > 1e-3f * rng->fs) return 1;
+  collect(rng);
+  int rv = unet_corr_block(rng->corr, blk);
+  if (rv != 0) return rv;
+  // every reply starting before this time has been detected
+  long long done = blk->rxtime + llround((double)(blk->nsamples - unet_corr_latency(rng->corr)) * 1e6 / rng->fs);
+  return emit(rng, done);
+}
+
+// drop the TxFrameNtfs of our own pings, leaving those of other transmissions
+static void confirm(_pbrange_t *p) {
+  for (int i = 0; i < p->nids; i++) {
+    fjage_msg_t ntf = fjage_receive(p->gw, "org.arl.unet.phy.TxFrameNtf", p->ids[i], 0);
+    if (ntf == NULL) continue;
+    fjage_msg_destroy(ntf);
+    memmove(p->ids[i], p->ids[i + 1], (size_t)(p->nids - i - 1) * FRAME_ID_LEN);
+    p->nids--;
+    i--;
+  }
+}
+
+static int pbrange_block(void *ctx, const unet_block_t *blk) {
+  _pbrange_t *p = ctx;
+  confirm(p);
+  long long dur = llround(blk->nsamples * 1e6 / blk->fs);
+  long long end = blk->rxtime + dur;
+  long long lead = (long long)RANGER_LEAD * 1000;
+  if (p->next == 0) p->next = end + lead;
+  // pings are scheduled up to a block ahead of the lead, so that each is
+  // requested at least the lead ahead of it even with long blocks, and pings
+  // that a late block leaves less than the lead ahead are skipped
+  while (p->next <= end + lead + dur) {
+    if (p->next >= end + lead) {
+      // forget the oldest unconfirmed ping if there are too many
+      if (p->nids == RANGER_MAXPINGS) memmove(p->ids[0], p->ids[1], (size_t)(--p->nids) * FRAME_ID_LEN);
+      if (unetsocket_ext_tx_signal_at(p->sock, p->ping, p->nsamples, 0, p->next, p->ids[p->nids]) < 0 || unet_ranger_ping(p->rng, p->next) < 0) {
+        p->failed = true;
+        return 1;
+      }
+      p->nids++;
+    }
+    p->next += p->interval;
+  }
+  return unet_ranger_block(p->rng, blk);
+}
+
+int unetsocket_ext_pbrange(unetsocket_t sock, int blksize, unet_ranger_t rng, float *ping, int nsamples, int interval) {
+  if (sock == NULL || rng == NULL || ping == NULL || nsamples < 1 || interval <= 0) return -1;
+  _pbrange_t p;
+  p.rng = rng;
+  p.sock = sock;
+  p.gw = unetsocket_get_gateway(sock);
+  p.ping = ping;
+  p.nsamples = nsamples;
+  p.interval = (long long)interval * 1000;
+  p.next = 0;
+  p.nids = 0;
+  p.failed = false;
+  int rv = unetsocket_ext_pbstream(sock, blksize, pbrange_block, &p);
+  return p.failed ? -1 : rv;
+}
@@ -0,0 +1,141 @@
+#ifndef _UNETRANGER_H_
+#define _UNETRANGER_H_
+
+#include "unet.h"
+#include "unet_stream.h"
+#include "unet_corr.h"
+
+typedef void *unet_ranger_t;       ///< transponder ranging engine
+
+/// Ranges measured from one ping
+
+typedef struct {
+  unsigned long long seq;          ///< ping sequence number
+  long long txtime;                ///< modem time of the start of the ping (us)
+  int ntransponders;               ///< number of transponders
+  const float *range;              ///< range to each transponder (m), negative if it did not reply
+  const long long *rxtime;         ///< modem time of the start of each reply (us), 0 if none
+  const float *snr;                ///< SNR of each reply (dB)
+} unet_range_fix_t;
+
+/// Range fix sink, called once the reply window of a ping has passed. A
+/// non-zero return value stops the ranging engine's signal source.
+
+typedef int (*unet_range_sink_t)(void *ctx, const unet_range_fix_t *fix);
+
+/// Largest number of transponders
+
+#define RANGER_MAXTRANSPONDERS   CORR_MAXREFS
+
+/// Largest number of pings waiting for replies
+
+#define RANGER_MAXPINGS          16
+
+/// Level below the strongest reply from a transponder within which an earlier
+/// reply is taken as the direct path (dB)
+
+#define RANGER_FIRST             10.0f
+
+/// Largest number of replies kept per transponder and ping
+
+#define RANGER_MAXREPLIES        8
+
+/// Default sound speed (m/s)
+
+#define RANGER_SOUNDSPEED        1500.0f
+
+/// Least time from scheduling a ping to its transmission in unetsocket_ext_pbrange() (ms)
+
+#define RANGER_LEAD              200
+
+/// Create a transponder ranging engine. The engine is told when pings are
+/// transmitted, and is fed the passband signal recorded around them. Replies
+/// from each transponder are detected with a matched filter (unet_corr.h).
+/// The first reply from a transponder within the reply window of a ping that
+/// is within RANGER_FIRST of the strongest is taken as the direct path, which
+/// rejects leakage from the replies of other transponders. Its range is half
+/// the round trip time, less the transponder's turnaround time, times the
+/// sound speed.
+///
+/// @param fs               Sampling rate of the recorded signal (Hz)
+/// @param maxlen           Largest length of a reply signal (samples)
+/// @param maxrange         Largest range to a transponder (m)
+/// @param sink             Range fix sink
+/// @param ctx              User context passed to the sink
+/// @return                 Ranging engine, or NULL on error
+
+unet_ranger_t unet_ranger_create(float fs, int maxlen, float maxrange, unet_range_sink_t sink, void *ctx);
+
+/// Destroy a ranging engine. Pings waiting for replies are discarded.
+///
+/// @param rng              Ranging engine
+
+void unet_ranger_destroy(unet_ranger_t rng);
+
+/// Add a transponder. Transponders sharing a ping must reply with signals
+/// that the matched filter can tell apart, such as tones or chirps in
+/// different bands.
+///
+/// @param rng              Ranging engine
+/// @param reply            Passband reply signal of the transponder
+/// @param nsamples         Number of samples, up to maxlen
+/// @param turnaround       Time from the start of the ping arriving at the
+///                         transponder to the start of its reply (s)
+/// @return                 Index of the transponder, -1 on error
+
+int unet_ranger_add(unet_ranger_t rng, const float *reply, int nsamples, float turnaround);
+
+/// Set the sound speed used to convert travel times to ranges.
+///
+/// @param rng              Ranging engine
+/// @param speed            Sound speed (m/s)
+/// @return                 0 on success, -1 otherwise
+
+int unet_ranger_set_soundspeed(unet_ranger_t rng, float speed);
+
+/// Set the reply detection threshold.
+///
+/// @param rng              Ranging engine
+/// @param threshold        Ratio of peak to noise correlation power (dB)
+/// @return                 0 on success, -1 otherwise
+
+int unet_ranger_set_threshold(unet_ranger_t rng, float threshold);
+
+/// Register a ping. Replies are matched to the oldest ping whose reply window
+/// they fall in, so pings should be spaced by more than the reply window of
+/// the farthest transponder. This function may be called from any thread.
+///
+/// @param rng              Ranging engine
+/// @param txtime           Modem time of the start of the ping (us)
+/// @return                 0 on success, -1 if too many pings are waiting
+
+int unet_ranger_ping(unet_ranger_t rng, long long txtime);
+
+/// Block sink that feeds a passband signal block to a ranging engine, for use
+/// with unetsocket_ext_pbstream(). Gaps are filled with zeros.
+///
+/// @param ctx              Ranging engine
+/// @param blk              Signal block
+/// @return                 0 to continue, non-zero if the fix sink asked to
+///                         stop or on error
+
+int unet_ranger_block(void *ctx, const unet_block_t *blk);
+
+/// Range transponders continuously. A ping is scheduled every interval at an
+/// exact modem time with unetsocket_ext_tx_signal_at() (unet_txtime.h), at
+/// least RANGER_LEAD ms ahead, while the passband signal is streamed into the
+/// ranging engine, until the fix sink asks to stop. Pings that a late block
+/// leaves less than RANGER_LEAD ms ahead are skipped. Only the TxFrameNtfs of
+/// the pings are consumed.
+///
+/// @param sock             Unet socket
+/// @param blksize          Samples per block, 0 for PBSBLK
+/// @param rng              Ranging engine, created for bb.adcrate
+/// @param ping             Passband ping signal at bb.dacrate
+/// @param nsamples         Number of samples in the ping
+/// @param interval         Ping interval (ms)
+/// @return                 0 when stopped by the fix sink, -1 on error
+
+int unetsocket_ext_pbrange(unetsocket_t sock, int blksize, unet_ranger_t rng, float *ping, int nsamples, int interval);
+
+#endif
@@ -0,0 +1,128 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_ranging.h"
+#include "unet_time.h"
+#include <string.h>
+
+#define RANGING_IDLEN            64
+
+typedef struct {
+  fjage_gw_t gw;
+  fjage_aid_t agent;
+} _unet_ranging_t;
+
+typedef struct {
+  char id[RANGING_IDLEN];
+  long long deadline;
+  bool agreed;
+  bool done;
+} _ranging_req_t;
+
+unet_ranging_t unet_ranging_open(unetsocket_t sock) {
+  if (sock == NULL) return NULL;
+  _unet_ranging_t *rs = calloc(1, sizeof(_unet_ranging_t));
+  if (rs == NULL) return NULL;
+  rs->gw = unetsocket_get_gateway(sock);
+  rs->agent = fjage_agent_for_service(rs->gw, "org.arl.unet.Services.RANGING");
+  if (rs->agent == NULL) {
+    free(rs);
+    return NULL;
+  }
+  fjage_subscribe_agent(rs->gw, rs->agent);
+  return rs;
+}
+
+void unet_ranging_close(unet_ranging_t rs) {
+  if (rs == NULL) return;
+  _unet_ranging_t *urs = rs;
+  fjage_aid_destroy(urs->agent);
+  free(urs);
+}
+
+// Apply a reply or notification to the request it belongs to, found by the
+// request it replies to or, for notifications without one, by the node.
+static int update(fjage_msg_t msg, _ranging_req_t *req, const int *to, int n, float *range, int *status) {
+  const char *inreplyto = fjage_msg_get_in_reply_to(msg);
+  bool ntf = strcmp(fjage_msg_get_clazz(msg), rangentf) == 0;
+  int i = -1;
+  if (inreplyto != NULL) {
+    for (int j = 0; j < n && i < 0; j++) if (!req[j].done && strcmp(req[j].id, inreplyto) == 0) i = j;
+  }
+  if (i < 0 && ntf) {
+    int node = fjage_msg_get_int(msg, "to", -1);
+    for (int j = 0; j < n && i < 0; j++) if (!req[j].done && req[j].agreed && to[j] == node) i = j;
+  }
+  if (i < 0) return 0;
+  if (ntf) {
+    range[i] = fjage_msg_get_float(msg, "range", -1);
+    status[i] = RANGING_OK;
+  } else {
+    fjage_perf_t perf = fjage_msg_get_performative(msg);
+    if (perf == FJAGE_AGREE) {
+      req[i].agreed = true;
+      return 0;
+    }
+    status[i] = RANGING_REFUSED;
+  }
+  req[i].done = true;
+  return 1;
+}
+
+int unet_ranging_range(unet_ranging_t rs, const int *to, int n, long timeout, float *range, int *status) {
+  if (rs == NULL || to == NULL || n < 1 || n > RANGING_MAXNODES || timeout < 0 || range == NULL) return -1;
+  _unet_ranging_t *urs = rs;
+  _ranging_req_t *req = calloc((size_t)n, sizeof(_ranging_req_t));
+  int *st = status != NULL ? status : malloc(sizeof(int) * (size_t)n);
+  if (req == NULL || st == NULL) {
+    free(req);
+    if (st != status) free(st);
+    return -1;
+  }
+  int pending = 0;
+  for (int i = 0; i < n; i++) {
+    range[i] = -1;
+    st[i] = RANGING_NOREPLY;
+    fjage_msg_t msg = fjage_msg_create(rangereq, FJAGE_REQUEST);
+    fjage_msg_set_recipient(msg, urs->agent);
+    fjage_msg_add_int(msg, "to", to[i]);
+    strncpy(req[i].id, fjage_msg_get_id(msg), RANGING_IDLEN - 1);
+    req[i].deadline = unet_host_time_ms() + timeout;
+    if (fjage_send(urs->gw, msg) < 0) {
+      st[i] = RANGING_REFUSED;
+      req[i].done = true;
+    } else pending++;
+  }
+  while (pending > 0) {
+    long long now = unet_host_time_ms();
+    long long next = now + RANGING_POLL;
+    for (int i = 0; i < n; i++) {
+      if (req[i].done) continue;
+      if (req[i].deadline <= now) {
+        req[i].done = true;
+        pending--;
+      } else if (req[i].deadline < next) next = req[i].deadline;
+    }
+    if (pending == 0) break;
+    // replies that refuse a request come without a notification
+    for (int i = 0; i < n; i++) {
+      if (req[i].done || req[i].agreed) continue;
+      fjage_msg_t msg = fjage_receive(urs->gw, NULL, req[i].id, 0);
+      if (msg == NULL) continue;
+      pending -= update(msg, req, to, n, range, st);
+      fjage_msg_destroy(msg);
+    }
+    if (pending == 0) break;
+    fjage_msg_t ntf = fjage_receive(urs->gw, rangentf, NULL, (long)(next - now));
+    if (ntf != NULL) {
+      pending -= update(ntf, req, to, n, range, st);
+      fjage_msg_destroy(ntf);
+    }
+  }
+  int count = 0;
+  for (int i = 0; i < n; i++) if (st[i] == RANGING_OK) count++;
+  free(req);
+  if (st != status) free(st);
+  return count;
+}
@@ -0,0 +1,53 @@
+#ifndef _UNETRANGING_H_
+#define _UNETRANGING_H_
+
+#include "unet.h"
+
+typedef void *unet_ranging_t;      ///< client of the ranging service
+
+/// Ranging status of a node
+
+#define RANGING_OK               0      ///< range measured
+#define RANGING_NOREPLY          1      ///< no range before the deadline
+#define RANGING_REFUSED          2      ///< request refused or failed
+
+/// Largest number of nodes ranged at once
+
+#define RANGING_MAXNODES         256
+
+/// Longest wait between checks for refused requests (ms)
+
+#define RANGING_POLL             (TIMEOUT / 10)
+
+/// Open a client of the ranging service of a modem. The ranging agent is
+/// looked up and subscribed to once, for all the ranging done through the
+/// client.
+///
+/// @param sock             Unet socket
+/// @return                 Ranging client, or NULL on error
+
+unet_ranging_t unet_ranging_open(unetsocket_t sock);
+
+/// Close a ranging client.
+///
+/// @param rs               Ranging client
+
+void unet_ranging_close(unet_ranging_t rs);
+
+/// Range several nodes at once. A range request is sent to every node before
+/// any reply is awaited, and range notifications are matched to the nodes as
+/// they arrive, so a node that is slow to reply or out of reach only holds up
+/// its own result. Each node has until timeout ms after its request was sent.
+///
+/// @param rs               Ranging client
+/// @param to               Addresses of the nodes to range
+/// @param n                Number of nodes, up to RANGING_MAXNODES
+/// @param timeout          Time allowed for each node (ms)
+/// @param range            Range to each node (m), negative if not measured
+/// @param status           Status of each node (RANGING_OK, RANGING_NOREPLY
+///                         or RANGING_REFUSED), or NULL
+/// @return                 Number of nodes ranged, -1 on error
+
+int unet_ranging_range(unet_ranging_t rs, const int *to, int n, long timeout, float *range, int *status);
+
+#endif
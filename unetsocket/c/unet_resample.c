@@ -0,0 +1,353 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_resample.h"
+#include "unet_simd.h"
+#include "unet_dsp.h"
+#include "pthreadwindows.h"
+#include <string.h>
+#include <math.h>
+
+#define RESAMPLE_ALIGN           8      // taps per phase are a multiple of this
+#define RESAMPLE_CUTOFF          0.90   // filter cutoff relative to the lower Nyquist frequency
+#define RESAMPLE_BETA            9.0    // Kaiser window shape
+#define RESAMPLE_PI              3.14159265358979323846
+
+typedef float (*dot_t)(const float *a, const float *b, int n);
+
+static pthread_once_t dot_ready = PTHREAD_ONCE_INIT;
+static dot_t dot = NULL;
+
+typedef struct {
+  float inrate;
+  float outrate;
+  int up;
+  int down;
+  int taps;                          // filter taps per phase
+  float *coef;                       // up phases of taps coefficients, time-reversed
+  float *x;                          // history followed by new input
+  int xlen;
+  int base;                          // index in x of the oldest sample for the next output
+  int phase;
+  long long nin;                     // input samples since reset
+  long long nout;                    // output samples since reset
+  // sample source adapter
+  unet_sample_source_t source;
+  void *srcctx;
+  float *in;
+  float *out;
+  int outlen;
+  int outpos;
+  bool eof;
+  // block sink adapter
+  unet_block_sink_t sink;
+  void *sinkctx;
+  float *blkout;
+  int blkcap;
+  long long reftime;                 // time of the first block since reset
+  bool started;
+  unsigned long long seq;
+} _unet_resample_t;
+
+static float dot_scalar(const float *a, const float *b, int n) {
+  float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for (int i = 0; i < n; i += 4) {
+    s0 += a[i] * b[i];
+    s1 += a[i + 1] * b[i + 1];
+    s2 += a[i + 2] * b[i + 2];
+    s3 += a[i + 3] * b[i + 3];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static float dot_sse2(const float *a, const float *b, int n) {
+  __m128 s0 = _mm_setzero_ps();
+  __m128 s1 = _mm_setzero_ps();
+  for (int i = 0; i < n; i += 8) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  float s[4];
+  _mm_storeu_ps(s, _mm_add_ps(s0, s1));
+  return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+UNET_TARGET("avx2")
+static float dot_avx2(const float *a, const float *b, int n) {
+  __m256 s0 = _mm256_setzero_ps();
+  __m256 s1 = _mm256_setzero_ps();
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+  }
+  if (i < n) s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  __m256 s = _mm256_add_ps(s0, s1);
+  __m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+  h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+  h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+  return _mm_cvtss_f32(h);
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static float dot_neon(const float *a, const float *b, int n) {
+  float32x4_t s0 = vdupq_n_f32(0);
+  float32x4_t s1 = vdupq_n_f32(0);
+  for (int i = 0; i < n; i += 8) {
+    s0 = vfmaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+    s1 = vfmaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  return vaddvq_f32(vaddq_f32(s0, s1));
+}
+
+#endif
+
+static void dot_init(void) {
+  dot = dot_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) dot = dot_sse2;
+  if (UNET_HAS_AVX2()) dot = dot_avx2;
+#endif
+#ifdef UNET_SIMD_NEON
+  dot = dot_neon;
+#endif
+}
+
+static long gcd(long a, long b) {
+  while (b != 0) {
+    long t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Kaiser-windowed sinc prototype at up times the input rate, split into
+// phases. Phase p holds taps h[p + j*up], stored in reverse so that each
+// output is a dot product with consecutive input samples.
+static void design(_unet_resample_t *r) {
+  int n = r->up * r->taps;
+  double center = n / 2;
+  double fc = 0.5 * RESAMPLE_CUTOFF / (r->up > r->down ? r->up : r->down);
+  double i0beta = unet_bessel_i0(RESAMPLE_BETA);
+  double sum = 0;
+  double *h = malloc(sizeof(double) * (size_t)n);
+  if (h == NULL) return;
+  for (int i = 0; i < n; i++) {
+    double t = i - center;
+    double s = fabs(t) < 1e-9 ? 2 * fc : sin(2 * RESAMPLE_PI * fc * t) / (RESAMPLE_PI * t);
+    double u = t / center;
+    double w = u * u < 1 ? unet_bessel_i0(RESAMPLE_BETA * sqrt(1 - u * u)) / i0beta : 0;
+    h[i] = s * w;
+    sum += h[i];
+  }
+  for (int p = 0; p < r->up; p++) {
+    for (int j = 0; j < r->taps; j++) {
+      r->coef[p * r->taps + r->taps - 1 - j] = (float)(h[p + j * r->up] * r->up / sum);
+    }
+  }
+  free(h);
+}
+
+unet_resample_t unet_resample_create(float inrate, float outrate) {
+  long in = lroundf(inrate);
+  long out = lroundf(outrate);
+  if (in <= 0 || out <= 0) return NULL;
+  long g = gcd(in, out);
+  if (out / g > RESAMPLE_MAXUP) return NULL;
+  _unet_resample_t *r = calloc(1, sizeof(_unet_resample_t));
+  if (r == NULL) return NULL;
+  r->inrate = (float)in;
+  r->outrate = (float)out;
+  r->up = (int)(out / g);
+  r->down = (int)(in / g);
+  // when decimating, the filter spans RESAMPLE_ZEROS zero crossings at the output rate
+  double span = 2.0 * RESAMPLE_ZEROS * (r->down > r->up ? (double)r->down / r->up : 1.0);
+  r->taps = ((int)ceil(span) + RESAMPLE_ALIGN - 1) / RESAMPLE_ALIGN * RESAMPLE_ALIGN;
+  if (r->taps > RESAMPLE_BLK) {
+    free(r);
+    return NULL;
+  }
+  r->coef = malloc(sizeof(float) * (size_t)r->up * (size_t)r->taps);
+  r->x = malloc(sizeof(float) * (size_t)(r->taps + RESAMPLE_BLK));
+  if (r->coef == NULL || r->x == NULL) {
+    unet_resample_destroy(r);
+    return NULL;
+  }
+  design(r);
+  pthread_once(&dot_ready, dot_init);
+  unet_resample_reset(r);
+  return r;
+}
+
+void unet_resample_destroy(unet_resample_t r) {
+  if (r == NULL) return;
+  _unet_resample_t *ur = r;
+  free(ur->coef);
+  free(ur->x);
+  free(ur->in);
+  free(ur->out);
+  free(ur->blkout);
+  free(ur);
+}
+
+void unet_resample_reset(unet_resample_t r) {
+  if (r == NULL) return;
+  _unet_resample_t *ur = r;
+  // start with a history of zeros, and half a filter length into it so that
+  // output k is aligned with input time k / outrate
+  memset(ur->x, 0, sizeof(float) * (size_t)ur->taps);
+  ur->xlen = ur->taps - 1;
+  ur->base = ur->taps / 2;
+  ur->phase = 0;
+  ur->nin = 0;
+  ur->nout = 0;
+  ur->outlen = 0;
+  ur->outpos = 0;
+  ur->eof = false;
+  ur->started = false;
+}
+
+int unet_resample_max_output(unet_resample_t r, int nin) {
+  if (r == NULL || nin < 0) return -1;
+  _unet_resample_t *ur = r;
+  return (int)(((long long)nin + ur->taps) * ur->up / ur->down + 1);
+}
+
+int unet_resample_process(unet_resample_t r, const float *in, int nin, float *out) {
+  if (r == NULL || in == NULL || out == NULL || nin < 0) return -1;
+  _unet_resample_t *ur = r;
+  int nout = 0;
+  ur->nin += nin;
+  while (nin > 0) {
+    int n = nin < RESAMPLE_BLK ? nin : RESAMPLE_BLK;
+    memcpy(ur->x + ur->xlen, in, sizeof(float) * (size_t)n);
+    ur->xlen += n;
+    in += n;
+    nin -= n;
+    while (ur->base + ur->taps <= ur->xlen) {
+      out[nout++] = dot(ur->coef + ur->phase * ur->taps, ur->x + ur->base, ur->taps);
+      ur->phase += ur->down;
+      ur->base += ur->phase / ur->up;
+      ur->phase %= ur->up;
+    }
+    // keep the samples still needed, which are fewer than taps
+    int keep = ur->xlen - ur->base;
+    if (keep > 0) memmove(ur->x, ur->x + ur->base, sizeof(float) * (size_t)keep);
+    ur->base = keep < 0 ? -keep : 0;
+    ur->xlen = keep > 0 ? keep : 0;
+  }
+  ur->nout += nout;
+  return nout;
+}
+
+int unet_resample_flush(unet_resample_t r, float *out) {
+  if (r == NULL || out == NULL) return -1;
+  _unet_resample_t *ur = r;
+  long long target = (ur->nin * ur->up + ur->down - 1) / ur->down;
+  if (ur->nout >= target) return 0;
+  // zeros push the last input samples through the filter, and the extra
+  // output they produce beyond the end of the signal is dropped
+  float zeros[RESAMPLE_BLK];
+  memset(zeros, 0, sizeof(float) * (size_t)ur->taps);
+  long long nin = ur->nin;
+  long long nout = ur->nout;
+  int n = unet_resample_process(r, zeros, ur->taps, out);
+  if (n < 0) return -1;
+  if (nout + n > target) n = (int)(target - nout);
+  ur->nin = nin;
+  ur->nout = nout + n;
+  return n;
+}
+
+int unet_resample_set_source(unet_resample_t r, unet_sample_source_t source, void *ctx) {
+  if (r == NULL || source == NULL) return -1;
+  _unet_resample_t *ur = r;
+  if (ur->in == NULL) ur->in = malloc(sizeof(float) * RESAMPLE_BLK);
+  if (ur->out == NULL) ur->out = malloc(sizeof(float) * (size_t)unet_resample_max_output(r, RESAMPLE_BLK));
+  if (ur->in == NULL || ur->out == NULL) return -1;
+  ur->source = source;
+  ur->srcctx = ctx;
+  return 0;
+}
+
+int unet_resample_source(void *ctx, float *buf, int nsamples) {
+  _unet_resample_t *r = ctx;
+  if (r == NULL || r->source == NULL || buf == NULL) return 0;
+  int count = 0;
+  while (count < nsamples) {
+    if (r->outpos < r->outlen) {
+      int n = r->outlen - r->outpos;
+      if (n > nsamples - count) n = nsamples - count;
+      memcpy(buf + count, r->out + r->outpos, sizeof(float) * (size_t)n);
+      r->outpos += n;
+      count += n;
+      continue;
+    }
+    if (r->eof) break;
+    int n = r->source(r->srcctx, r->in, RESAMPLE_BLK);
+    if (n > 0) r->outlen = unet_resample_process(r, r->in, n, r->out);
+    else {
+      r->outlen = unet_resample_flush(r, r->out);
+      r->eof = true;
+    }
+    r->outpos = 0;
+    if (r->outlen < 0) break;
+  }
+  return count;
+}
+
+int unet_resample_set_sink(unet_resample_t r, unet_block_sink_t sink, void *ctx) {
+  if (r == NULL || sink == NULL) return -1;
+  _unet_resample_t *ur = r;
+  ur->sink = sink;
+  ur->sinkctx = ctx;
+  return 0;
+}
+
+static int emit(_unet_resample_t *r, const float *signal, int n, float fc, long long gap) {
+  unet_block_t blk;
+  blk.signal = (float *)signal;
+  blk.nsamples = n;
+  blk.fs = r->outrate;
+  blk.fc = fc;
+  blk.rxtime = r->reftime + llround((double)(r->nout - n) * 1e6 / r->outrate);
+  blk.seq = r->seq++;
+  blk.gap = gap;
+  return r->sink(r->sinkctx, &blk);
+}
+
+int unet_resample_block(void *ctx, const unet_block_t *blk) {
+  _unet_resample_t *r = ctx;
+  if (r == NULL || r->sink == NULL || blk == NULL) return 1;
+  int need = unet_resample_max_output(r, blk->nsamples > RESAMPLE_BLK ? blk->nsamples : RESAMPLE_BLK);
+  if (need > r->blkcap) {
+    float *p = realloc(r->blkout, sizeof(float) * (size_t)need);
+    if (p == NULL) return 1;
+    r->blkout = p;
+    r->blkcap = need;
+  }
+  long long gap = 0;
+  if (r->started && blk->gap > 0) {
+    // finish the signal before the gap and restart the filter after it
+    int n = unet_resample_flush(r, r->blkout);
+    if (n > 0) {
+      int rv = emit(r, r->blkout, n, blk->fc, 0);
+      if (rv != 0) return rv;
+    }
+    unet_resample_reset(r);
+    gap = llround((double)blk->gap * r->outrate / r->inrate);
+  }
+  if (!r->started) {
+    r->started = true;
+    r->reftime = blk->rxtime;
+  }
+  int n = unet_resample_process(r, blk->signal, blk->nsamples, r->blkout);
+  if (n < 0) return 1;
+  return emit(r, r->blkout, n, blk->fc, gap);
+}
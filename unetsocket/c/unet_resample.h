@@ -0,0 +1,118 @@
+#ifndef _UNETRESAMPLE_H_
+#define _UNETRESAMPLE_H_
+
+#include "unet_stream.h"
+
+typedef void *unet_resample_t;     ///< rational sampling rate converter
+
+/// Largest interpolation factor, after reducing the ratio of the rates
+
+#define RESAMPLE_MAXUP           4096
+
+/// Zero crossings of the interpolation filter on each side of its center,
+/// at the lower of the two rates
+
+#define RESAMPLE_ZEROS           32
+
+/// Input samples filtered at a time
+
+#define RESAMPLE_BLK             4096
+
+/// Create a sampling rate converter. The rates are rounded to integers and
+/// their ratio reduced to up/down, and the signal is interpolated by up and
+/// decimated by down with a polyphase windowed-sinc filter. The filter is flat
+/// up to 80% of the lower Nyquist frequency and attenuates by over 90 dB from
+/// the Nyquist frequency up. The filter delay is compensated, so output sample
+/// k is aligned with input time k / outrate.
+///
+/// @param inrate           Input sampling rate (Hz)
+/// @param outrate          Output sampling rate (Hz)
+/// @return                 Converter, or NULL on error or if the reduced
+///                         interpolation factor exceeds RESAMPLE_MAXUP
+
+unet_resample_t unet_resample_create(float inrate, float outrate);
+
+/// Destroy a sampling rate converter.
+///
+/// @param r                Converter
+
+void unet_resample_destroy(unet_resample_t r);
+
+/// Reset a converter to its initial state, discarding buffered input.
+///
+/// @param r                Converter
+
+void unet_resample_reset(unet_resample_t r);
+
+/// Get the largest number of output samples that processing nin input
+/// samples can produce, for sizing output buffers.
+///
+/// @param r                Converter
+/// @param nin              Number of input samples
+/// @return                 Largest number of output samples
+
+int unet_resample_max_output(unet_resample_t r, int nin);
+
+/// Convert a block of a continuous signal. Output lags the input by half the
+/// filter length, and the remaining output is produced by
+/// unet_resample_flush() at the end of the signal.
+///
+/// @param r                Converter
+/// @param in               Input samples
+/// @param nin              Number of input samples
+/// @param out              Output samples, room for
+///                         unet_resample_max_output(r, nin) samples
+/// @return                 Number of output samples, -1 on error
+
+int unet_resample_process(unet_resample_t r, const float *in, int nin, float *out);
+
+/// Produce the output remaining at the end of a signal, so that the output has
+/// outrate / inrate times as many samples as the input.
+///
+/// @param r                Converter
+/// @param out              Output samples, room for
+///                         unet_resample_max_output(r, RESAMPLE_BLK) samples
+/// @return                 Number of output samples, -1 on error
+
+int unet_resample_flush(unet_resample_t r, float *out);
+
+/// Set the sample source that unet_resample_source() reads from.
+///
+/// @param r                Converter
+/// @param source           Sample source at the input rate
+/// @param ctx              User context passed to the source
+/// @return                 0 on success, -1 otherwise
+
+int unet_resample_set_source(unet_resample_t r, unet_sample_source_t source, void *ctx);
+
+/// Sample source that reads from the converter's source and converts to the
+/// output rate, for use with unetsocket_ext_tx_stream().
+///
+/// @param ctx              Converter
+/// @param buf              Buffer for the samples
+/// @param nsamples         Largest number of samples to read
+/// @return                 Number of samples read, 0 at the end of the signal
+
+int unet_resample_source(void *ctx, float *buf, int nsamples);
+
+/// Set the block sink that unet_resample_block() writes to.
+///
+/// @param r                Converter
+/// @param sink             Block sink at the output rate
+/// @param ctx              User context passed to the sink
+/// @return                 0 on success, -1 otherwise
+
+int unet_resample_set_sink(unet_resample_t r, unet_block_sink_t sink, void *ctx);
+
+/// Block sink that converts passband blocks to the output rate and passes
+/// them on to the converter's sink, for use with unetsocket_ext_pbstream().
+/// Block times are those of their first output sample, and gaps are scaled to
+/// the output rate.
+///
+/// @param ctx              Converter
+/// @param blk              Signal block
+/// @return                 The return value of the sink, or 1 on error
+
+int unet_resample_block(void *ctx, const unet_block_t *blk);
+
+#endif
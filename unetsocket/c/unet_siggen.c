@@ -0,0 +1,397 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_siggen.h"
+#include "unet_conv.h"
+#include "unet_simd.h"
+#include "pthreadwindows.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define SIGGEN_LANES             8      // phasors advanced together
+#define SIGGEN_SEED              256    // most samples between exact phase updates
+#define SIGGEN_TOL               1e-5   // largest phase error for phase that is not quadratic (cycles)
+#define SIGGEN_PI                3.14159265358979323846
+
+// Each lane holds a phasor z, its rotation s from one group of lanes to the
+// next, and the change r of that rotation, so phase can be quadratic in time.
+typedef void (*rotate_t)(float *re, float *im, int n, float *zr, float *zi, float *sr, float *si, const float *rr, const float *ri);
+
+static pthread_once_t siggen_ready = PTHREAD_ONCE_INIT;
+static rotate_t rotate = NULL;
+
+typedef struct {
+  bool hfm;
+  double f1, f2;                     // start and end frequency (Hz)
+  double dur;                        // duration (s)
+  double fs;
+  double fc;                         // carrier removed from the phase (Hz)
+} _sweep_t;
+
+static void rotate_scalar(float *re, float *im, int n, float *zr, float *zi, float *sr, float *si, const float *rr, const float *ri) {
+  for (int i = 0; i < n; i += SIGGEN_LANES) {
+    for (int l = 0; l < SIGGEN_LANES && i + l < n; l++) {
+      re[i + l] = zr[l];
+      im[i + l] = zi[l];
+      float t = zr[l] * sr[l] - zi[l] * si[l];
+      zi[l] = zr[l] * si[l] + zi[l] * sr[l];
+      zr[l] = t;
+      t = sr[l] * rr[l] - si[l] * ri[l];
+      si[l] = sr[l] * ri[l] + si[l] * rr[l];
+      sr[l] = t;
+    }
+  }
+}
+
+#ifdef UNET_SIMD_X86
+
+UNET_TARGET("sse2")
+static void rotate_sse2(float *re, float *im, int n, float *zr, float *zi, float *sr, float *si, const float *rr, const float *ri) {
+  for (int h = 0; h < SIGGEN_LANES; h += 4) {
+    __m128 vzr = _mm_loadu_ps(zr + h), vzi = _mm_loadu_ps(zi + h);
+    __m128 vsr = _mm_loadu_ps(sr + h), vsi = _mm_loadu_ps(si + h);
+    __m128 vrr = _mm_loadu_ps(rr + h), vri = _mm_loadu_ps(ri + h);
+    int i = h;
+    for (; i + 4 <= n; i += SIGGEN_LANES) {
+      _mm_storeu_ps(re + i, vzr);
+      _mm_storeu_ps(im + i, vzi);
+      __m128 t = _mm_sub_ps(_mm_mul_ps(vzr, vsr), _mm_mul_ps(vzi, vsi));
+      vzi = _mm_add_ps(_mm_mul_ps(vzr, vsi), _mm_mul_ps(vzi, vsr));
+      vzr = t;
+      t = _mm_sub_ps(_mm_mul_ps(vsr, vrr), _mm_mul_ps(vsi, vri));
+      vsi = _mm_add_ps(_mm_mul_ps(vsr, vri), _mm_mul_ps(vsi, vrr));
+      vsr = t;
+    }
+    float a[4], b[4];
+    _mm_storeu_ps(a, vzr);
+    _mm_storeu_ps(b, vzi);
+    for (int l = 0; l < 4 && i + l < n; l++) {
+      re[i + l] = a[l];
+      im[i + l] = b[l];
+    }
+  }
+}
+
+UNET_TARGET("avx2")
+static void rotate_avx2(float *re, float *im, int n, float *zr, float *zi, float *sr, float *si, const float *rr, const float *ri) {
+  __m256 vzr = _mm256_loadu_ps(zr), vzi = _mm256_loadu_ps(zi);
+  __m256 vsr = _mm256_loadu_ps(sr), vsi = _mm256_loadu_ps(si);
+  __m256 vrr = _mm256_loadu_ps(rr), vri = _mm256_loadu_ps(ri);
+  int i = 0;
+  for (; i + SIGGEN_LANES <= n; i += SIGGEN_LANES) {
+    _mm256_storeu_ps(re + i, vzr);
+    _mm256_storeu_ps(im + i, vzi);
+    __m256 t = _mm256_sub_ps(_mm256_mul_ps(vzr, vsr), _mm256_mul_ps(vzi, vsi));
+    vzi = _mm256_add_ps(_mm256_mul_ps(vzr, vsi), _mm256_mul_ps(vzi, vsr));
+    vzr = t;
+    t = _mm256_sub_ps(_mm256_mul_ps(vsr, vrr), _mm256_mul_ps(vsi, vri));
+    vsi = _mm256_add_ps(_mm256_mul_ps(vsr, vri), _mm256_mul_ps(vsi, vrr));
+    vsr = t;
+  }
+  float a[SIGGEN_LANES], b[SIGGEN_LANES];
+  _mm256_storeu_ps(a, vzr);
+  _mm256_storeu_ps(b, vzi);
+  for (int l = 0; i + l < n; l++) {
+    re[i + l] = a[l];
+    im[i + l] = b[l];
+  }
+}
+
+#endif
+
+#ifdef UNET_SIMD_NEON
+
+static void rotate_neon(float *re, float *im, int n, float *zr, float *zi, float *sr, float *si, const float *rr, const float *ri) {
+  for (int h = 0; h < SIGGEN_LANES; h += 4) {
+    float32x4_t vzr = vld1q_f32(zr + h), vzi = vld1q_f32(zi + h);
+    float32x4_t vsr = vld1q_f32(sr + h), vsi = vld1q_f32(si + h);
+    float32x4_t vrr = vld1q_f32(rr + h), vri = vld1q_f32(ri + h);
+    int i = h;
+    for (; i + 4 <= n; i += SIGGEN_LANES) {
+      vst1q_f32(re + i, vzr);
+      vst1q_f32(im + i, vzi);
+      float32x4_t t = vmlsq_f32(vmulq_f32(vzr, vsr), vzi, vsi);
+      vzi = vmlaq_f32(vmulq_f32(vzr, vsi), vzi, vsr);
+      vzr = t;
+      t = vmlsq_f32(vmulq_f32(vsr, vrr), vsi, vri);
+      vsi = vmlaq_f32(vmulq_f32(vsr, vri), vsi, vrr);
+      vsr = t;
+    }
+    float a[4], b[4];
+    vst1q_f32(a, vzr);
+    vst1q_f32(b, vzi);
+    for (int l = 0; l < 4 && i + l < n; l++) {
+      re[i + l] = a[l];
+      im[i + l] = b[l];
+    }
+  }
+}
+
+#endif
+
+static void siggen_init(void) {
+  rotate = rotate_scalar;
+#ifdef UNET_SIMD_X86
+  if (UNET_HAS_SSE2()) rotate = rotate_sse2;
+  if (UNET_HAS_AVX2()) rotate = rotate_avx2;
+#endif
+#ifdef UNET_SIMD_NEON
+  rotate = rotate_neon;
+#endif
+}
+
+// phase (cycles) at sample i
+static double phase(const _sweep_t *s, double i) {
+  double t = i / s->fs;
+  double p;
+  if (s->hfm) {
+    double k = (s->f2 - s->f1) / (s->f2 * s->dur);
+    p = -s->f1 / k * log(1 - k * t);
+  } else {
+    p = s->f1 * t + (s->f2 - s->f1) * t * t / (2 * s->dur);
+  }
+  return p - s->fc * t;
+}
+
+// exp(j 2 pi phase) for n samples from start, seeded from the exact phase
+// of the first three groups of lanes
+static void sweep(const _sweep_t *s, long long start, int n, float *re, float *im) {
+  float zr[SIGGEN_LANES], zi[SIGGEN_LANES], sr[SIGGEN_LANES], si[SIGGEN_LANES], rr[SIGGEN_LANES], ri[SIGGEN_LANES];
+  for (int l = 0; l < SIGGEN_LANES; l++) {
+    double i = (double)(start + l);
+    double p0 = phase(s, i);
+    double p1 = phase(s, i + SIGGEN_LANES);
+    double p2 = phase(s, i + 2 * SIGGEN_LANES);
+    double d1 = 2 * SIGGEN_PI * (p1 - p0);
+    double d2 = 2 * SIGGEN_PI * (p2 - 2 * p1 + p0);
+    p0 = 2 * SIGGEN_PI * (p0 - floor(p0));
+    zr[l] = (float)cos(p0);
+    zi[l] = (float)sin(p0);
+    sr[l] = (float)cos(d1);
+    si[l] = (float)sin(d1);
+    rr[l] = (float)cos(d2);
+    ri[l] = (float)sin(d2);
+  }
+  rotate(re, im, n, zr, zi, sr, si, rr, ri);
+}
+
+// Samples from start for which extrapolating the phase as quadratic stays
+// within SIGGEN_TOL. The error after m groups of lanes is about m^3 / 6 times
+// the third difference of the phase, which grows along an HFM sweep, so it is
+// taken at the end of the span.
+static int span(const _sweep_t *s, int start, int n) {
+  if (!s->hfm) return SIGGEN_SEED;
+  int m = SIGGEN_SEED;
+  while (m > SIGGEN_LANES) {
+    double i = start + (m < n - start ? m : n - start);
+    double d3 = phase(s, i) - 3 * phase(s, i - SIGGEN_LANES) + 3 * phase(s, i - 2 * SIGGEN_LANES) - phase(s, i - 3 * SIGGEN_LANES);
+    double g = (double)m / SIGGEN_LANES;
+    if (g * g * g / 6 * fabs(d3) < SIGGEN_TOL) break;
+    m /= 2;
+  }
+  return m;
+}
+
+static int synth(float *buf, int nsamples, const _sweep_t *s) {
+  float re[SIGGEN_SEED], im[SIGGEN_SEED];
+  pthread_once(&siggen_ready, siggen_init);
+  for (int i = 0, seed; i < nsamples; i += seed) {
+    seed = span(s, i, nsamples);
+    int m = nsamples - i < seed ? nsamples - i : seed;
+    sweep(s, i, m, re, im);
+    if (s->fc > 0) {
+      const float *chans[2] = { re, im };
+      unet_conv_interleave(buf + 2 * (size_t)i, chans, 2, (size_t)m);
+    } else {
+      memcpy(buf + i, im, sizeof(float) * (size_t)m);
+    }
+  }
+  return 0;
+}
+
+static int sweep_init(_sweep_t *s, int nsamples, double f1, double f2, double fs, double fc) {
+  if (nsamples < 0 || fs <= 0 || fc < 0) return -1;
+  s->hfm = false;
+  s->f1 = f1;
+  s->f2 = f2;
+  s->dur = nsamples / fs;
+  s->fs = fs;
+  s->fc = fc;
+  return 0;
+}
+
+int unet_siggen_cw(float *buf, int nsamples, float freq, float fs, float fc) {
+  _sweep_t s;
+  if (buf == NULL || sweep_init(&s, nsamples, freq, freq, fs, fc) < 0) return -1;
+  return synth(buf, nsamples, &s);
+}
+
+int unet_siggen_lfm(float *buf, int nsamples, float f1, float f2, float fs, float fc) {
+  _sweep_t s;
+  if (buf == NULL || sweep_init(&s, nsamples, f1, f2, fs, fc) < 0) return -1;
+  return synth(buf, nsamples, &s);
+}
+
+int unet_siggen_hfm(float *buf, int nsamples, float f1, float f2, float fs, float fc) {
+  _sweep_t s;
+  if (buf == NULL || f1 <= 0 || f2 <= 0 || sweep_init(&s, nsamples, f1, f2, fs, fc) < 0) return -1;
+  // a sweep over a tiny band is a CW tone, and its HFM phase is ill-conditioned
+  s.hfm = fabs(s.f2 - s.f1) > 1e-6 * s.f1;
+  return synth(buf, nsamples, &s);
+}
+
+int unet_siggen_bpsk(float *buf, int nsamples, const float *chips, int nchips, float chiprate, float freq, float fs, float fc) {
+  if (chips == NULL || nchips <= 0 || chiprate <= 0) return -1;
+  if (unet_siggen_cw(buf, nsamples, freq, fs, fc) < 0) return -1;
+  int stride = fc > 0 ? 2 : 1;
+  double spc = (double)fs / chiprate;
+  for (long long c = 0;; c++) {
+    long long a = (long long)ceil((double)c * spc);
+    long long b = (long long)ceil((double)(c + 1) * spc);
+    if (a >= nsamples) break;
+    if (b > nsamples) b = nsamples;
+    float v = chips[c % nchips];
+    for (long long i = a * stride; i < b * stride; i++) buf[i] *= v;
+  }
+  return 0;
+}
+
+// Feedback taps of primitive polynomials for each degree, counted from the
+// output end of the shift register, so bit k + degree is the sum of the bits
+// k + degree - tap.
+static const int mseq_taps[SIGGEN_MAXDEGREE + 1][5] = {
+  { 0 }, { 0 },
+  { 2, 1 }, { 3, 2 }, { 4, 3 }, { 5, 3 }, { 6, 5 }, { 7, 6 }, { 8, 6, 5, 4 },
+  { 9, 5 }, { 10, 7 }, { 11, 9 }, { 12, 6, 4, 1 }, { 13, 4, 3, 1 },
+  { 14, 5, 3, 1 }, { 15, 14 }, { 16, 15, 13, 4 }, { 17, 14 }, { 18, 11 },
+  { 19, 6, 2, 1 }, { 20, 17 }
+};
+
+// Preferred pairs of primitive polynomials for Gold codes
+static const struct {
+  int degree;
+  int a[5];
+  int b[5];
+} gold_pairs[] = {
+  { 5, { 5, 2 }, { 5, 4, 3, 2 } },
+  { 6, { 6, 1 }, { 6, 5, 2, 1 } },
+  { 7, { 7, 3 }, { 7, 3, 2, 1 } },
+  { 9, { 9, 4 }, { 9, 6, 4, 3 } },
+  { 10, { 10, 3 }, { 10, 8, 3, 2 } },
+  { 11, { 11, 2 }, { 11, 8, 5, 2 } }
+};
+
+// run a shift register, starting from all ones, for one period of bits
+static void lfsr(const int *taps, int degree, uint8_t *bits, int n) {
+  uint32_t mask = 0;
+  for (int j = 0; j < 5 && taps[j] > 0; j++) mask |= 1u << (degree - taps[j]);
+  uint32_t state = (1u << degree) - 1;
+  for (int i = 0; i < n; i++) {
+    bits[i] = (uint8_t)(state & 1);
+    uint32_t fb = state & mask;
+    fb ^= fb >> 16;
+    fb ^= fb >> 8;
+    fb ^= fb >> 4;
+    fb ^= fb >> 2;
+    fb ^= fb >> 1;
+    state = (state >> 1) | ((fb & 1) << (degree - 1));
+  }
+}
+
+int unet_siggen_mseq(float *chips, int degree) {
+  if (chips == NULL || degree < 2 || degree > SIGGEN_MAXDEGREE) return -1;
+  int n = (1 << degree) - 1;
+  uint8_t *bits = malloc((size_t)n);
+  if (bits == NULL) return -1;
+  lfsr(mseq_taps[degree], degree, bits, n);
+  for (int i = 0; i < n; i++) chips[i] = bits[i] ? -1.0f : 1.0f;
+  free(bits);
+  return n;
+}
+
+int unet_siggen_gold(float *chips, int degree, int index) {
+  if (chips == NULL || degree < 2 || degree > SIGGEN_MAXDEGREE || index < 0 || index > (1 << degree)) return -1;
+  for (size_t k = 0; k < sizeof(gold_pairs) / sizeof(gold_pairs[0]); k++) {
+    if (gold_pairs[k].degree != degree) continue;
+    int n = (1 << degree) - 1;
+    uint8_t *a = malloc((size_t)n);
+    uint8_t *b = malloc((size_t)n);
+    if (a == NULL || b == NULL) {
+      free(a);
+      free(b);
+      return -1;
+    }
+    lfsr(gold_pairs[k].a, degree, a, n);
+    lfsr(gold_pairs[k].b, degree, b, n);
+    for (int i = 0; i < n; i++) {
+      int bit;
+      if (index == 0) bit = a[i];
+      else if (index == 1) bit = b[i];
+      else bit = a[i] ^ b[(i + index - 2) % n];
+      chips[i] = bit ? -1.0f : 1.0f;
+    }
+    free(a);
+    free(b);
+    return n;
+  }
+  return -1;
+}
+
+// multiply samples from start by window values w
+static void apply(float *buf, int start, const float *w, int n, int stride) {
+  float *p = buf + (size_t)start * (size_t)stride;
+  if (stride == 1) {
+    for (int i = 0; i < n; i++) p[i] *= w[i];
+  } else {
+    for (int i = 0; i < n; i++) {
+      p[2 * i] *= w[i];
+      p[2 * i + 1] *= w[i];
+    }
+  }
+}
+
+int unet_siggen_window(float *buf, int nsamples, float fc, int window, float taper) {
+  if (buf == NULL || nsamples < 0 || fc < 0) return -1;
+  if (window < SIGGEN_RECT || window > SIGGEN_TUKEY) return -1;
+  if (window == SIGGEN_TUKEY && (taper < 0 || taper > 1)) return -1;
+  if (window == SIGGEN_RECT || nsamples < 2) return 0;
+  int stride = fc > 0 ? 2 : 1;
+  float c[SIGGEN_SEED], s[SIGGEN_SEED];
+  _sweep_t sw;
+  pthread_once(&siggen_ready, siggen_init);
+  if (window == SIGGEN_TUKEY) {
+    // raised cosine over the first m samples, mirrored at the end
+    int m = (int)(taper * (float)(nsamples - 1) / 2);
+    if (m < 1) return 0;
+    sweep_init(&sw, m, 0.5 / m, 0.5 / m, 1, 0);
+    for (int i = 0; i < m; i += SIGGEN_SEED) {
+      int k = m - i < SIGGEN_SEED ? m - i : SIGGEN_SEED;
+      sweep(&sw, i, k, c, s);
+      for (int j = 0; j < k; j++) c[j] = 0.5f - 0.5f * c[j];
+      apply(buf, i, c, k, stride);
+      for (int j = 0; j < k; j++) {
+        float *p = buf + (size_t)(nsamples - 1 - i - j) * (size_t)stride;
+        p[0] *= c[j];
+        if (stride == 2) p[1] *= c[j];
+      }
+    }
+    return 0;
+  }
+  double a0 = 0.5, a1 = 0.5, a2 = 0;
+  if (window == SIGGEN_HAMMING) {
+    a0 = 0.54;
+    a1 = 0.46;
+  } else if (window == SIGGEN_BLACKMAN) {
+    a0 = 0.42;
+    a2 = 0.08;
+  }
+  sweep_init(&sw, nsamples, 1.0 / (nsamples - 1), 1.0 / (nsamples - 1), 1, 0);
+  for (int i = 0; i < nsamples; i += SIGGEN_SEED) {
+    int k = nsamples - i < SIGGEN_SEED ? nsamples - i : SIGGEN_SEED;
+    sweep(&sw, i, k, c, s);
+    for (int j = 0; j < k; j++) c[j] = (float)(a0 - a1 * c[j] + a2 * (2 * c[j] * c[j] - 1));
+    apply(buf, i, c, k, stride);
+  }
+  return 0;
+}
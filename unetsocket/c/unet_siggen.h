@@ -0,0 +1,118 @@
+#ifndef _UNETSIGGEN_H_
+#define _UNETSIGGEN_H_
+
+// Waveform synthesis for transmit signals. The generators write directly into
+// the buffers passed to unetsocket_ext_tx_signal() and unetsocket_ext_npulses().
+// With fc set to 0 they write a real passband signal, and otherwise the complex
+// baseband signal relative to carrier fc, as alternating real and imaginary
+// values with nsamples counting complex samples. All waveforms have unit
+// amplitude. Phase is accumulated with vectors of rotating phasors, reseeded
+// from the exact phase at regular intervals.
+
+/// Pulse windows for unet_siggen_window()
+
+#define SIGGEN_RECT              0
+#define SIGGEN_HANN              1
+#define SIGGEN_HAMMING           2
+#define SIGGEN_BLACKMAN          3
+#define SIGGEN_TUKEY             4
+
+/// Largest degree of the shift register for unet_siggen_mseq()
+
+#define SIGGEN_MAXDEGREE         20
+
+/// Generate a continuous wave (CW) tone. The passband signal is a sine wave,
+/// and the baseband signal its complex envelope.
+///
+/// @param buf              Buffer for the signal (2 * nsamples values for
+///                         baseband)
+/// @param nsamples         Number of samples
+/// @param freq             Frequency of the tone (Hz)
+/// @param fs               Sampling rate (Hz)
+/// @param fc               Carrier frequency for baseband, 0 for passband (Hz)
+/// @return                 0 on success, -1 otherwise
+
+int unet_siggen_cw(float *buf, int nsamples, float freq, float fs, float fc);
+
+/// Generate a linear frequency modulated (LFM) chirp, sweeping from f1 to f2
+/// over the length of the signal.
+///
+/// @param buf              Buffer for the signal (2 * nsamples values for
+///                         baseband)
+/// @param nsamples         Number of samples
+/// @param f1               Start frequency (Hz)
+/// @param f2               End frequency (Hz)
+/// @param fs               Sampling rate (Hz)
+/// @param fc               Carrier frequency for baseband, 0 for passband (Hz)
+/// @return                 0 on success, -1 otherwise
+
+int unet_siggen_lfm(float *buf, int nsamples, float f1, float f2, float fs, float fc);
+
+/// Generate a hyperbolic frequency modulated (HFM) chirp, sweeping from f1 to
+/// f2 over the length of the signal with a period that changes linearly in
+/// time. HFM chirps are Doppler tolerant.
+///
+/// @param buf              Buffer for the signal (2 * nsamples values for
+///                         baseband)
+/// @param nsamples         Number of samples
+/// @param f1               Start frequency (Hz), greater than 0
+/// @param f2               End frequency (Hz), greater than 0
+/// @param fs               Sampling rate (Hz)
+/// @param fc               Carrier frequency for baseband, 0 for passband (Hz)
+/// @return                 0 on success, -1 otherwise
+
+int unet_siggen_hfm(float *buf, int nsamples, float f1, float f2, float fs, float fc);
+
+/// Generate a binary phase shift keyed (BPSK) signal, with a tone at freq
+/// multiplied by rectangular chips. The chips repeat if the signal is longer
+/// than the code.
+///
+/// @param buf              Buffer for the signal (2 * nsamples values for
+///                         baseband)
+/// @param nsamples         Number of samples
+/// @param chips            Chip values, usually +1 or -1
+/// @param nchips           Number of chips
+/// @param chiprate         Chip rate (chips/s)
+/// @param freq             Frequency of the tone (Hz)
+/// @param fs               Sampling rate (Hz)
+/// @param fc               Carrier frequency for baseband, 0 for passband (Hz)
+/// @return                 0 on success, -1 otherwise
+
+int unet_siggen_bpsk(float *buf, int nsamples, const float *chips, int nchips, float chiprate, float freq, float fs, float fc);
+
+/// Generate a maximal length sequence (m-sequence) from a linear feedback
+/// shift register with a primitive feedback polynomial. Chips are +1 for 0
+/// bits and -1 for 1 bits.
+///
+/// @param chips            Buffer for 2^degree - 1 chips
+/// @param degree           Degree of the shift register, 2 to SIGGEN_MAXDEGREE
+/// @return                 Number of chips, -1 on error
+
+int unet_siggen_mseq(float *chips, int degree);
+
+/// Generate a Gold code, from a preferred pair of m-sequences. Codes of the
+/// same degree have low cross-correlation, so several transmitters can probe
+/// at the same time. Index 0 and 1 give the two m-sequences, and indices 2 to
+/// 2^degree their sums at each relative shift.
+///
+/// @param chips            Buffer for 2^degree - 1 chips
+/// @param degree           Degree of the shift registers (5, 6, 7, 9, 10 or 11)
+/// @param index            Index of the code, 0 to 2^degree
+/// @return                 Number of chips, -1 on error
+
+int unet_siggen_gold(float *chips, int degree, int index);
+
+/// Apply a window to a signal in place, to shape a pulse.
+///
+/// @param buf              Signal (2 * nsamples values for baseband)
+/// @param nsamples         Number of samples
+/// @param fc               Carrier frequency for baseband, 0 for passband (Hz)
+/// @param window           Window (SIGGEN_RECT, SIGGEN_HANN, SIGGEN_HAMMING,
+///                         SIGGEN_BLACKMAN or SIGGEN_TUKEY)
+/// @param taper            Fraction of the signal in the cosine tapers at the
+///                         two ends, for SIGGEN_TUKEY (0 to 1)
+/// @return                 0 on success, -1 otherwise
+
+int unet_siggen_window(float *buf, int nsamples, float fc, int window, float taper);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _UNETSIMD_H_
+#define _UNETSIMD_H_
+
+// Vector instruction set support for the coding and signal processing kernels.
+// Kernels for each instruction set are compiled with UNET_TARGET() and
+// selected at run time using the UNET_HAS_*() checks, so the library itself
+// can be built for the baseline architecture.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#define UNET_SIMD_X86
+#include <immintrin.h>
+#define UNET_TARGET(isa)         __attribute__((target(isa)))
+#define UNET_HAS_SSE2()          __builtin_cpu_supports("sse2")
+#define UNET_HAS_SSSE3()         __builtin_cpu_supports("ssse3")
+#define UNET_HAS_AVX2()          __builtin_cpu_supports("avx2")
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+#define UNET_SIMD_NEON
+#include <arm_neon.h>
+
+#endif
+
+#endif
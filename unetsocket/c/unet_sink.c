@@ -0,0 +1,480 @@
+#define _DEFAULT_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include "unet_sink.h"
+#include "unet_atomic.h"
+#include "pthreadwindows.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#else
+#include <windows.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define UNET_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#define SINK_ZEROS               1024   // frames of silence written at a time for gaps
+#define SINK_ASYNC_BATCH         2      // buffers queued before an io_uring submission
+
+#ifdef UNET_HAVE_IO_URING
+
+typedef struct {
+  int fd;
+  unsigned *sqhead;
+  unsigned *sqtail;
+  unsigned *sqmask;
+  unsigned *sqarray;
+  unsigned *cqhead;
+  unsigned *cqtail;
+  unsigned *cqmask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sqring;
+  void *cqring;
+  size_t sqlen;
+  size_t cqlen;
+  size_t sqeslen;
+  unsigned queued;                   // entries not yet submitted
+} _uring_t;
+
+#endif
+
+typedef struct _unet_sink_s _unet_sink_t;
+
+struct _unet_sink_s {
+  int (*write)(_unet_sink_t *sink, const float *buf, size_t n);
+  int (*close)(_unet_sink_t *sink);
+  int format;
+  int channels;
+  float fs;
+  unsigned long long capacity;       // frames
+  unsigned long long count;          // frames written
+  bool failed;
+  uint8_t *map;
+  size_t maplen;
+#ifndef _WIN32
+  int fd;
+#else
+  HANDLE file;
+  HANDLE mapping;
+#endif
+  // asynchronous sink: buffers are filled in turn and written in the background
+  uint8_t *bufs;
+  size_t buflen[SINK_ASYNC_NBUF];
+  int cur;                           // buffer being filled
+  size_t fill;                       // bytes in the current buffer
+  unsigned long long offset;         // file offset of the current buffer
+  FILE *fp;                          // writer thread output
+  pthread_t tid;
+  volatile size_t head;              // buffers passed to the writer thread
+  volatile size_t tail;              // buffers written by the writer thread
+  volatile size_t closing;
+  volatile size_t werr;
+#ifdef UNET_HAVE_IO_URING
+  _uring_t *uring;                   // NULL when using the writer thread
+  bool busy[SINK_ASYNC_NBUF];
+  int inflight;
+#endif
+};
+
+static int sample_bytes(int format) {
+  return unet_wav_sample_bytes(format);
+}
+
+static size_t header_bytes(int format) {
+  return format == SINK_RAW ? 0 : WAV_HEADER;
+}
+
+// convert n samples into the file format at dst; raw files hold floats
+static void convert(uint8_t *dst, const float *src, size_t n, int format) {
+  unet_wav_encode(dst, src, n, format == SINK_RAW ? WAV_FLOAT : format);
+}
+
+static int mmap_write(_unet_sink_t *sink, const float *buf, size_t n) {
+  size_t offset = header_bytes(sink->format) + (size_t)sink->count * (size_t)sink->channels * (size_t)sample_bytes(sink->format);
+  convert(sink->map + offset, buf, n, sink->format);
+  return 0;
+}
+
+#ifndef _WIN32
+
+static int mmap_close(_unet_sink_t *sink) {
+  int rv = 0;
+  size_t len = header_bytes(sink->format) + (size_t)sink->count * (size_t)sink->channels * (size_t)sample_bytes(sink->format);
+  if (sink->format != SINK_RAW) unet_wav_header(sink->map, sink->format, sink->fs, sink->channels, sink->count);
+  if (munmap(sink->map, sink->maplen) < 0) rv = -1;
+  if (len < sink->maplen && ftruncate(sink->fd, (off_t)len) < 0) rv = -1;
+  if (close(sink->fd) < 0) rv = -1;
+  return rv;
+}
+
+static int mmap_open(_unet_sink_t *sink, const char *filename) {
+  sink->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (sink->fd < 0) return -1;
+  bool ok = ftruncate(sink->fd, (off_t)sink->maplen) == 0;
+#ifdef __linux__
+  // reserve the blocks up front, so a full disk fails here rather than with
+  // a SIGBUS in the middle of a recording
+  if (ok) ok = posix_fallocate(sink->fd, 0, (off_t)sink->maplen) == 0;
+#endif
+  if (ok) {
+    sink->map = mmap(NULL, sink->maplen, PROT_READ | PROT_WRITE, MAP_SHARED, sink->fd, 0);
+    ok = sink->map != MAP_FAILED;
+  }
+  if (!ok) {
+    close(sink->fd);
+    unlink(filename);
+    return -1;
+  }
+  return 0;
+}
+
+#else
+
+static int mmap_close(_unet_sink_t *sink) {
+  int rv = 0;
+  LARGE_INTEGER len;
+  len.QuadPart = (LONGLONG)(header_bytes(sink->format) + (size_t)sink->count * (size_t)sink->channels * (size_t)sample_bytes(sink->format));
+  if (sink->format != SINK_RAW) unet_wav_header(sink->map, sink->format, sink->fs, sink->channels, sink->count);
+  if (!UnmapViewOfFile(sink->map)) rv = -1;
+  CloseHandle(sink->mapping);
+  if (!SetFilePointerEx(sink->file, len, NULL, FILE_BEGIN) || !SetEndOfFile(sink->file)) rv = -1;
+  CloseHandle(sink->file);
+  return rv;
+}
+
+static int mmap_open(_unet_sink_t *sink, const char *filename) {
+  sink->file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (sink->file == INVALID_HANDLE_VALUE) return -1;
+  unsigned long long len = sink->maplen;
+  sink->mapping = CreateFileMappingA(sink->file, NULL, PAGE_READWRITE, (DWORD)(len >> 32), (DWORD)len, NULL);
+  if (sink->mapping != NULL) sink->map = MapViewOfFile(sink->mapping, FILE_MAP_WRITE, 0, 0, sink->maplen);
+  if (sink->map == NULL) {
+    if (sink->mapping != NULL) CloseHandle(sink->mapping);
+    CloseHandle(sink->file);
+    DeleteFileA(filename);
+    return -1;
+  }
+  return 0;
+}
+
+#endif
+
+unet_sink_t unet_sink_mmap(const char *filename, int format, float fs, int channels, unsigned long long nframes) {
+  if (filename == NULL || format < SINK_RAW || format > SINK_WAV32 || fs <= 0 || channels <= 0 || nframes == 0) return NULL;
+  unsigned long long len = header_bytes(format) + nframes * (unsigned)channels * (unsigned)sample_bytes(format);
+  if (len > (size_t)-1) return NULL;
+  _unet_sink_t *sink = calloc(1, sizeof(_unet_sink_t));
+  if (sink == NULL) return NULL;
+  sink->write = mmap_write;
+  sink->close = mmap_close;
+  sink->format = format;
+  sink->channels = channels;
+  sink->fs = fs;
+  sink->capacity = nframes;
+  sink->maplen = (size_t)len;
+  if (mmap_open(sink, filename) < 0) {
+    free(sink);
+    return NULL;
+  }
+  if (format != SINK_RAW) unet_wav_header(sink->map, format, fs, channels, nframes);
+  return sink;
+}
+
+#ifdef UNET_HAVE_IO_URING
+
+static void uring_exit(_uring_t *u) {
+  if (u->sqes != NULL) munmap(u->sqes, u->sqeslen);
+  if (u->cqring != NULL && u->cqring != u->sqring) munmap(u->cqring, u->cqlen);
+  if (u->sqring != NULL) munmap(u->sqring, u->sqlen);
+  close(u->fd);
+}
+
+static void *uring_map(_uring_t *u, size_t len, unsigned long long offset) {
+  void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, (off_t)offset);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+// set up an io_uring with the sink buffers registered as fixed buffers
+static int uring_init(_uring_t *u, uint8_t *bufs) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(u, 0, sizeof(_uring_t));
+  u->fd = (int)syscall(__NR_io_uring_setup, 2 * SINK_ASYNC_NBUF, &p);
+  if (u->fd < 0) return -1;
+  u->sqlen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  u->cqlen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  u->sqeslen = p.sq_entries * sizeof(struct io_uring_sqe);
+  bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single && u->cqlen > u->sqlen) u->sqlen = u->cqlen;
+  u->sqring = uring_map(u, u->sqlen, IORING_OFF_SQ_RING);
+  if (u->sqring != NULL) u->cqring = single ? u->sqring : uring_map(u, u->cqlen, IORING_OFF_CQ_RING);
+  if (u->cqring != NULL) u->sqes = uring_map(u, u->sqeslen, IORING_OFF_SQES);
+  if (u->sqes == NULL) {
+    uring_exit(u);
+    return -1;
+  }
+  uint8_t *sq = u->sqring;
+  uint8_t *cq = u->cqring;
+  u->sqhead = (unsigned *)(void *)(sq + p.sq_off.head);
+  u->sqtail = (unsigned *)(void *)(sq + p.sq_off.tail);
+  u->sqmask = (unsigned *)(void *)(sq + p.sq_off.ring_mask);
+  u->sqarray = (unsigned *)(void *)(sq + p.sq_off.array);
+  u->cqhead = (unsigned *)(void *)(cq + p.cq_off.head);
+  u->cqtail = (unsigned *)(void *)(cq + p.cq_off.tail);
+  u->cqmask = (unsigned *)(void *)(cq + p.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe *)(void *)(cq + p.cq_off.cqes);
+  struct iovec iov[SINK_ASYNC_NBUF];
+  for (int i = 0; i < SINK_ASYNC_NBUF; i++) {
+    iov[i].iov_base = bufs + (size_t)i * SINK_ASYNC_BUFLEN;
+    iov[i].iov_len = SINK_ASYNC_BUFLEN;
+  }
+  // registration fails if the buffers exceed RLIMIT_MEMLOCK
+  if (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS, iov, SINK_ASYNC_NBUF) < 0) {
+    uring_exit(u);
+    return -1;
+  }
+  return 0;
+}
+
+// submit queued entries, and optionally wait for a completion
+static int uring_enter(_uring_t *u, unsigned wait) {
+  int rv;
+  do {
+    rv = (int)syscall(__NR_io_uring_enter, u->fd, u->queued, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+  } while (rv < 0 && errno == EINTR);
+  if (rv < 0) return -1;
+  u->queued -= (unsigned)rv;
+  return 0;
+}
+
+static void uring_queue(_unet_sink_t *sink, int i) {
+  _uring_t *u = sink->uring;
+  unsigned tail = *u->sqtail;
+  unsigned index = tail & *u->sqmask;
+  struct io_uring_sqe *sqe = u->sqes + index;
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->opcode = IORING_OP_WRITE_FIXED;
+  sqe->fd = sink->fd;
+  sqe->addr = (unsigned long long)(uintptr_t)(sink->bufs + (size_t)i * SINK_ASYNC_BUFLEN);
+  sqe->len = (unsigned)sink->buflen[i];
+  sqe->off = sink->offset;
+  sqe->buf_index = (uint16_t)i;
+  sqe->user_data = (unsigned long long)i;
+  u->sqarray[index] = index;
+  __atomic_store_n(u->sqtail, tail + 1, __ATOMIC_RELEASE);
+  u->queued++;
+  sink->busy[i] = true;
+  sink->inflight++;
+}
+
+static void uring_reap(_unet_sink_t *sink) {
+  _uring_t *u = sink->uring;
+  unsigned head = *u->cqhead;
+  while (head != __atomic_load_n(u->cqtail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe *cqe = u->cqes + (head & *u->cqmask);
+    int i = (int)cqe->user_data;
+    if (cqe->res < 0 || (size_t)cqe->res != sink->buflen[i]) sink->failed = true;
+    sink->busy[i] = false;
+    sink->inflight--;
+    head++;
+  }
+  __atomic_store_n(u->cqhead, head, __ATOMIC_RELEASE);
+}
+
+#endif
+
+static void *async_writer(void *arg) {
+  _unet_sink_t *sink = arg;
+  while (true) {
+    size_t tail = sink->tail;
+    if (unet_load_acquire(&sink->head) == tail) {
+      // the last buffer is passed on before closing is set
+      if (unet_load_acquire(&sink->closing) && unet_load_acquire(&sink->head) == tail) break;
+      Sleep(1);
+      continue;
+    }
+    int i = (int)(tail % SINK_ASYNC_NBUF);
+    if (fwrite(sink->bufs + (size_t)i * SINK_ASYNC_BUFLEN, 1, sink->buflen[i], sink->fp) != sink->buflen[i]) unet_store_release(&sink->werr, 1);
+    unet_store_release(&sink->tail, tail + 1);
+  }
+  return NULL;
+}
+
+// wait until the current buffer has been written out and can be refilled
+static int async_wait(_unet_sink_t *sink) {
+#ifdef UNET_HAVE_IO_URING
+  if (sink->uring != NULL) {
+    while (sink->busy[sink->cur]) {
+      if (uring_enter(sink->uring, 1) < 0) return -1;
+      uring_reap(sink);
+    }
+    return sink->failed ? -1 : 0;
+  }
+#endif
+  while (sink->head - unet_load_acquire(&sink->tail) >= SINK_ASYNC_NBUF) Sleep(1);
+  return unet_load_acquire(&sink->werr) ? -1 : 0;
+}
+
+// pass the current buffer on to be written
+static int async_submit(_unet_sink_t *sink) {
+  if (sink->fill == 0) return 0;
+  int i = sink->cur;
+  sink->buflen[i] = sink->fill;
+#ifdef UNET_HAVE_IO_URING
+  if (sink->uring != NULL) {
+    uring_queue(sink, i);
+    if (sink->uring->queued >= SINK_ASYNC_BATCH && uring_enter(sink->uring, 0) < 0) return -1;
+    uring_reap(sink);
+  } else
+#endif
+  unet_store_release(&sink->head, sink->head + 1);
+  sink->offset += sink->fill;
+  sink->fill = 0;
+  sink->cur = (i + 1) % SINK_ASYNC_NBUF;
+  return 0;
+}
+
+static int async_write(_unet_sink_t *sink, const float *buf, size_t n) {
+  size_t bytes = (size_t)sample_bytes(sink->format);
+  size_t full = SINK_ASYNC_BUFLEN / bytes * bytes;   // whole samples per buffer
+  while (n > 0) {
+    if (sink->fill == 0 && async_wait(sink) < 0) return -1;
+    size_t k = (full - sink->fill) / bytes;
+    if (k > n) k = n;
+    convert(sink->bufs + (size_t)sink->cur * SINK_ASYNC_BUFLEN + sink->fill, buf, k, sink->format);
+    sink->fill += k * bytes;
+    buf += k;
+    n -= k;
+    if (sink->fill == full && async_submit(sink) < 0) return -1;
+  }
+  return 0;
+}
+
+static int async_close(_unet_sink_t *sink) {
+  int rv = async_submit(sink);
+  uint8_t hdr[WAV_HEADER];
+  unet_wav_header(hdr, sink->format, sink->fs, sink->channels, sink->count);
+#ifdef UNET_HAVE_IO_URING
+  if (sink->uring != NULL) {
+    while (sink->inflight > 0) {
+      if (uring_enter(sink->uring, 1) < 0) {
+        rv = -1;
+        break;
+      }
+      uring_reap(sink);
+    }
+    uring_exit(sink->uring);
+    free(sink->uring);
+    if (sink->format != SINK_RAW && pwrite(sink->fd, hdr, WAV_HEADER, 0) != WAV_HEADER) rv = -1;
+    if (close(sink->fd) < 0) rv = -1;
+    free(sink->bufs);
+    return rv;
+  }
+#endif
+  unet_store_release(&sink->closing, 1);
+  pthread_join(sink->tid, NULL);
+  if (unet_load_acquire(&sink->werr)) rv = -1;
+  if (sink->format != SINK_RAW && (fseek(sink->fp, 0, SEEK_SET) != 0 || fwrite(hdr, 1, WAV_HEADER, sink->fp) != WAV_HEADER)) rv = -1;
+  if (fclose(sink->fp) != 0) rv = -1;
+  free(sink->bufs);
+  return rv;
+}
+
+unet_sink_t unet_sink_async(const char *filename, int format, float fs, int channels, unsigned long long nframes) {
+  if (filename == NULL || format < SINK_RAW || format > SINK_WAV32 || fs <= 0 || channels <= 0) return NULL;
+  _unet_sink_t *sink = calloc(1, sizeof(_unet_sink_t));
+  if (sink == NULL) return NULL;
+  sink->write = async_write;
+  sink->close = async_close;
+  sink->format = format;
+  sink->channels = channels;
+  sink->fs = fs;
+  sink->capacity = nframes;
+  sink->offset = header_bytes(format);
+  sink->bufs = malloc((size_t)SINK_ASYNC_NBUF * SINK_ASYNC_BUFLEN);
+  if (sink->bufs == NULL) {
+    free(sink);
+    return NULL;
+  }
+#ifdef UNET_HAVE_IO_URING
+  sink->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (sink->fd < 0) {
+    free(sink->bufs);
+    free(sink);
+    return NULL;
+  }
+  sink->uring = malloc(sizeof(_uring_t));
+  if (sink->uring != NULL && uring_init(sink->uring, sink->bufs) == 0) return sink;
+  free(sink->uring);
+  sink->uring = NULL;
+  close(sink->fd);
+#endif
+  // fall back to a writer thread, leaving room for the header
+  sink->fp = fopen(filename, "wb");
+  uint8_t hdr[WAV_HEADER];
+  memset(hdr, 0, sizeof(hdr));
+  if (sink->fp != NULL && fwrite(hdr, 1, header_bytes(format), sink->fp) == header_bytes(format) &&
+      pthread_create(&sink->tid, NULL, async_writer, sink) == 0) return sink;
+  if (sink->fp != NULL) fclose(sink->fp);
+  free(sink->bufs);
+  free(sink);
+  return NULL;
+}
+
+int unet_sink_write(unet_sink_t sink, const float *buf, int nframes) {
+  if (sink == NULL || buf == NULL || nframes < 0) return -1;
+  _unet_sink_t *usink = sink;
+  if (usink->failed) return -1;
+  unsigned long long n = (unsigned long long)nframes;
+  if (usink->capacity > 0 && n > usink->capacity - usink->count) n = usink->capacity - usink->count;
+  if (n == 0) return 0;
+  if (usink->write(usink, buf, (size_t)n * (size_t)usink->channels) < 0) {
+    usink->failed = true;
+    return -1;
+  }
+  usink->count += n;
+  return (int)n;
+}
+
+int unet_sink_block(void *ctx, const unet_block_t *blk) {
+  _unet_sink_t *usink = ctx;
+  if (usink == NULL || blk == NULL) return 1;
+  int channels = usink->channels;
+  if (blk->gap > 0) {
+    float zeros[SINK_ZEROS * 2];
+    memset(zeros, 0, sizeof(zeros));
+    int step = (int)(sizeof(zeros) / sizeof(float)) / channels;
+    long long gap = blk->gap;
+    while (gap > 0) {
+      int n = gap > step ? step : (int)gap;
+      if (unet_sink_write(usink, zeros, n) <= 0) return 1;
+      gap -= n;
+    }
+  }
+  int nframes = blk->nsamples;
+  if (unet_sink_write(usink, blk->signal, nframes) < nframes) return 1;
+  return usink->capacity > 0 && usink->count >= usink->capacity ? 1 : 0;
+}
+
+int unet_sink_close(unet_sink_t sink) {
+  if (sink == NULL) return -1;
+  _unet_sink_t *usink = sink;
+  int rv = usink->close(usink);
+  if (usink->failed) rv = -1;
+  free(usink);
+  return rv;
+}
@@ -0,0 +1,86 @@
+#ifndef _UNETSINK_H_
+#define _UNETSINK_H_
+
+#include "unet_stream.h"
+#include "unet_wav.h"
+
+typedef void *unet_sink_t;         ///< recording sink
+
+/// Sink file formats
+
+#define SINK_RAW                 0      ///< raw 32-bit floats
+#define SINK_WAV                 WAV_FLOAT  ///< 32-bit float WAV
+#define SINK_WAV16               WAV_PCM16  ///< 16-bit PCM WAV
+#define SINK_WAV24               WAV_PCM24  ///< 24-bit PCM WAV
+#define SINK_WAV32               WAV_PCM32  ///< 32-bit PCM WAV
+
+/// Create a sink that records into a memory-mapped file. The file is
+/// preallocated to hold nframes frames and blocks are written in place as they
+/// arrive, so the length of a recording is limited by disk space rather than
+/// memory. WAV files larger than 4 GB are written as RF64.
+///
+/// @param filename         File to create (overwritten if it exists)
+/// @param format           SINK_RAW, SINK_WAV or SINK_WAV16/24/32
+/// @param fs               Sampling rate (Hz)
+/// @param channels         Number of channels, 1 for passband or 2 for
+///                         baseband (alternating real and imaginary values)
+/// @param nframes          Number of frames to preallocate
+/// @return                 Sink, or NULL on error
+
+unet_sink_t unet_sink_mmap(const char *filename, int format, float fs, int channels, unsigned long long nframes);
+
+/// Size of each write buffer of an asynchronous sink (bytes)
+
+#define SINK_ASYNC_BUFLEN        (512 * 1024)
+
+/// Number of write buffers of an asynchronous sink
+
+#define SINK_ASYNC_NBUF          8
+
+/// Create a sink that records to a file with asynchronous writes, so that
+/// disk latency does not hold up the thread receiving the signal. Samples are
+/// converted into one of SINK_ASYNC_NBUF buffers, and full buffers are written
+/// in the background while the next one is filled. A write only waits for the
+/// disk when all buffers are still being written.
+///
+/// On Linux, buffers are registered with an io_uring and writes are submitted
+/// in batches. Where io_uring is not available, a writer thread is used.
+///
+/// @param filename         File to create (overwritten if it exists)
+/// @param format           SINK_RAW, SINK_WAV or SINK_WAV16/24/32
+/// @param fs               Sampling rate (Hz)
+/// @param channels         Number of channels, 1 for passband or 2 for
+///                         baseband (alternating real and imaginary values)
+/// @param nframes          Largest number of frames to record, 0 for no limit
+/// @return                 Sink, or NULL on error
+
+unet_sink_t unet_sink_async(const char *filename, int format, float fs, int channels, unsigned long long nframes);
+
+/// Write samples to a sink. Samples beyond the sink's capacity are discarded.
+///
+/// @param sink             Recording sink
+/// @param buf              Samples, interleaved if there is more than one channel
+/// @param nframes          Number of frames
+/// @return                 Number of frames written, -1 on error
+
+int unet_sink_write(unet_sink_t sink, const float *buf, int nframes);
+
+/// Block sink that writes signal blocks to a recording sink, for use with
+/// unetsocket_ext_pbstream(). Samples missed before a block are written as
+/// zeros, so that the recording keeps its timeline.
+///
+/// @param ctx              Recording sink
+/// @param blk              Signal block
+/// @return                 0 to continue, 1 once the sink is full or has failed
+
+int unet_sink_block(void *ctx, const unet_block_t *blk);
+
+/// Finish a recording. A file that was not filled is truncated to the frames
+/// written and its header updated.
+///
+/// @param sink             Recording sink
+/// @return                 0 on success, -1 if any write failed
+
+int unet_sink_close(unet_sink_t sink);
+
+#endif
@@ -0,0 +1,316 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet.h"
+#include "unet_ext.h"
+#include "unet_sound.h"
+#include "unet_fft.h"
+#include "unet_resample.h"
+#include "unet_stream.h"
+#include "unet_dsp.h"
+#include "unet_atomic.h"
+#include "pthreadwindows.h"
+#include <string.h>
+#include <math.h>
+
+#define SOUND_PI                 3.14159265358979323846
+
+typedef struct {
+  float fs;
+  float *probe;
+  int plen;
+  int ntaps;
+  double fc;                         // center frequency of the probe
+  int n;                             // FFT size for the last recording length
+  unet_fft_t fft;
+  float *qr;                         // deconvolution filter, analytic
+  float *qi;
+  float *hr;                         // deconvolved recording
+  float *hi;
+  float *mag;                        // power of the deconvolved recording
+  float *tmp;
+  float *ir;
+  float *pdp;
+} _unet_sound_t;
+
+typedef struct {
+  unetsocket_t sock;
+  float *buf;
+  int nsamples;
+  int count;
+  volatile size_t started;           // set once the first block is recorded
+  volatile size_t done;
+  int rv;
+} _sound_rec_t;
+
+unet_sound_t unet_sound_create(float fs, const float *probe, int nsamples, int ntaps) {
+  if (fs <= 0 || probe == NULL || nsamples < 1 || ntaps <= SOUND_PRE) return NULL;
+  _unet_sound_t *snd = calloc(1, sizeof(_unet_sound_t));
+  if (snd == NULL) return NULL;
+  snd->fs = fs;
+  snd->plen = nsamples;
+  snd->ntaps = ntaps;
+  snd->probe = malloc(sizeof(float) * (size_t)nsamples);
+  snd->ir = malloc(sizeof(float) * 2 * (size_t)ntaps);
+  snd->pdp = malloc(sizeof(float) * (size_t)ntaps);
+  if (snd->probe == NULL || snd->ir == NULL || snd->pdp == NULL) {
+    unet_sound_destroy(snd);
+    return NULL;
+  }
+  memcpy(snd->probe, probe, sizeof(float) * (size_t)nsamples);
+  return snd;
+}
+
+static void release(_unet_sound_t *snd) {
+  unet_fft_destroy(snd->fft);
+  free(snd->qr);
+  free(snd->qi);
+  free(snd->hr);
+  free(snd->hi);
+  free(snd->mag);
+  free(snd->tmp);
+  snd->fft = NULL;
+  snd->qr = snd->qi = snd->hr = snd->hi = snd->mag = snd->tmp = NULL;
+  snd->n = 0;
+}
+
+void unet_sound_destroy(unet_sound_t snd) {
+  if (snd == NULL) return;
+  _unet_sound_t *usnd = snd;
+  release(usnd);
+  free(usnd->probe);
+  free(usnd->ir);
+  free(usnd->pdp);
+  free(usnd);
+}
+
+// Set up the FFT and the deconvolution filter Q = P / (|P|^2 + e) for
+// recordings that fit in n samples. Q is zero at negative frequencies and
+// doubled at positive ones, so the deconvolved recording is analytic.
+static int setup(_unet_sound_t *snd, int n) {
+  if (snd->n == n) return 0;
+  release(snd);
+  snd->fft = unet_fft_create(n);
+  float **bufs[] = { &snd->qr, &snd->qi, &snd->hr, &snd->hi, &snd->mag, &snd->tmp };
+  bool ok = snd->fft != NULL;
+  for (size_t i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++) {
+    *bufs[i] = calloc((size_t)n, sizeof(float));
+    if (*bufs[i] == NULL) ok = false;
+  }
+  if (!ok) {
+    release(snd);
+    return -1;
+  }
+  memcpy(snd->qr, snd->probe, sizeof(float) * (size_t)snd->plen);
+  unet_fft_forward(snd->fft, snd->qr, snd->qi);
+  double peak = 0, sum = 0, fsum = 0;
+  for (int k = 0; k <= n / 2; k++) {
+    double p = (double)snd->qr[k] * snd->qr[k] + (double)snd->qi[k] * snd->qi[k];
+    if (p > peak) peak = p;
+    sum += p;
+    fsum += p * k;
+  }
+  snd->fc = sum > 0 ? fsum / sum * snd->fs / n : 0;
+  double e = SOUND_REG * peak;
+  for (int k = 0; k < n; k++) {
+    double p = (double)snd->qr[k] * snd->qr[k] + (double)snd->qi[k] * snd->qi[k];
+    double g = k == 0 || k == n / 2 ? 1 : k < n / 2 ? 2 : 0;
+    g /= p + e;
+    snd->qr[k] = (float)(snd->qr[k] * g);
+    snd->qi[k] = (float)(snd->qi[k] * g);
+  }
+  snd->n = n;
+  return 0;
+}
+
+// strongest arrival in [from, to), with its offset in samples interpolated
+// between neighbours
+static int arrival(const _unet_sound_t *snd, int nrec, int from, int to, double *offset) {
+  if (from < 0) from = 0;
+  if (to > nrec) to = nrec;
+  int best = from;
+  for (int i = from; i < to; i++) if (snd->mag[i] > snd->mag[best]) best = i;
+  *offset = 0;
+  if (best > 0 && best < nrec - 1) {
+    double a = sqrt(snd->mag[best - 1]), b = sqrt(snd->mag[best]), c = sqrt(snd->mag[best + 1]);
+    double den = a - 2 * b + c;
+    if (den < 0) *offset = 0.5 * (a - c) / den;
+  }
+  return best;
+}
+
+int unet_sound_process(unet_sound_t snd, const float *rec, int nrec, int nprobes, float pri, unet_sound_result_t *result) {
+  if (snd == NULL || rec == NULL || nrec < 1 || nprobes < 1 || result == NULL) return -1;
+  if (nprobes > 1 && pri <= 0) return -1;
+  _unet_sound_t *usnd = snd;
+  double fs = usnd->fs;
+  double step = nprobes > 1 ? pri * fs : 0;
+  int span = nrec - (int)((nprobes - 1) * step);
+  if (span < 1) return -1;
+  int n = 1;
+  while (n < nrec + usnd->plen && n <= FFT_MAXSIZE / 2) n *= 2;
+  if (n < nrec + usnd->plen || setup(usnd, n) < 0) return -1;
+
+  // deconvolve the whole recording at once
+  memcpy(usnd->hr, rec, sizeof(float) * (size_t)nrec);
+  memset(usnd->hr + nrec, 0, sizeof(float) * (size_t)(n - nrec));
+  memset(usnd->hi, 0, sizeof(float) * (size_t)n);
+  unet_fft_forward(usnd->fft, usnd->hr, usnd->hi);
+  unet_cmulc(usnd->hr, usnd->hi, usnd->hr, usnd->hi, usnd->qr, usnd->qi, n);
+  unet_fft_inverse(usnd->fft, usnd->hr, usnd->hi);
+  for (int i = 0; i < nrec; i++) usnd->mag[i] = usnd->hr[i] * usnd->hr[i] + usnd->hi[i] * usnd->hi[i];
+  memcpy(usnd->tmp, usnd->mag, sizeof(float) * (size_t)nrec);
+  float median = unet_select_kth(usnd->tmp, nrec, nrec / 2);
+
+  // Locate each probe and average the power delay profile aligned on them.
+  // The phase of the analytic response at sample a of probe k is
+  // 2 pi fc (a / fs - k pri - tau_k) plus a constant, which gives the change
+  // in delay tau_k - tau_0 to within whole carrier cycles. The interpolated
+  // arrival times resolve the cycles, and a line fitted to the delays gives
+  // the Doppler shift.
+  double offset;
+  int a0 = arrival(usnd, nrec, 0, span, &offset);
+  double first = a0 + offset;
+  double phase0 = atan2(usnd->hi[a0], usnd->hr[a0]);
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  memset(usnd->pdp, 0, sizeof(float) * (size_t)usnd->ntaps);
+  for (int k = 0; k < nprobes; k++) {
+    int a = a0;
+    double drift = 0;
+    if (k > 0) {
+      double expect = a0 + k * step;
+      a = arrival(usnd, nrec, (int)(expect - step / 2), (int)(expect + step / 2), &offset);
+      drift = (a + offset - first - k * step) / fs;
+      if (usnd->fc > 0) {
+        double p = atan2(usnd->hi[a], usnd->hr[a]);
+        double d = (a - a0 - k * step) / fs - (p - phase0) / (2 * SOUND_PI * usnd->fc);
+        drift = d + round((drift - d) * usnd->fc) / usnd->fc;
+      }
+    }
+    double t = k * (double)pri;
+    sx += t;
+    sy += drift;
+    sxx += t * t;
+    sxy += t * drift;
+    for (int i = 0; i < usnd->ntaps; i++) {
+      int j = a - SOUND_PRE + i;
+      if (j >= 0 && j < nrec) usnd->pdp[i] += usnd->mag[j] / (float)nprobes;
+    }
+  }
+
+  // impulse response of the first probe
+  for (int i = 0; i < usnd->ntaps; i++) {
+    int j = a0 - SOUND_PRE + i;
+    bool in = j >= 0 && j < nrec;
+    usnd->ir[2 * i] = in ? usnd->hr[j] : 0;
+    usnd->ir[2 * i + 1] = in ? usnd->hi[j] : 0;
+  }
+
+  // RMS delay spread of the taps within SOUND_FLOOR of the strongest
+  float peak = 0;
+  for (int i = 0; i < usnd->ntaps; i++) if (usnd->pdp[i] > peak) peak = usnd->pdp[i];
+  double floor = peak * pow(10, -SOUND_FLOOR / 10);
+  double w = 0, m1 = 0, m2 = 0;
+  for (int i = 0; i < usnd->ntaps; i++) {
+    if (usnd->pdp[i] < floor) continue;
+    w += usnd->pdp[i];
+    m1 += usnd->pdp[i] * (double)i;
+    m2 += usnd->pdp[i] * (double)i * i;
+  }
+  double spread = 0;
+  if (w > 0) {
+    m1 /= w;
+    spread = m2 / w - m1 * m1;
+    spread = spread > 0 ? sqrt(spread) / fs : 0;
+  }
+
+  double den = nprobes * sxx - sx * sx;
+  result->ir = usnd->ir;
+  result->pdp = usnd->pdp;
+  result->ntaps = usnd->ntaps;
+  result->fs = usnd->fs;
+  result->t0 = (float)((a0 - SOUND_PRE) / fs);
+  result->delay = (float)(first / fs);
+  result->spread = (float)spread;
+  result->doppler = den > 0 ? (float)(-usnd->fc * (nprobes * sxy - sx * sy) / den) : 0;
+  result->snr = median > 0 ? (float)(10 * log10(usnd->mag[a0] / median)) : 0;
+  result->nprobes = nprobes;
+  return 0;
+}
+
+// copy recorded blocks, with any samples lost between them as silence
+static int sound_block(void *ctx, const unet_block_t *blk) {
+  _sound_rec_t *r = ctx;
+  long long gap = blk->gap < r->nsamples - r->count ? blk->gap : r->nsamples - r->count;
+  memset(r->buf + r->count, 0, sizeof(float) * (size_t)gap);
+  r->count += (int)gap;
+  int n = blk->nsamples < r->nsamples - r->count ? blk->nsamples : r->nsamples - r->count;
+  memcpy(r->buf + r->count, blk->signal, sizeof(float) * (size_t)n);
+  r->count += n;
+  unet_store_release(&r->started, 1);
+  return r->count < r->nsamples ? 0 : 1;
+}
+
+static void *recorder(void *arg) {
+  _sound_rec_t *r = arg;
+  int blksize = r->nsamples < SOUND_BLK ? r->nsamples : SOUND_BLK;
+  r->rv = unetsocket_ext_pbstream(r->sock, blksize, sound_block, r) == 0 && r->count == r->nsamples ? 0 : -1;
+  unet_store_release(&r->done, 1);
+  return NULL;
+}
+
+int unetsocket_ext_sound(unetsocket_t txsock, unetsocket_t rxsock, unet_sound_t snd, int nprobes, int pri, float maxdelay, unet_sound_result_t *result) {
+  if (txsock == NULL || rxsock == NULL || txsock == rxsock || snd == NULL) return -1;
+  if (nprobes < 1 || maxdelay < 0 || result == NULL) return -1;
+  _unet_sound_t *usnd = snd;
+  float dacrate = usnd->fs;
+  float adcrate = usnd->fs;
+  if (unetsocket_ext_fget(txsock, -1, "org.arl.unet.Services.BASEBAND", "dacrate", &dacrate) < 0) dacrate = usnd->fs;
+  if (unetsocket_ext_fget(rxsock, -1, "org.arl.unet.Services.BASEBAND", "adcrate", &adcrate) == 0 && fabsf(adcrate - usnd->fs) > 0.5f) return -1;
+
+  // the probe at the DAC rate
+  float *sig = usnd->probe;
+  int siglen = usnd->plen;
+  if (fabsf(dacrate - usnd->fs) > 0.5f) {
+    unet_resample_t rs = unet_resample_create(usnd->fs, dacrate);
+    if (rs == NULL) return -1;
+    int max = unet_resample_max_output(rs, usnd->plen) + unet_resample_max_output(rs, RESAMPLE_BLK);
+    sig = max > 0 ? malloc(sizeof(float) * (size_t)max) : NULL;
+    siglen = -1;
+    if (sig != NULL) {
+      siglen = unet_resample_process(rs, usnd->probe, usnd->plen, sig);
+      if (siglen >= 0) {
+        int tail = unet_resample_flush(rs, sig + siglen);
+        siglen = tail < 0 ? -1 : siglen + tail;
+      }
+    }
+    unet_resample_destroy(rs);
+    if (siglen <= 0) {
+      free(sig);
+      return -1;
+    }
+  }
+
+  // the modem rounds the gap between probes to whole milliseconds
+  double sigdur = 1000.0 * siglen / (int)dacrate;
+  double actual = (sigdur + round(pri - sigdur)) / 1000;
+  int rv = -1;
+  _sound_rec_t r;
+  r.sock = rxsock;
+  r.nsamples = SOUND_BLK + (int)ceil(usnd->fs * (SOUND_LEAD / 1000.0 + (nprobes - 1) * actual + (double)usnd->plen / usnd->fs + maxdelay));
+  r.buf = malloc(sizeof(float) * (size_t)r.nsamples);
+  r.count = 0;
+  r.started = 0;
+  r.done = 0;
+  r.rv = -1;
+  pthread_t tid;
+  if (r.buf != NULL && pthread_create(&tid, NULL, recorder, &r) == 0) {
+    // the probes go out once the recording is known to be running
+    while (unet_load_acquire(&r.started) == 0 && unet_load_acquire(&r.done) == 0) Sleep(SOUND_POLL);
+    int txrv = unet_load_acquire(&r.started) != 0 ? unetsocket_ext_npulses(txsock, sig, siglen, (int)dacrate, nprobes, pri) : -1;
+    pthread_join(tid, NULL);
+    if (txrv == 0 && r.rv == 0) rv = unet_sound_process(snd, r.buf, r.nsamples, nprobes, (float)actual, result);
+  }
+  free(r.buf);
+  if (sig != usnd->probe) free(sig);
+  return rv;
+}
@@ -0,0 +1,105 @@
+#ifndef _UNETSOUND_H_
+#define _UNETSOUND_H_
+
+#include "unet.h"
+
+typedef void *unet_sound_t;        ///< channel sounder
+
+/// Channel estimate from a sounding
+
+typedef struct {
+  const float *ir;                 ///< complex impulse response of the first probe (alternating real and imaginary values)
+  const float *pdp;                ///< power delay profile, averaged over the probes
+  int ntaps;                       ///< number of taps in ir and pdp
+  float fs;                        ///< tap rate (Hz)
+  float t0;                        ///< time of the first tap from the start of the recording (s)
+  float delay;                     ///< time of the strongest arrival from the start of the recording (s)
+  float spread;                    ///< RMS delay spread of the arrivals within SOUND_FLOOR of the strongest (s)
+  float doppler;                   ///< Doppler shift at the probe center frequency, from the drift of the arrivals (Hz)
+  float snr;                       ///< strongest arrival over the median deconvolution output (dB)
+  int nprobes;                     ///< number of probes analyzed
+} unet_sound_result_t;
+
+/// Taps before the strongest arrival included in the impulse response
+
+#define SOUND_PRE                32
+
+/// Level below the strongest arrival included in the delay spread (dB)
+
+#define SOUND_FLOOR              30.0f
+
+/// Regularization of the deconvolution, relative to the peak probe power
+
+#define SOUND_REG                1e-3f
+
+/// Samples per recorded block in unetsocket_ext_sound()
+
+#define SOUND_BLK                8192
+
+/// Time allowed in unetsocket_ext_sound() from the arrival of the first
+/// recorded block to the transmission of the first probe (ms)
+
+#define SOUND_LEAD               500
+
+/// Interval at which unetsocket_ext_sound() checks whether recording has started (ms)
+
+#define SOUND_POLL               10
+
+/// Create a channel sounder for a passband probe signal, such as a chirp or an
+/// m-sequence from unet_siggen.h. The channel impulse response is estimated by
+/// regularized deconvolution of a recording by the probe in the frequency
+/// domain, which, unlike correlation, removes the probe's own autocorrelation
+/// sidelobes within its band.
+///
+/// @param fs               Sampling rate of the probe and recordings (Hz)
+/// @param probe            Passband probe signal
+/// @param nsamples         Number of samples in the probe
+/// @param ntaps            Length of the impulse response to estimate (taps)
+/// @return                 Channel sounder, or NULL on error
+
+unet_sound_t unet_sound_create(float fs, const float *probe, int nsamples, int ntaps);
+
+/// Destroy a channel sounder.
+///
+/// @param snd              Channel sounder
+
+void unet_sound_destroy(unet_sound_t snd);
+
+/// Estimate the channel from a passband recording of a sequence of probes
+/// transmitted at a fixed interval. The first probe is taken as the strongest
+/// arrival that leaves room for the rest of the sequence, and each following
+/// probe is searched for within half an interval of where it is expected.
+/// The result points into the sounder's buffers, which are valid until the
+/// next call or until the sounder is destroyed.
+///
+/// @param snd              Channel sounder
+/// @param rec              Passband recording
+/// @param nrec             Number of samples in the recording
+/// @param nprobes          Number of probes in the recording
+/// @param pri              Probe repetition interval (s), ignored for 1 probe
+/// @param result           Channel estimate
+/// @return                 0 on success, -1 otherwise
+
+int unet_sound_process(unet_sound_t snd, const float *rec, int nrec, int nprobes, float pri, unet_sound_result_t *result);
+
+/// Sound the channel between two modems: transmit nprobes probes at interval
+/// pri from one socket with unetsocket_ext_npulses(), record them on the other
+/// with unetsocket_ext_pbstream(), and estimate the channel. The probes are
+/// transmitted once the first recorded block arrives, so they cannot precede
+/// the recording, and recording lasts until maxdelay seconds after the last
+/// probe, allowing SOUND_LEAD ms for the transmission to start. The probe is
+/// resampled if the transmitter's DAC rate differs from the sounder's sampling
+/// rate.
+///
+/// @param txsock           Unet socket of the transmitting modem
+/// @param rxsock           Unet socket of the recording modem
+/// @param snd              Channel sounder
+/// @param nprobes          Number of probes
+/// @param pri              Probe repetition interval (ms)
+/// @param maxdelay         Largest expected propagation delay (s)
+/// @param result           Channel estimate
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_sound(unetsocket_t txsock, unetsocket_t rxsock, unet_sound_t snd, int nprobes, int pri, float maxdelay, unet_sound_result_t *result);
+
+#endif
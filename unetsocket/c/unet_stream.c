@@ -0,0 +1,399 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_ext.h"
+#include "unet_stream.h"
+#include "unet_atomic.h"
+#include "unet_time.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define STREAM_LEAD              ((long long)TIMEOUT * 1000)   // us before the first block starts
+#define STREAM_IDLEN             64
+#define STREAM_PBSCNT            0x7FFFFFFF   // blocks requested for continuous capture
+#define CACHE_LINE               64
+
+typedef struct {
+  unet_block_t *blocks;
+  float *data;
+  size_t nblocks;
+  int blklen;
+  // head and tail count blocks committed and released, and are kept on
+  // separate cache lines since they are written by different threads
+  char pad0[CACHE_LINE];
+  volatile size_t head;
+  char pad1[CACHE_LINE];
+  volatile size_t tail;
+  char pad2[CACHE_LINE];
+  volatile size_t closed;
+} _unet_ring_t;
+
+typedef struct {
+  FILE *fp;
+  int width;
+} _stream_file_t;
+
+// read up to nsamples from a source, returning fewer only at the end of the signal
+static int fill(unet_sample_source_t source, void *ctx, float *buf, int nsamples, int width) {
+  int n = 0;
+  while (n < nsamples) {
+    int rv = source(ctx, buf + width * n, nsamples - n);
+    if (rv < 0 || rv > nsamples - n) return -1;
+    if (rv == 0) break;
+    n += rv;
+  }
+  return n;
+}
+
+// wait for a block to be transmitted, failing if it started later than scheduled
+static int wait_tx(fjage_gw_t gw, const char *id, long long txtime, long long slack, long timeout) {
+  fjage_msg_t ntf = fjage_receive(gw, "org.arl.unet.phy.TxFrameNtf", id, timeout);
+  if (ntf == NULL) return -1;
+  long long actual = unet_msg_get_time(ntf, "txTime", txtime);
+  fjage_msg_destroy(ntf);
+  return actual - txtime > slack ? -1 : 0;
+}
+
+int unetsocket_ext_tx_stream(unetsocket_t sock, float fc, unet_sample_source_t source, void *ctx, int blksize) {
+  if (sock == NULL || source == NULL || blksize < 0) return -1;
+  bool complex = fc > 0 || fc < 0;
+  int width = complex ? 2 : 1;
+  float rate = 0;
+  int maxlen = 0;
+  if (unetsocket_ext_fget(sock, 0, "org.arl.unet.Services.BASEBAND", complex ? "basebandRate" : "dacrate", &rate) < 0) return -1;
+  if (rate <= 0) return -1;
+  if (blksize == 0) blksize = STREAM_TXBLK;
+  if (unetsocket_ext_iget(sock, 0, "org.arl.unet.Services.BASEBAND", "maxSignalLength", &maxlen) == 0 && maxlen > 0 && blksize > maxlen) blksize = maxlen;
+  fjage_gw_t gw = unetsocket_get_gateway(sock);
+  fjage_aid_t bb = fjage_agent_for_service(gw, "org.arl.unet.Services.BASEBAND");
+  if (bb == NULL) return -1;
+  float *buf = malloc(sizeof(float) * (size_t)(width * blksize));
+  long long now, t0;
+  if (buf == NULL || unetsocket_ext_get_time(sock, &now) < 0) {
+    free(buf);
+    fjage_aid_destroy(bb);
+    return -1;
+  }
+  long long host0 = unet_host_time();
+  t0 = now + STREAM_LEAD;
+  // a block that starts more than a sample late leaves a gap
+  long long slack = (long long)(1e6 / rate) + 1;
+  // a queued block starts within STREAM_TXDEPTH block durations, and a block
+  // ends at most one block duration after it starts
+  long timeout = (long)((STREAM_TXDEPTH + 1) * (double)blksize * 1000 / rate) + (long)(STREAM_LEAD / 1000) + 5 * TIMEOUT;
+  char pending[STREAM_TXDEPTH][STREAM_IDLEN];
+  long long txtimes[STREAM_TXDEPTH];
+  int head = 0;
+  int inflight = 0;
+  unsigned long long sent = 0;
+  int rv = 0;
+  while (true) {
+    int n = fill(source, ctx, buf, blksize, width);
+    if (n < 0) {
+      rv = -1;
+      break;
+    }
+    if (n == 0) break;
+    // schedule from the total sample count, so rounding errors do not accumulate
+    long long txtime = t0 + (long long)((double)sent * 1e6 / rate);
+    // a block whose start the modem clock has passed by the host's reckoning
+    // cannot be played on time, as when the source is too slow
+    if (txtime < now + unet_host_time() - host0) {
+      rv = -1;
+      break;
+    }
+    fjage_msg_t msg = fjage_msg_create("org.arl.unet.bb.TxBasebandSignalReq", FJAGE_REQUEST);
+    fjage_msg_set_recipient(msg, bb);
+    fjage_msg_add_float(msg, "fc", fc);
+    fjage_msg_add_bool(msg, "signal__isComplex", complex);
+    fjage_msg_add_float_array(msg, "signal", buf, width * n);
+    unet_msg_add_time(msg, "txTime", txtime);
+    txtimes[(head + inflight) % STREAM_TXDEPTH] = txtime;
+    char *id = pending[(head + inflight) % STREAM_TXDEPTH];
+    strncpy(id, fjage_msg_get_id(msg), STREAM_IDLEN - 1);
+    id[STREAM_IDLEN - 1] = 0;
+    msg = fjage_request(gw, msg, 5 * TIMEOUT);
+    if (msg == NULL || fjage_msg_get_performative(msg) != FJAGE_AGREE) {
+      fjage_msg_destroy(msg);
+      rv = -1;
+      break;
+    }
+    fjage_msg_destroy(msg);
+    inflight++;
+    sent += (unsigned long long)n;
+    if (n < blksize) break;
+    if (inflight == STREAM_TXDEPTH) {
+      if (wait_tx(gw, pending[head], txtimes[head], slack, timeout) < 0) {
+        rv = -1;
+        break;
+      }
+      head = (head + 1) % STREAM_TXDEPTH;
+      inflight--;
+    }
+  }
+  while (rv == 0 && inflight > 0) {
+    if (wait_tx(gw, pending[head], txtimes[head], slack, timeout) < 0) rv = -1;
+    head = (head + 1) % STREAM_TXDEPTH;
+    inflight--;
+  }
+  free(buf);
+  fjage_aid_destroy(bb);
+  return rv;
+}
+
+static int file_source(void *ctx, float *buf, int nsamples) {
+  _stream_file_t *f = ctx;
+  size_t n = fread(buf, sizeof(float) * (size_t)f->width, (size_t)nsamples, f->fp);
+  if (n == 0 && ferror(f->fp)) return -1;
+  return (int)n;
+}
+
+int unetsocket_ext_tx_stream_file(unetsocket_t sock, float fc, const char *filename) {
+  if (sock == NULL || filename == NULL) return -1;
+  _stream_file_t f;
+  f.width = fc > 0 || fc < 0 ? 2 : 1;
+  f.fp = fopen(filename, "rb");
+  if (f.fp == NULL) return -1;
+  int rv = unetsocket_ext_tx_stream(sock, fc, file_source, &f, 0);
+  fclose(f.fp);
+  return rv;
+}
+
+unet_ring_t unet_ring_create(int nblocks, int blklen) {
+  if (nblocks <= 0 || blklen <= 0) return NULL;
+  _unet_ring_t *ring = calloc(1, sizeof(_unet_ring_t));
+  if (ring == NULL) return NULL;
+  ring->nblocks = (size_t)nblocks;
+  ring->blklen = blklen;
+  ring->blocks = calloc(ring->nblocks, sizeof(unet_block_t));
+  ring->data = malloc(ring->nblocks * (size_t)blklen * sizeof(float));
+  if (ring->blocks == NULL || ring->data == NULL) {
+    unet_ring_destroy(ring);
+    return NULL;
+  }
+  for (size_t i = 0; i < ring->nblocks; i++) ring->blocks[i].signal = ring->data + i * (size_t)blklen;
+  return ring;
+}
+
+void unet_ring_destroy(unet_ring_t ring) {
+  if (ring == NULL) return;
+  _unet_ring_t *uring = ring;
+  free(uring->blocks);
+  free(uring->data);
+  free(uring);
+}
+
+unet_block_t *unet_ring_reserve(unet_ring_t ring) {
+  if (ring == NULL) return NULL;
+  _unet_ring_t *uring = ring;
+  size_t head = uring->head;
+  if (head - unet_load_acquire(&uring->tail) >= uring->nblocks) return NULL;
+  return uring->blocks + head % uring->nblocks;
+}
+
+void unet_ring_commit(unet_ring_t ring) {
+  if (ring == NULL) return;
+  _unet_ring_t *uring = ring;
+  unet_store_release(&uring->head, uring->head + 1);
+}
+
+unet_block_t *unet_ring_peek(unet_ring_t ring) {
+  if (ring == NULL) return NULL;
+  _unet_ring_t *uring = ring;
+  size_t tail = uring->tail;
+  if (unet_load_acquire(&uring->head) == tail) return NULL;
+  return uring->blocks + tail % uring->nblocks;
+}
+
+void unet_ring_release(unet_ring_t ring) {
+  if (ring == NULL) return;
+  _unet_ring_t *uring = ring;
+  unet_store_release(&uring->tail, uring->tail + 1);
+}
+
+void unet_ring_close(unet_ring_t ring) {
+  if (ring == NULL) return;
+  _unet_ring_t *uring = ring;
+  unet_store_release(&uring->closed, 1);
+}
+
+bool unet_ring_is_closed(unet_ring_t ring) {
+  if (ring == NULL) return true;
+  _unet_ring_t *uring = ring;
+  return unet_load_acquire(&uring->closed) != 0;
+}
+
+// deliver passband blocks to a sink, or into a ring if ring is not NULL
+static int pbstream(unetsocket_t sock, int blksize, unet_block_sink_t sink, void *ctx, _unet_ring_t *ring) {
+  if (blksize == 0) blksize = PBSBLK;
+  if (blksize < 0 || (ring != NULL && blksize > ring->blklen)) return -1;
+  fjage_gw_t gw = unetsocket_get_gateway(sock);
+  fjage_aid_t bb = fjage_agent_for_service(gw, "org.arl.unet.Services.BASEBAND");
+  if (bb == NULL) return -1;
+  unet_block_t local;
+  local.signal = ring == NULL ? malloc(sizeof(float) * (size_t)blksize) : NULL;
+  if (ring == NULL && local.signal == NULL) {
+    fjage_aid_destroy(bb);
+    return -1;
+  }
+  fjage_subscribe_agent(gw, bb);
+  int rv = -1;
+  if (unetsocket_ext_iset(sock, 0, "org.arl.unet.Services.BASEBAND", "pbsblk", blksize) == 0 &&
+      unetsocket_ext_iset(sock, 0, "org.arl.unet.Services.BASEBAND", "pbscnt", STREAM_PBSCNT) == 0) {
+    long long expected = -1;
+    unsigned long long seq = 0;
+    long idle = 0;
+    while (ring == NULL || !unet_ring_is_closed(ring)) {
+      fjage_msg_t ntf = fjage_receive(gw, "org.arl.unet.bb.RxBasebandSignalNtf", NULL, TIMEOUT);
+      if (ntf == NULL) {
+        idle += TIMEOUT;
+        if (idle >= STREAM_RXTIMEOUT) break;
+        continue;
+      }
+      idle = 0;
+      long long rxtime = unet_msg_get_time(ntf, "rxTime", 0);
+      float fs = fjage_msg_get_float(ntf, "fs", 0);
+      // a block that does not fit in a full ring is dropped, and the consumer
+      // sees the jump in sequence number
+      unet_block_t *blk = ring == NULL ? &local : unet_ring_reserve(ring);
+      int n = blksize;
+      if (blk != NULL) {
+        n = fjage_msg_get_float_array(ntf, "signal", blk->signal, blksize);
+        blk->nsamples = n;
+        blk->fs = fs;
+        blk->fc = 0;
+        blk->rxtime = rxtime;
+        blk->seq = seq;
+        blk->gap = expected < 0 || fs <= 0 ? 0 : llround((double)(rxtime - expected) * fs / 1e6);
+      }
+      fjage_msg_destroy(ntf);
+      seq++;
+      expected = fs > 0 ? rxtime + llround(n * 1e6 / fs) : -1;
+      if (ring != NULL) {
+        if (blk != NULL) unet_ring_commit(ring);
+      } else if (sink(ctx, blk) != 0) {
+        rv = 0;
+        break;
+      }
+    }
+    if (ring != NULL && unet_ring_is_closed(ring)) rv = 0;
+    unetsocket_ext_iset(sock, 0, "org.arl.unet.Services.BASEBAND", "pbscnt", 0);
+  }
+  if (ring != NULL) unet_ring_close(ring);
+  free(local.signal);
+  fjage_aid_destroy(bb);
+  return rv;
+}
+
+int unetsocket_ext_pbstream(unetsocket_t sock, int blksize, unet_block_sink_t sink, void *ctx) {
+  if (sock == NULL || sink == NULL) return -1;
+  return pbstream(sock, blksize, sink, ctx, NULL);
+}
+
+int unetsocket_ext_pbstream_ring(unetsocket_t sock, int blksize, unet_ring_t ring) {
+  if (sock == NULL || ring == NULL) return -1;
+  return pbstream(sock, blksize, NULL, NULL, ring);
+}
+
+void unet_block_join(unet_block_t *blk, long long *expected) {
+  if (blk == NULL || expected == NULL || blk->fs <= 0) return;
+  long long trim = 0;
+  blk->gap = 0;
+  if (*expected >= 0) {
+    long long d = llround((double)(*expected - blk->rxtime) * blk->fs / 1e6);
+    if (d > 0) trim = d < blk->nsamples ? d : blk->nsamples;
+    else blk->gap = -d;
+  }
+  blk->signal += (blk->fc > 0 ? 2 : 1) * trim;
+  blk->nsamples -= (int)trim;
+  blk->rxtime += llround((double)trim * 1e6 / blk->fs);
+  long long end = blk->rxtime + llround(blk->nsamples * 1e6 / blk->fs);
+  // a block recorded entirely before the previous one ended does not move the stream back
+  if (end > *expected) *expected = end;
+}
+
+static int bbrecord_req(fjage_gw_t gw, fjage_aid_t bb, int reclen, long long rectime, char *id) {
+  fjage_msg_t msg = fjage_msg_create("org.arl.unet.bb.RecordBasebandSignalReq", FJAGE_REQUEST);
+  fjage_msg_set_recipient(msg, bb);
+  fjage_msg_add_int(msg, "recLength", reclen);
+  unet_msg_add_time(msg, "recTime", rectime);
+  strncpy(id, fjage_msg_get_id(msg), STREAM_IDLEN - 1);
+  id[STREAM_IDLEN - 1] = 0;
+  msg = fjage_request(gw, msg, 5 * TIMEOUT);
+  int rv = msg != NULL && fjage_msg_get_performative(msg) == FJAGE_AGREE ? 0 : -1;
+  fjage_msg_destroy(msg);
+  return rv;
+}
+
+int unetsocket_ext_bbstream(unetsocket_t sock, int blksize, unet_block_sink_t sink, void *ctx) {
+  if (sock == NULL || sink == NULL || blksize < 0) return -1;
+  if (blksize == 0) blksize = STREAM_BBBLK;
+  float fs = 0;
+  if (unetsocket_ext_fget(sock, 0, "org.arl.unet.Services.BASEBAND", "basebandRate", &fs) < 0) return -1;
+  if (fs <= 0) return -1;
+  fjage_gw_t gw = unetsocket_get_gateway(sock);
+  fjage_aid_t bb = fjage_agent_for_service(gw, "org.arl.unet.Services.BASEBAND");
+  if (bb == NULL) return -1;
+  int reclen = blksize + STREAM_BBOVERLAP;
+  float *buf = malloc(2 * sizeof(float) * (size_t)reclen);
+  long long base;
+  if (buf == NULL || unetsocket_ext_get_time(sock, &base) < 0) {
+    free(buf);
+    fjage_aid_destroy(bb);
+    return -1;
+  }
+  // block seq starts at time base; later blocks are timed from there
+  base += STREAM_LEAD;
+  unsigned long long baseseq = 0;
+  long long overlap = llround(STREAM_BBOVERLAP * 1e6 / fs);
+  long timeout = (long)((STREAM_BBDEPTH + 1) * (double)reclen * 1000 / fs) + (long)(STREAM_LEAD / 1000) + 5 * TIMEOUT;
+  char pending[STREAM_BBDEPTH][STREAM_IDLEN];
+  int head = 0;
+  int inflight = 0;
+  unsigned long long seq = 0;
+  long long expected = -1;
+  int rv = 0;
+  while (true) {
+    while (inflight < STREAM_BBDEPTH) {
+      unsigned long long j = seq + (unsigned long long)inflight;
+      long long start = base + llround((double)(j - baseseq) * blksize * 1e6 / fs) - overlap;
+      if (bbrecord_req(gw, bb, reclen, start, pending[(head + inflight) % STREAM_BBDEPTH]) < 0) {
+        rv = -1;
+        break;
+      }
+      inflight++;
+    }
+    if (rv < 0) break;
+    fjage_msg_t ntf = fjage_receive(gw, "org.arl.unet.bb.RxBasebandSignalNtf", pending[head], timeout);
+    head = (head + 1) % STREAM_BBDEPTH;
+    inflight--;
+    if (ntf == NULL) {
+      rv = -1;
+      break;
+    }
+    unet_block_t blk;
+    blk.rxtime = unet_msg_get_time(ntf, "rxTime", 0);
+    blk.nsamples = fjage_msg_get_float_array(ntf, "signal", buf, 2 * reclen) / 2;
+    blk.fc = fjage_msg_get_float(ntf, "fc", 0);
+    fjage_msg_destroy(ntf);
+    blk.signal = buf;
+    blk.fs = fs;
+    blk.seq = seq;
+    unet_block_join(&blk, &expected);
+    // the next request is timed from the end of this block
+    base = expected;
+    baseseq = ++seq;
+    if (sink(ctx, &blk) != 0) break;
+  }
+  // collect the recordings still queued at the modem
+  while (inflight > 0) {
+    fjage_msg_destroy(fjage_receive(gw, "org.arl.unet.bb.RxBasebandSignalNtf", pending[head], timeout));
+    head = (head + 1) % STREAM_BBDEPTH;
+    inflight--;
+  }
+  free(buf);
+  fjage_aid_destroy(bb);
+  return rv;
+}
@@ -0,0 +1,226 @@
+#ifndef _UNETSTREAM_H_
+#define _UNETSTREAM_H_
+
+#include <stdbool.h>
+#include "fjage.h"
+#include "unet.h"
+
+typedef void *unet_ring_t;         ///< single-producer single-consumer block ring
+
+/// A block of signal samples.
+
+typedef struct {
+  float *signal;                   ///< samples, alternating real and imaginary values for baseband
+  int nsamples;                    ///< number of samples
+  float fs;                        ///< sampling rate (Hz)
+  float fc;                        ///< carrier frequency (Hz), 0 for passband
+  long long rxtime;                ///< modem time of the first sample (us)
+  unsigned long long seq;          ///< block sequence number
+  long long gap;                   ///< samples missed just before this block, 0 if contiguous
+} unet_block_t;
+
+/// Default number of samples per block in streaming transmission
+
+#define STREAM_TXBLK             65536
+
+/// Number of blocks queued at the modem ahead of playback
+
+#define STREAM_TXDEPTH           3
+
+/// Default number of samples per block in chained baseband recording
+
+#define STREAM_BBBLK             65536
+
+/// Samples by which consecutive chained baseband recordings overlap
+
+#define STREAM_BBOVERLAP         64
+
+/// Number of baseband record requests queued at the modem
+
+#define STREAM_BBDEPTH           2
+
+/// Time without a recorded block after which a capture stream fails
+
+#define STREAM_RXTIMEOUT         (10 * TIMEOUT)
+
+/// Block sink for streaming capture. The block is only valid during the call.
+///
+/// @param ctx              User context
+/// @param blk              Received block
+/// @return                 0 to continue capturing, any other value to stop
+
+typedef int (*unet_block_sink_t)(void *ctx, const unet_block_t *blk);
+
+/// Sample source for streaming transmission. Fills buf with up to nsamples
+/// samples. Baseband samples are complex, with alternating real and imaginary
+/// values, so a baseband source writes 2*nsamples floats.
+///
+/// @param ctx              User context
+/// @param buf              Buffer to fill
+/// @param nsamples         Largest number of samples to write
+/// @return                 Number of samples written, 0 at the end of the
+///                         signal, -1 on error
+
+typedef int (*unet_sample_source_t)(void *ctx, float *buf, int nsamples);
+
+/// Transmit a signal of arbitrary length, streamed from a sample source.
+///
+/// The signal is read in blocks of blksize samples, and each block is sent as
+/// a separate baseband signal request scheduled to start exactly where the
+/// previous block ends, so playback is gapless. At most STREAM_TXDEPTH blocks
+/// are queued at the modem at any time, so memory use is bounded by the block
+/// size and not the signal length. The call returns after the last block has
+/// been transmitted.
+///
+/// The block size is limited to the modem's bb.maxSignalLength. Passband
+/// signals are played at bb.dacrate and baseband signals at bb.basebandRate.
+///
+/// Playback fails rather than leave a gap when a block is late: when the
+/// source returns a block after the modem clock has passed its start, or when
+/// the modem reports starting a block more than a sample later than scheduled.
+///
+/// @param sock             Unet socket
+/// @param fc               Carrier frequency for a baseband signal, 0 for a
+///                         passband signal
+/// @param source           Sample source
+/// @param ctx              User context passed to the source
+/// @param blksize          Samples per block, 0 for STREAM_TXBLK
+/// @return                 0 on success, -1 if a block is late or on error
+
+int unetsocket_ext_tx_stream(unetsocket_t sock, float fc, unet_sample_source_t source, void *ctx, int blksize);
+
+/// Transmit a signal streamed from a file of raw 32-bit floats in native byte
+/// order. Baseband files hold alternating real and imaginary values.
+///
+/// @param sock             Unet socket
+/// @param fc               Carrier frequency for a baseband signal, 0 for a
+///                         passband signal
+/// @param filename         Signal file
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_tx_stream_file(unetsocket_t sock, float fc, const char *filename);
+
+/// Create a lock-free ring of signal blocks, to pass blocks from one producer
+/// thread to one consumer thread without copying. Block buffers are allocated
+/// once, when the ring is created.
+///
+/// @param nblocks          Number of blocks in the ring
+/// @param blklen           Capacity of each block (floats)
+/// @return                 Ring, or NULL on error
+
+unet_ring_t unet_ring_create(int nblocks, int blklen);
+
+/// Destroy a block ring. Neither the producer nor the consumer may be using
+/// it any more.
+///
+/// @param ring             Block ring
+
+void unet_ring_destroy(unet_ring_t ring);
+
+/// Get the next free block to fill (producer only). The block is passed to
+/// the consumer by unet_ring_commit().
+///
+/// @param ring             Block ring
+/// @return                 Free block, or NULL if the ring is full
+
+unet_block_t *unet_ring_reserve(unet_ring_t ring);
+
+/// Pass the block obtained from unet_ring_reserve() to the consumer (producer
+/// only).
+///
+/// @param ring             Block ring
+
+void unet_ring_commit(unet_ring_t ring);
+
+/// Get the oldest filled block (consumer only). The block stays valid until
+/// it is returned to the producer with unet_ring_release().
+///
+/// @param ring             Block ring
+/// @return                 Oldest block, or NULL if the ring is empty
+
+unet_block_t *unet_ring_peek(unet_ring_t ring);
+
+/// Return the block obtained from unet_ring_peek() to the producer (consumer
+/// only).
+///
+/// @param ring             Block ring
+
+void unet_ring_release(unet_ring_t ring);
+
+/// Mark a block ring as closed. The consumer closes the ring to stop the
+/// producer, and the producer closes it when no more blocks will follow.
+///
+/// @param ring             Block ring
+
+void unet_ring_close(unet_ring_t ring);
+
+/// Check if a block ring has been closed.
+///
+/// @param ring             Block ring
+/// @return                 true if closed, false otherwise
+
+bool unet_ring_is_closed(unet_ring_t ring);
+
+/// Continuously record passband signal blocks and deliver each to a callback.
+///
+/// The modem streams blocks of blksize samples until the sink asks to stop.
+/// Block timestamps are checked for continuity, and any samples lost between
+/// blocks are reported in the gap field of the following block.
+///
+/// @param sock             Unet socket
+/// @param blksize          Samples per block, 0 for PBSBLK
+/// @param sink             Block sink
+/// @param ctx              User context passed to the sink
+/// @return                 0 when stopped by the sink, -1 on error
+
+int unetsocket_ext_pbstream(unetsocket_t sock, int blksize, unet_block_sink_t sink, void *ctx);
+
+/// Continuously record passband signal blocks into a block ring. Samples are
+/// decoded straight into the ring blocks, for a consumer on another thread.
+///
+/// Recording continues until the consumer closes the ring, and the ring is
+/// closed when recording stops for any other reason. If the consumer falls
+/// behind and the ring is full, blocks are dropped; this shows up as a jump in
+/// the block sequence number.
+///
+/// @param sock             Unet socket
+/// @param blksize          Samples per block, 0 for PBSBLK (at most the ring
+///                         block capacity)
+/// @param ring             Block ring
+/// @return                 0 when stopped by the consumer, -1 on error
+
+int unetsocket_ext_pbstream_ring(unetsocket_t sock, int blksize, unet_ring_t ring);
+
+/// Join a recorded block to the end of the previous block of a stream. Samples
+/// already delivered with the previous block are trimmed from the start of
+/// the block, and samples missed between the two are counted in its gap. The
+/// sample layout follows the carrier frequency, as in unet_block_t.
+///
+/// @param blk              Block as recorded, with its signal, nsamples,
+///                         rxtime and gap updated
+/// @param expected         Modem time just after the previous block (us), -1
+///                         before the first block, updated past this block
+
+void unet_block_join(unet_block_t *blk, long long *expected);
+
+/// Continuously record a baseband signal as a chain of record requests.
+///
+/// Each record request covers one block, and STREAM_BBDEPTH requests are kept
+/// queued at the modem, so the length of the recording is not limited by the
+/// modem's record buffer. Every request is timed from the end of the latest
+/// block received and starts STREAM_BBOVERLAP samples early. The overlap is
+/// trimmed with unet_block_join(), so the blocks join up exactly. A block
+/// that starts late reports the missing samples in its gap field.
+///
+/// Samples are complex, with alternating real and imaginary values, and
+/// nsamples counts complex samples.
+///
+/// @param sock             Unet socket
+/// @param blksize          Samples per block, 0 for STREAM_BBBLK
+/// @param sink             Block sink
+/// @param ctx              User context passed to the sink
+/// @return                 0 when stopped by the sink, -1 on error
+
+int unetsocket_ext_bbstream(unetsocket_t sock, int blksize, unet_block_sink_t sink, void *ctx);
+
+#endif
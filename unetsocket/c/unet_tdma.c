@@ -0,0 +1,231 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_tdma.h"
+#include "unet_txtime.h"
+#include "unet_time.h"
+#include "pthreadwindows.h"
+#include <string.h>
+
+typedef struct {
+  uint8_t *data;
+  int len;
+  int to;
+  int protocol;
+  int tries;
+} dgram_t;
+
+typedef struct {
+  char id[FRAME_ID_LEN];
+  long long end;                     // time after which it is given up
+} pending_t;
+
+typedef struct {
+  unetsocket_t sock;
+  fjage_gw_t gw;
+  unet_clock_t clk;
+  int nslots;
+  long long slotlen;
+  long long epoch;
+  pthread_t tid;
+  bool running;
+  volatile bool quit;
+  long long last;                    // start of the last slot used
+  pthread_mutex_t lock;              // protects everything below
+  bool *owned;
+  dgram_t queue[TDMA_QUEUE];         // datagram ring
+  int head;
+  int count;
+  pending_t pending[TDMA_QUEUE];     // transmissions awaiting a TxFrameNtf, oldest first
+  int npending;
+  unet_tdma_stats_t stats;
+} _unet_tdma_t;
+
+unet_tdma_t unet_tdma_create(unetsocket_t sock, unet_clock_t clk, int nslots, long long slotlen, long long epoch) {
+  if (sock == NULL || clk == NULL || nslots < 1 || slotlen <= 0) return NULL;
+  _unet_tdma_t *tdma = calloc(1, sizeof(_unet_tdma_t));
+  if (tdma == NULL) return NULL;
+  tdma->owned = calloc((size_t)nslots, sizeof(bool));
+  if (tdma->owned == NULL) {
+    free(tdma);
+    return NULL;
+  }
+  tdma->sock = sock;
+  tdma->gw = unetsocket_get_gateway(sock);
+  tdma->clk = clk;
+  tdma->nslots = nslots;
+  tdma->slotlen = slotlen;
+  tdma->epoch = epoch;
+  pthread_mutex_init(&tdma->lock, NULL);
+  return tdma;
+}
+
+void unet_tdma_destroy(unet_tdma_t tdma) {
+  if (tdma == NULL) return;
+  _unet_tdma_t *utdma = tdma;
+  unet_tdma_stop(utdma);
+  for (int i = 0; i < utdma->count; i++) free(utdma->queue[(utdma->head + i) % TDMA_QUEUE].data);
+  pthread_mutex_destroy(&utdma->lock);
+  free(utdma->owned);
+  free(utdma);
+}
+
+int unet_tdma_set_slot(unet_tdma_t tdma, int slot, bool owned) {
+  if (tdma == NULL) return -1;
+  _unet_tdma_t *utdma = tdma;
+  if (slot < 0 || slot >= utdma->nslots) return -1;
+  pthread_mutex_lock(&utdma->lock);
+  utdma->owned[slot] = owned;
+  pthread_mutex_unlock(&utdma->lock);
+  return 0;
+}
+
+static long long floordiv(long long a, long long b) {
+  long long q = a / b;
+  return a % b != 0 && a < 0 ? q - 1 : q;
+}
+
+// next owned slot, with the lock held
+static int next_slot(const _unet_tdma_t *tdma, long long time, long long *start) {
+  long long k = -floordiv(tdma->epoch - time, tdma->slotlen);
+  for (int i = 0; i < tdma->nslots; i++, k++) {
+    int slot = (int)(k - floordiv(k, tdma->nslots) * tdma->nslots);
+    if (tdma->owned[slot]) {
+      *start = tdma->epoch + k * tdma->slotlen;
+      return slot;
+    }
+  }
+  return -1;
+}
+
+int unet_tdma_next_slot(unet_tdma_t tdma, long long time, long long *start) {
+  if (tdma == NULL || start == NULL) return -1;
+  _unet_tdma_t *utdma = tdma;
+  pthread_mutex_lock(&utdma->lock);
+  int slot = next_slot(utdma, time, start);
+  pthread_mutex_unlock(&utdma->lock);
+  return slot;
+}
+
+int unet_tdma_send(unet_tdma_t tdma, uint8_t *data, int len, int to, int protocol) {
+  if (tdma == NULL || len < 0 || (len > 0 && data == NULL) || to < 0 || protocol < 0 || protocol > MAX) return -1;
+  _unet_tdma_t *utdma = tdma;
+  dgram_t d = { NULL, len, to, protocol, 0 };
+  if (len > 0) {
+    d.data = malloc((size_t)len);
+    if (d.data == NULL) return -1;
+    memcpy(d.data, data, (size_t)len);
+  }
+  int rv = -1;
+  pthread_mutex_lock(&utdma->lock);
+  if (utdma->count < TDMA_QUEUE) {
+    utdma->queue[(utdma->head + utdma->count++) % TDMA_QUEUE] = d;
+    rv = 0;
+  }
+  pthread_mutex_unlock(&utdma->lock);
+  if (rv < 0) free(d.data);
+  return rv;
+}
+
+// count the transmissions the modem has confirmed, and give up on those
+// still unconfirmed well after the end of their slot
+static void confirm(_unet_tdma_t *tdma, long long now) {
+  pthread_mutex_lock(&tdma->lock);
+  for (int i = 0; i < tdma->npending; i++) {
+    pending_t *p = &tdma->pending[i];
+    fjage_msg_t ntf = fjage_receive(tdma->gw, "org.arl.unet.phy.TxFrameNtf", p->id, 0);
+    if (ntf != NULL) {
+      tdma->stats.confirmed++;
+      tdma->stats.txtime = unet_msg_get_time(ntf, "txTime", 0);
+      fjage_msg_destroy(ntf);
+    } else if (now > p->end) tdma->stats.unconfirmed++;
+    else continue;
+    memmove(p, p + 1, (size_t)(tdma->npending - i - 1) * sizeof(pending_t));
+    tdma->npending--;
+    i--;
+  }
+  pthread_mutex_unlock(&tdma->lock);
+}
+
+static void *scheduler(void *arg) {
+  _unet_tdma_t *tdma = arg;
+  long long lead = (long long)TDMA_LEAD * 1000;
+  while (!tdma->quit) {
+    long long now, start;
+    if (unet_clock_now(tdma->clk, &now) < 0) {
+      Sleep(TDMA_POLL);
+      continue;
+    }
+    confirm(tdma, now);
+    // a slot is taken once less than the lead away, and while at least half of it remains
+    long long from = now + lead / 2 > tdma->last + 1 ? now + lead / 2 : tdma->last + 1;
+    pthread_mutex_lock(&tdma->lock);
+    int slot = tdma->count > 0 ? next_slot(tdma, from, &start) : -1;
+    long long wait = slot >= 0 ? start - lead - now : (long long)TDMA_POLL * 1000;
+    if (wait > 0) {
+      pthread_mutex_unlock(&tdma->lock);
+      Sleep((unsigned)(wait < TDMA_POLL * 1000 ? wait / 1000 + 1 : TDMA_POLL));
+      continue;
+    }
+    dgram_t d = tdma->queue[tdma->head];
+    tdma->head = (tdma->head + 1) % TDMA_QUEUE;
+    tdma->count--;
+    pthread_mutex_unlock(&tdma->lock);
+    char id[FRAME_ID_LEN];
+    int rv = unetsocket_ext_send_at(tdma->sock, d.data, d.len, d.to, d.protocol, TXTIME_DATA, start, id);
+    tdma->last = start;
+    pthread_mutex_lock(&tdma->lock);
+    if (rv == 0) {
+      free(d.data);
+      tdma->stats.sent++;
+      // forget the oldest unconfirmed transmission if there are too many
+      if (tdma->npending == TDMA_QUEUE) memmove(tdma->pending, tdma->pending + 1, (size_t)(--tdma->npending) * sizeof(pending_t));
+      pending_t *p = &tdma->pending[tdma->npending++];
+      strcpy(p->id, id);
+      p->end = start + tdma->slotlen + lead;
+    } else {
+      tdma->stats.refused++;
+      // try again in the next owned slot, ahead of the rest of the queue
+      if (++d.tries < TDMA_RETRIES && tdma->count < TDMA_QUEUE) {
+        tdma->head = (tdma->head + TDMA_QUEUE - 1) % TDMA_QUEUE;
+        tdma->queue[tdma->head] = d;
+        tdma->count++;
+      } else {
+        free(d.data);
+        tdma->stats.failed++;
+      }
+    }
+    pthread_mutex_unlock(&tdma->lock);
+  }
+  return NULL;
+}
+
+int unet_tdma_start(unet_tdma_t tdma) {
+  if (tdma == NULL) return -1;
+  _unet_tdma_t *utdma = tdma;
+  if (utdma->running) return -1;
+  utdma->quit = false;
+  if (pthread_create(&utdma->tid, NULL, scheduler, utdma) != 0) return -1;
+  utdma->running = true;
+  return 0;
+}
+
+void unet_tdma_stop(unet_tdma_t tdma) {
+  if (tdma == NULL) return;
+  _unet_tdma_t *utdma = tdma;
+  if (!utdma->running) return;
+  utdma->quit = true;
+  pthread_join(utdma->tid, NULL);
+  utdma->running = false;
+}
+
+int unet_tdma_get_stats(unet_tdma_t tdma, unet_tdma_stats_t *stats) {
+  if (tdma == NULL || stats == NULL) return -1;
+  _unet_tdma_t *utdma = tdma;
+  pthread_mutex_lock(&utdma->lock);
+  *stats = utdma->stats;
+  stats->queued = utdma->count;
+  pthread_mutex_unlock(&utdma->lock);
+  return 0;
+}
@@ -0,0 +1,123 @@
+#ifndef _UNETTDMA_H_
+#define _UNETTDMA_H_
+
+#include "unet.h"
+#include "unet_clock.h"
+
+typedef void *unet_tdma_t;         ///< TDMA slot scheduler
+
+/// Transmission counts of a slot scheduler
+
+typedef struct {
+  int queued;                      ///< datagrams waiting for a slot
+  unsigned long sent;              ///< datagrams scheduled for transmission in a slot
+  unsigned long confirmed;         ///< transmissions confirmed by a TxFrameNtf
+  unsigned long unconfirmed;       ///< transmissions with no TxFrameNtf within TDMA_LEAD ms of the end of their slot
+  unsigned long refused;           ///< transmissions refused by the modem
+  unsigned long failed;            ///< datagrams dropped after being refused TDMA_RETRIES times
+  long long txtime;                ///< modem time of the start of the last confirmed transmission (us), 0 if none
+} unet_tdma_stats_t;
+
+/// Largest number of datagrams waiting for a slot
+
+#define TDMA_QUEUE               64
+
+/// Time by which a transmission is scheduled ahead of its slot, at most, and
+/// twice the least (ms)
+
+#define TDMA_LEAD                300
+
+/// Number of slots in which a datagram is tried before it is dropped, if the
+/// modem refuses to transmit it
+
+#define TDMA_RETRIES             3
+
+/// Longest sleep of the scheduler thread, which bounds how long stopping takes (ms)
+
+#define TDMA_POLL                100
+
+/// Create a TDMA slot scheduler. Time is divided into frames of nslots slots
+/// of slotlen each, counted from an epoch in modem time, and the scheduler
+/// transmits queued datagrams one per owned slot, at the start of the slot,
+/// with unetsocket_ext_send_at() (unet_txtime.h). Transmissions are scheduled
+/// up to TDMA_LEAD ms ahead from the modem time estimated by a clock synchronizer,
+/// so the slot boundaries are kept by the modem and not the host. A datagram
+/// that the modem refuses goes back to the head of the queue for the next
+/// owned slot, up to TDMA_RETRIES times. Nodes that
+/// share a channel must agree on the epoch in a common timebase, such as
+/// modem clocks disciplined by GPS, and each slot must be longer than a frame
+/// plus the largest propagation delay.
+///
+/// @param sock             Unet socket
+/// @param clk              Synchronized modem clock (unet_clock.h), which
+///                         should be resynchronized from time to time
+/// @param nslots           Number of slots per frame
+/// @param slotlen          Slot duration (us)
+/// @param epoch            Modem time of the start of a frame (us)
+/// @return                 Slot scheduler, or NULL on error
+
+unet_tdma_t unet_tdma_create(unetsocket_t sock, unet_clock_t clk, int nslots, long long slotlen, long long epoch);
+
+/// Destroy a slot scheduler, stopping it if running. Queued datagrams are
+/// discarded.
+///
+/// @param tdma             Slot scheduler
+
+void unet_tdma_destroy(unet_tdma_t tdma);
+
+/// Take or release ownership of a slot.
+///
+/// @param tdma             Slot scheduler
+/// @param slot             Slot index within a frame
+/// @param owned            true to transmit in the slot, false not to
+/// @return                 0 on success, -1 otherwise
+
+int unet_tdma_set_slot(unet_tdma_t tdma, int slot, bool owned);
+
+/// Get the start of the next owned slot.
+///
+/// @param tdma             Slot scheduler
+/// @param time             Modem time from which to search (us)
+/// @param start            Modem time of the start of the first owned slot
+///                         starting at or after time (us)
+/// @return                 Index of the slot within its frame, -1 if no slot is owned
+
+int unet_tdma_next_slot(unet_tdma_t tdma, long long time, long long *start);
+
+/// Queue a datagram for transmission in the next free owned slot. The
+/// datagram is sent as a single frame on the data channel, so it must fit in
+/// one. This function may be called from any thread.
+///
+/// @param tdma             Slot scheduler
+/// @param data             Datagram payload, copied
+/// @param len              Length of the payload
+/// @param to               Destination node address, 0 for broadcast
+/// @param protocol         Protocol number
+/// @return                 0 on success, -1 if the queue is full or on error
+
+int unet_tdma_send(unet_tdma_t tdma, uint8_t *data, int len, int to, int protocol);
+
+/// Start releasing queued datagrams in owned slots, in a thread of the
+/// scheduler's own.
+///
+/// @param tdma             Slot scheduler
+/// @return                 0 on success, -1 otherwise
+
+int unet_tdma_start(unet_tdma_t tdma);
+
+/// Stop releasing datagrams. Datagrams already scheduled are still transmitted
+/// by the modem, and the rest stay queued.
+///
+/// @param tdma             Slot scheduler
+
+void unet_tdma_stop(unet_tdma_t tdma);
+
+/// Get the transmission counts of a slot scheduler.
+///
+/// @param tdma             Slot scheduler
+/// @param stats            Transmission counts
+/// @return                 0 on success, -1 otherwise
+
+int unet_tdma_get_stats(unet_tdma_t tdma, unet_tdma_stats_t *stats);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _UNETTIME_H_
+#define _UNETTIME_H_
+
+// Host and modem times.
+//
+// Modem times in messages are in microseconds and outgrow a 32-bit long after
+// about 35.8 minutes of modem uptime, but the gateway only has long
+// accessors, and long is 32 bits on Windows. Times that do not fit are
+// written as decimal strings, which the modem parses like numbers, and are
+// read as text where the gateway allows it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "fjage.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Monotonic host time (us), unaffected by steps of the wall clock
+static inline long long unet_host_time(void) {
+#ifdef _WIN32
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return c.QuadPart / f.QuadPart * 1000000 + c.QuadPart % f.QuadPart * 1000000 / f.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+// Monotonic host time (ms)
+static inline long long unet_host_time_ms(void) {
+  return unet_host_time() / 1000;
+}
+
+static inline void unet_msg_add_time(fjage_msg_t msg, const char *key, long long t) {
+  if (t >= LONG_MIN && t <= LONG_MAX) {
+    fjage_msg_add_long(msg, key, (long)t);
+    return;
+  }
+  char s[24];
+  snprintf(s, sizeof(s), "%lld", t);
+  fjage_msg_add_string(msg, key, s);
+}
+
+// The time, or defval if it is missing or does not fit in the long the
+// gateway parsed it into.
+static inline long long unet_msg_get_time(fjage_msg_t msg, const char *key, long long defval) {
+  const char *s = fjage_msg_get_string(msg, key);
+  if (s != NULL) {
+    char *end;
+    long long t = strtoll(s, &end, 10);
+    return end != s && *end == 0 ? t : defval;
+  }
+  long t = fjage_msg_get_long(msg, key, LONG_MIN);
+  if (t == LONG_MIN || (sizeof(long) < sizeof(long long) && t == LONG_MAX)) return defval;
+  return t;
+}
+
+#endif
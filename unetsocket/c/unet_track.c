@@ -0,0 +1,192 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "unet_track.h"
+#include <math.h>
+#include <string.h>
+
+// Constant-velocity Kalman filter of one coordinate
+typedef struct {
+  bool valid;
+  long long time;
+  int miss;
+  double x[2];                     // value, rate
+  double p[3];                     // covariance: value, value-rate, rate
+} kf_t;
+
+typedef struct {
+  int node;
+  kf_t range;
+  kf_t pos[3];
+} track_t;
+
+typedef struct {
+  int maxnodes;
+  int ntracks;
+  double accel;
+  track_t *tracks;
+} _unet_track_t;
+
+unet_track_t unet_track_create(int maxnodes, float accel) {
+  if (maxnodes < 1 || accel < 0) return NULL;
+  _unet_track_t *trk = calloc(1, sizeof(_unet_track_t));
+  if (trk == NULL) return NULL;
+  trk->tracks = calloc((size_t)maxnodes, sizeof(track_t));
+  if (trk->tracks == NULL) {
+    free(trk);
+    return NULL;
+  }
+  trk->maxnodes = maxnodes;
+  trk->accel = accel > 0 ? accel : TRACK_ACCEL;
+  return trk;
+}
+
+void unet_track_destroy(unet_track_t trk) {
+  if (trk == NULL) return;
+  _unet_track_t *utrk = trk;
+  free(utrk->tracks);
+  free(utrk);
+}
+
+static track_t *find(_unet_track_t *trk, int node, bool create) {
+  for (int i = 0; i < trk->ntracks; i++) if (trk->tracks[i].node == node) return trk->tracks + i;
+  if (!create || trk->ntracks >= trk->maxnodes) return NULL;
+  track_t *t = trk->tracks + trk->ntracks++;
+  memset(t, 0, sizeof(track_t));
+  t->node = node;
+  return t;
+}
+
+// Predict the state dt seconds ahead (or back), with unmodelled acceleration
+// held constant over the interval.
+static void predict(const kf_t *kf, double dt, double accel, double *x, double *p) {
+  double q = accel * accel;
+  x[0] = kf->x[0] + dt * kf->x[1];
+  x[1] = kf->x[1];
+  p[0] = kf->p[0] + 2 * dt * kf->p[1] + dt * dt * kf->p[2] + q * dt * dt * dt * dt / 4;
+  p[1] = kf->p[1] + dt * kf->p[2] + q * dt * dt * dt / 2;
+  p[2] = kf->p[2] + q * dt * dt;
+}
+
+static void restart(kf_t *kf, long long time, double z, double r) {
+  kf->valid = true;
+  kf->time = time;
+  kf->miss = 0;
+  kf->x[0] = z;
+  kf->x[1] = 0;
+  kf->p[0] = r;
+  kf->p[1] = 0;
+  kf->p[2] = TRACK_SPEED * TRACK_SPEED;
+}
+
+// Innovation test of a measurement z with variance r, leaving the predicted
+// state in x and p.
+static bool gate(const kf_t *kf, long long time, double z, double r, double accel, double *x, double *p) {
+  predict(kf, (double)(time - kf->time) / 1e6, accel, x, p);
+  double y = z - x[0];
+  return y * y <= TRACK_GATE * TRACK_GATE * (p[0] + r);
+}
+
+static void update(kf_t *kf, long long time, double z, double r, const double *x, const double *p) {
+  double s = p[0] + r;
+  double k0 = p[0] / s;
+  double k1 = p[1] / s;
+  double y = z - x[0];
+  kf->time = time;
+  kf->miss = 0;
+  kf->x[0] = x[0] + k0 * y;
+  kf->x[1] = x[1] + k1 * y;
+  kf->p[0] = p[0] - k0 * p[0];
+  kf->p[1] = p[1] - k0 * p[1];
+  kf->p[2] = p[2] - k1 * p[1];
+}
+
+int unet_track_range(unet_track_t trk, int node, long long time, float range, float sigma) {
+  if (trk == NULL || !(sigma > 0) || !(range >= 0)) return -1;
+  _unet_track_t *utrk = trk;
+  track_t *t = find(utrk, node, true);
+  if (t == NULL) return -1;
+  kf_t *kf = &t->range;
+  double r = (double)sigma * sigma;
+  if (!kf->valid) {
+    restart(kf, time, range, r);
+    return 0;
+  }
+  if (time < kf->time) return 1;
+  double x[2], p[3];
+  if (!gate(kf, time, range, r, utrk->accel, x, p)) {
+    if (++kf->miss < TRACK_MAXMISS) return 1;
+    restart(kf, time, range, r);
+    return 0;
+  }
+  update(kf, time, range, r, x, p);
+  return 0;
+}
+
+int unet_track_position(unet_track_t trk, int node, long long time, const float *pos, float sigma) {
+  if (trk == NULL || pos == NULL || !(sigma > 0)) return -1;
+  _unet_track_t *utrk = trk;
+  track_t *t = find(utrk, node, true);
+  if (t == NULL) return -1;
+  double r = (double)sigma * sigma;
+  if (!t->pos[0].valid) {
+    for (int k = 0; k < 3; k++) restart(t->pos + k, time, pos[k], r);
+    return 0;
+  }
+  if (time < t->pos[0].time) return 1;
+  double x[3][2], p[3][3];
+  bool pass = true;
+  for (int k = 0; k < 3; k++) if (!gate(t->pos + k, time, pos[k], r, utrk->accel, x[k], p[k])) pass = false;
+  if (!pass) {
+    if (++t->pos[0].miss < TRACK_MAXMISS) return 1;
+    for (int k = 0; k < 3; k++) restart(t->pos + k, time, pos[k], r);
+    return 0;
+  }
+  for (int k = 0; k < 3; k++) update(t->pos + k, time, pos[k], r, x[k], p[k]);
+  return 0;
+}
+
+int unet_track_predict_range(unet_track_t trk, int node, long long time, float *range, float *rate, float *sigma) {
+  if (trk == NULL || range == NULL) return -1;
+  _unet_track_t *utrk = trk;
+  track_t *t = find(utrk, node, false);
+  if (t == NULL || !t->range.valid) return -1;
+  double x[2], p[3];
+  predict(&t->range, (double)(time - t->range.time) / 1e6, utrk->accel, x, p);
+  *range = (float)x[0];
+  if (rate != NULL) *rate = (float)x[1];
+  if (sigma != NULL) *sigma = (float)sqrt(p[0]);
+  return 0;
+}
+
+int unet_track_predict_position(unet_track_t trk, int node, long long time, float *pos, float *vel, float *sigma) {
+  if (trk == NULL || pos == NULL) return -1;
+  _unet_track_t *utrk = trk;
+  track_t *t = find(utrk, node, false);
+  if (t == NULL || !t->pos[0].valid) return -1;
+  double var = 0;
+  for (int k = 0; k < 3; k++) {
+    double x[2], p[3];
+    predict(t->pos + k, (double)(time - t->pos[k].time) / 1e6, utrk->accel, x, p);
+    pos[k] = (float)x[0];
+    if (vel != NULL) vel[k] = (float)x[1];
+    var += p[0];
+  }
+  if (sigma != NULL) *sigma = (float)sqrt(var);
+  return 0;
+}
+
+int unet_track_need_range(unet_track_t trk, int node, long long time, float tolerance) {
+  if (trk == NULL) return -1;
+  float range, sigma;
+  if (unet_track_predict_range(trk, node, time, &range, NULL, &sigma) < 0) return 1;
+  return sigma > tolerance ? 1 : 0;
+}
+
+int unet_track_remove(unet_track_t trk, int node) {
+  if (trk == NULL) return -1;
+  _unet_track_t *utrk = trk;
+  track_t *t = find(utrk, node, false);
+  if (t == NULL) return -1;
+  *t = utrk->tracks[--utrk->ntracks];
+  return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef _UNETTRACK_H_
+#define _UNETTRACK_H_
+
+#include "unet.h"
+
+typedef void *unet_track_t;        ///< node tracker
+
+/// Default standard deviation of unmodelled acceleration (m/s^2)
+
+#define TRACK_ACCEL              0.05f
+
+/// Standard deviation of the velocity of a node before it is tracked (m/s)
+
+#define TRACK_SPEED              5.0f
+
+/// Innovation, in standard deviations, beyond which an update is rejected
+
+#define TRACK_GATE               4.0f
+
+/// Number of consecutive rejected updates after which a track is restarted
+
+#define TRACK_MAXMISS            3
+
+/// Create a tracker for the ranges and positions of a set of nodes. Each
+/// node's range, and each coordinate of its position, is tracked by a
+/// constant-velocity Kalman filter updated incrementally as measurements come
+/// in, so consumers share one smoothed estimate instead of each filtering raw
+/// ranges. Updates whose innovation exceeds TRACK_GATE standard deviations are
+/// rejected, and a track is restarted from the measurement after
+/// TRACK_MAXMISS rejections in a row. Times may come from any clock counting
+/// microseconds, such as modem time, as long as it is the same for all calls.
+///
+/// @param maxnodes         Largest number of nodes tracked
+/// @param accel            Standard deviation of unmodelled acceleration of
+///                         the nodes (m/s^2), or 0 for TRACK_ACCEL
+/// @return                 Tracker, or NULL on error
+
+unet_track_t unet_track_create(int maxnodes, float accel);
+
+/// Destroy a tracker.
+///
+/// @param trk              Tracker
+
+void unet_track_destroy(unet_track_t trk);
+
+/// Update the range to a node, such as measured by unetsocket_ext_get_range()
+/// or unet_ranging_range(). Updates older than the node's last range update are
+/// ignored.
+///
+/// @param trk              Tracker
+/// @param node             Node address
+/// @param time             Time of the measurement (us)
+/// @param range            Measured range (m)
+/// @param sigma            Standard deviation of the range error (m)
+/// @return                 0 if applied, 1 if rejected or ignored, -1 on error
+
+int unet_track_range(unet_track_t trk, int node, long long time, float range, float sigma);
+
+/// Update the position of a node, such as solved by unet_locate_solve().
+/// Updates older than the node's last position update are ignored.
+///
+/// @param trk              Tracker
+/// @param node             Node address
+/// @param time             Time of the measurement (us)
+/// @param pos              Measured position (x, y, z, m)
+/// @param sigma            Standard deviation of the error in each coordinate (m)
+/// @return                 0 if applied, 1 if rejected or ignored, -1 on error
+
+int unet_track_position(unet_track_t trk, int node, long long time, const float *pos, float sigma);
+
+/// Predict the range to a node. Predictions may be made for any time,
+/// including before the last update, without changing the track.
+///
+/// @param trk              Tracker
+/// @param node             Node address
+/// @param time             Time of the prediction (us)
+/// @param range            Predicted range (m)
+/// @param rate             Predicted range rate (m/s), or NULL
+/// @param sigma            Standard deviation of the predicted range (m), or NULL
+/// @return                 0 on success, -1 if the node's range is not tracked
+
+int unet_track_predict_range(unet_track_t trk, int node, long long time, float *range, float *rate, float *sigma);
+
+/// Predict the position of a node. Predictions may be made for any time
+/// without changing the track.
+///
+/// @param trk              Tracker
+/// @param node             Node address
+/// @param time             Time of the prediction (us)
+/// @param pos              Predicted position (x, y, z, m)
+/// @param vel              Predicted velocity (x, y, z, m/s), or NULL
+/// @param sigma            Standard deviation of the predicted distance from
+///                         the true position (m), or NULL
+/// @return                 0 on success, -1 if the node's position is not tracked
+
+int unet_track_predict_position(unet_track_t trk, int node, long long time, float *pos, float *vel, float *sigma);
+
+/// Check whether a node should be ranged, because its range is not tracked or
+/// its predicted range is less certain than required. Ranging only the nodes
+/// for which this returns 1 saves the airtime of ranging rounds whose result
+/// is already known well enough.
+///
+/// @param trk              Tracker
+/// @param node             Node address
+/// @param time             Time at which the range is needed (us)
+/// @param tolerance        Largest acceptable standard deviation of the range (m)
+/// @return                 1 if the node should be ranged, 0 if not, -1 on error
+
+int unet_track_need_range(unet_track_t trk, int node, long long time, float tolerance);
+
+/// Stop tracking a node.
+///
+/// @param trk              Tracker
+/// @param node             Node address
+/// @return                 0 on success, -1 if the node is not tracked
+
+int unet_track_remove(unet_track_t trk, int node);
+
+#endif
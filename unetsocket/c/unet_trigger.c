@@ -0,0 +1,232 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_trigger.h"
+#include "unet_time.h"
+#include "pthreadwindows.h"
+#include <string.h>
+#include <math.h>
+
+#define TRIGGER_CHUNK            PBSBLK   // samples added to the history at a time
+
+typedef struct {
+  float pre;
+  float post;
+  unet_block_sink_t sink;
+  void *ctx;
+  float fs;
+  long long npre;
+  long long npost;
+  float *hist;                       // history ring of cap samples
+  long long cap;
+  long long end;                     // index of the next sample
+  long long refidx;                  // index and modem time of the latest block
+  long long reftime;
+  float *clip;
+  unsigned long long nclips;
+  pthread_mutex_t lock;              // protects fired and nfired
+  long long fired[TRIGGER_MAX_PENDING];
+  int nfired;
+  long long pending[TRIGGER_MAX_PENDING];
+  int npending;
+  float threshold;
+  float sta;
+  float lta;
+  double asta;
+  double alta;
+  double psta;
+  double plta;
+  long long warmup;                  // index from which the detector may fire
+  long long holdoff;                 // index until which the detector is held off
+} _unet_trigger_t;
+
+typedef struct {
+  _unet_trigger_t *trig;
+  fjage_gw_t gw;
+  bool frames;
+} _pbtrigger_t;
+
+unet_trigger_t unet_trigger_create(float pre, float post, unet_block_sink_t sink, void *ctx) {
+  if (pre < 0 || post < 0 || sink == NULL) return NULL;
+  _unet_trigger_t *trig = calloc(1, sizeof(_unet_trigger_t));
+  if (trig == NULL) return NULL;
+  trig->pre = pre;
+  trig->post = post;
+  trig->sink = sink;
+  trig->ctx = ctx;
+  pthread_mutex_init(&trig->lock, NULL);
+  return trig;
+}
+
+void unet_trigger_destroy(unet_trigger_t trig) {
+  if (trig == NULL) return;
+  _unet_trigger_t *utrig = trig;
+  pthread_mutex_destroy(&utrig->lock);
+  free(utrig->hist);
+  free(utrig->clip);
+  free(utrig);
+}
+
+// set detector coefficients once the sampling rate is known
+static void detector_init(_unet_trigger_t *trig) {
+  if (trig->fs <= 0) return;
+  trig->asta = trig->sta > 0 ? fmin(1.0, 1.0 / (trig->sta * trig->fs)) : 1.0;
+  trig->alta = trig->lta > 0 ? fmin(1.0, 1.0 / (trig->lta * trig->fs)) : 1.0;
+  trig->warmup = trig->end + llround((double)trig->lta * trig->fs);
+}
+
+int unet_trigger_set_detector(unet_trigger_t trig, float threshold, float sta, float lta) {
+  if (trig == NULL || threshold < 0 || sta < 0 || lta < sta) return -1;
+  _unet_trigger_t *utrig = trig;
+  utrig->threshold = threshold;
+  utrig->sta = sta;
+  utrig->lta = lta;
+  utrig->psta = 0;
+  utrig->plta = 0;
+  detector_init(utrig);
+  return 0;
+}
+
+int unet_trigger_fire(unet_trigger_t trig, long long time) {
+  if (trig == NULL) return -1;
+  _unet_trigger_t *utrig = trig;
+  int rv = -1;
+  pthread_mutex_lock(&utrig->lock);
+  if (utrig->nfired < TRIGGER_MAX_PENDING) {
+    utrig->fired[utrig->nfired++] = time;
+    rv = 0;
+  }
+  pthread_mutex_unlock(&utrig->lock);
+  return rv;
+}
+
+static void add_pending(_unet_trigger_t *trig, long long index) {
+  if (trig->npending < TRIGGER_MAX_PENDING) trig->pending[trig->npending++] = index;
+}
+
+// allocate the history once the sampling rate is known, with room for a full
+// pre- and post-trigger window behind the newest chunk
+static int init(_unet_trigger_t *trig, float fs) {
+  trig->fs = fs;
+  trig->npre = llround((double)trig->pre * fs);
+  trig->npost = llround((double)trig->post * fs);
+  trig->cap = trig->npre + trig->npost + TRIGGER_CHUNK;
+  trig->hist = calloc((size_t)trig->cap, sizeof(float));
+  trig->clip = malloc(sizeof(float) * (size_t)(trig->npre + trig->npost + 1));
+  if (trig->hist == NULL || trig->clip == NULL) return -1;
+  detector_init(trig);
+  return 0;
+}
+
+// append n samples (zeros if buf is NULL) to the history
+static void append(_unet_trigger_t *trig, const float *buf, long long n) {
+  for (long long i = 0; i < n; i++) {
+    long long index = trig->end + i;
+    float x = buf == NULL ? 0.0f : buf[i];
+    trig->hist[index % trig->cap] = x;
+    if (buf == NULL || trig->threshold <= 0) continue;
+    double p = (double)x * x;
+    trig->psta += trig->asta * (p - trig->psta);
+    trig->plta += trig->alta * (p - trig->plta);
+    if (index >= trig->warmup && index >= trig->holdoff && trig->psta > trig->threshold * trig->plta) {
+      add_pending(trig, index);
+      trig->holdoff = index + trig->npost;
+    }
+  }
+  trig->end += n;
+}
+
+// convert triggers fired through the API into sample indices
+static void collect(_unet_trigger_t *trig) {
+  pthread_mutex_lock(&trig->lock);
+  for (int i = 0; i < trig->nfired; i++) {
+    long long t = trig->fired[i];
+    if (t == 0) add_pending(trig, trig->end - 1);
+    else add_pending(trig, trig->refidx + llround((double)(t - trig->reftime) * trig->fs / 1e6));
+  }
+  trig->nfired = 0;
+  pthread_mutex_unlock(&trig->lock);
+}
+
+// emit the clips whose post-trigger window is complete
+static int emit(_unet_trigger_t *trig) {
+  int i = 0;
+  while (i < trig->npending) {
+    long long index = trig->pending[i];
+    if (index + trig->npost > trig->end) {
+      i++;
+      continue;
+    }
+    trig->pending[i] = trig->pending[--trig->npending];
+    long long start = index - trig->npre;
+    if (start < trig->end - trig->cap) start = trig->end - trig->cap;
+    if (start < 0) start = 0;
+    long long n = index + trig->npost - start;
+    if (n <= 0) continue;
+    for (long long j = 0; j < n; j++) trig->clip[j] = trig->hist[(start + j) % trig->cap];
+    unet_block_t clip;
+    clip.signal = trig->clip;
+    clip.nsamples = (int)n;
+    clip.fs = trig->fs;
+    clip.fc = 0;
+    clip.rxtime = trig->reftime + llround((double)(start - trig->refidx) * 1e6 / trig->fs);
+    clip.seq = trig->nclips++;
+    clip.gap = 0;
+    int rv = trig->sink(trig->ctx, &clip);
+    if (rv != 0) return rv;
+  }
+  return 0;
+}
+
+int unet_trigger_block(void *ctx, const unet_block_t *blk) {
+  _unet_trigger_t *trig = ctx;
+  if (trig == NULL || blk == NULL) return 1;
+  if (trig->hist == NULL && (blk->fs <= 0 || init(trig, blk->fs) < 0)) return 1;
+  long long gap = blk->gap > 0 ? blk->gap : 0;
+  while (gap > 0) {
+    long long n = gap < TRIGGER_CHUNK ? gap : TRIGGER_CHUNK;
+    append(trig, NULL, n);
+    gap -= n;
+    int rv = emit(trig);
+    if (rv != 0) return rv;
+  }
+  trig->refidx = trig->end;
+  trig->reftime = blk->rxtime;
+  for (long long i = 0; i < blk->nsamples; i += TRIGGER_CHUNK) {
+    long long n = blk->nsamples - i < TRIGGER_CHUNK ? blk->nsamples - i : TRIGGER_CHUNK;
+    append(trig, blk->signal + i, n);
+    collect(trig);
+    int rv = emit(trig);
+    if (rv != 0) return rv;
+  }
+  return 0;
+}
+
+static int pbtrigger_block(void *ctx, const unet_block_t *blk) {
+  _pbtrigger_t *p = ctx;
+  if (p->frames) {
+    fjage_msg_t ntf;
+    while ((ntf = fjage_receive(p->gw, "org.arl.unet.phy.RxFrameNtf", NULL, 0)) != NULL) {
+      long long rxtime = unet_msg_get_time(ntf, "rxTime", 0);
+      fjage_msg_destroy(ntf);
+      if (rxtime > 0) unet_trigger_fire(p->trig, rxtime);
+    }
+  }
+  return unet_trigger_block(p->trig, blk);
+}
+
+int unetsocket_ext_pbtrigger(unetsocket_t sock, int blksize, unet_trigger_t trig, bool frames) {
+  if (sock == NULL || trig == NULL) return -1;
+  _pbtrigger_t p;
+  p.trig = trig;
+  p.gw = unetsocket_get_gateway(sock);
+  p.frames = frames;
+  if (frames) {
+    fjage_aid_t phy = fjage_agent_for_service(p.gw, "org.arl.unet.Services.PHYSICAL");
+    if (phy == NULL) return -1;
+    fjage_subscribe_agent(p.gw, phy);
+    fjage_aid_destroy(phy);
+  }
+  return unetsocket_ext_pbstream(sock, blksize, pbtrigger_block, &p);
+}
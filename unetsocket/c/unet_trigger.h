@@ -0,0 +1,80 @@
+#ifndef _UNETTRIGGER_H_
+#define _UNETTRIGGER_H_
+
+#include "unet_stream.h"
+
+typedef void *unet_trigger_t;      ///< triggered recorder
+
+/// Largest number of triggers waiting for their post-trigger window
+
+#define TRIGGER_MAX_PENDING      16
+
+/// Create a triggered recorder. The recorder is fed a continuous passband
+/// signal and keeps a history of the most recent samples. When a trigger
+/// fires, it emits a clip from pre seconds before to post seconds after the
+/// trigger time, as soon as the post-trigger samples have arrived.
+///
+/// Clips are passed to the sink as signal blocks: rxtime is the time of the
+/// first sample of the clip and seq is the clip number. A clip is shorter
+/// than requested if part of its pre-trigger window is no longer in the
+/// history. The sink's return value is passed back to the signal source, so
+/// a non-zero value stops recording.
+///
+/// @param pre              Pre-trigger window (s)
+/// @param post             Post-trigger window (s)
+/// @param sink             Clip sink
+/// @param ctx              User context passed to the sink
+/// @return                 Triggered recorder, or NULL on error
+
+unet_trigger_t unet_trigger_create(float pre, float post, unet_block_sink_t sink, void *ctx);
+
+/// Destroy a triggered recorder. Pending clips are discarded.
+///
+/// @param trig             Triggered recorder
+
+void unet_trigger_destroy(unet_trigger_t trig);
+
+/// Configure the energy detector. The detector fires when the ratio of the
+/// short-term to the long-term average signal power exceeds the threshold,
+/// and is then held off until the end of the post-trigger window.
+///
+/// @param trig             Triggered recorder
+/// @param threshold        Power ratio to trigger at, 0 to disable the detector
+/// @param sta              Short-term averaging time (s)
+/// @param lta              Long-term averaging time (s)
+/// @return                 0 on success, -1 otherwise
+
+int unet_trigger_set_detector(unet_trigger_t trig, float threshold, float sta, float lta);
+
+/// Fire a trigger. The trigger time may be in the past, such as the rxTime of
+/// a received frame, or in the future, such as the txTime of a scheduled
+/// transmission. This function may be called from any thread.
+///
+/// @param trig             Triggered recorder
+/// @param time             Trigger time in modem time (us), 0 for the time of
+///                         the latest sample received
+/// @return                 0 on success, -1 if too many triggers are pending
+
+int unet_trigger_fire(unet_trigger_t trig, long long time);
+
+/// Block sink that feeds a signal block to a triggered recorder, for use with
+/// unetsocket_ext_pbstream().
+///
+/// @param ctx              Triggered recorder
+/// @param blk              Signal block
+/// @return                 0 to continue, non-zero if the clip sink asked to stop
+
+int unet_trigger_block(void *ctx, const unet_block_t *blk);
+
+/// Continuously record passband signal blocks into a triggered recorder, until
+/// the clip sink asks to stop.
+///
+/// @param sock             Unet socket
+/// @param blksize          Samples per block, 0 for PBSBLK
+/// @param trig             Triggered recorder
+/// @param frames           Fire a trigger at the rxTime of every received frame
+/// @return                 0 when stopped by the clip sink, -1 on error
+
+int unetsocket_ext_pbtrigger(unetsocket_t sock, int blksize, unet_trigger_t trig, bool frames);
+
+#endif
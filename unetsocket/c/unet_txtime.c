@@ -0,0 +1,74 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_txtime.h"
+#include "unet_time.h"
+#include <stdio.h>
+#include <string.h>
+
+// Subscribe to an agent's topic unless already subscribed, so that requests
+// made over and over do not pile up subscriptions on the gateway.
+static void subscribe(fjage_gw_t gw, fjage_aid_t aid) {
+  // the topic is named as fjage_subscribe_agent() names it
+  size_t len = strlen(aid) + 6;
+  char *name = malloc(len);
+  if (name == NULL) return;
+  snprintf(name, len, "%s__ntf", aid);
+  fjage_aid_t topic = fjage_aid_topic(name);
+  free(name);
+  if (topic == NULL) return;
+  if (!fjage_is_subscribed(gw, topic)) fjage_subscribe(gw, topic);
+  fjage_aid_destroy(topic);
+}
+
+// Send a request to the agent providing a service, subscribing to the agent's
+// topic for the TxFrameNtf that confirms the transmission.
+static int schedule(unetsocket_t sock, const char *service, fjage_msg_t msg, char *id) {
+  fjage_gw_t gw = unetsocket_get_gateway(sock);
+  fjage_aid_t aid = fjage_agent_for_service(gw, service);
+  if (aid == NULL) {
+    fjage_msg_destroy(msg);
+    return -1;
+  }
+  subscribe(gw, aid);
+  fjage_msg_set_recipient(msg, aid);
+  if (id != NULL) strcpy(id, fjage_msg_get_id(msg));
+  msg = fjage_request(gw, msg, 5 * TIMEOUT);
+  int rv = msg != NULL && fjage_msg_get_performative(msg) == FJAGE_AGREE ? 0 : -1;
+  fjage_msg_destroy(msg);
+  fjage_aid_destroy(aid);
+  return rv;
+}
+
+int unetsocket_ext_tx_signal_at(unetsocket_t sock, float *signal, int nsamples, float fc, long long txtime, char *id) {
+  if (sock == NULL || signal == NULL || nsamples < 1 || txtime <= 0) return -1;
+  bool complex = fc > 0;
+  fjage_msg_t msg = fjage_msg_create("org.arl.unet.bb.TxBasebandSignalReq", FJAGE_REQUEST);
+  fjage_msg_add_float(msg, "fc", fc);
+  fjage_msg_add_bool(msg, "signal__isComplex", complex);
+  fjage_msg_add_float_array(msg, "signal", signal, (complex ? 2 : 1) * nsamples);
+  unet_msg_add_time(msg, "txTime", txtime);
+  return schedule(sock, "org.arl.unet.Services.BASEBAND", msg, id);
+}
+
+int unetsocket_ext_send_at(unetsocket_t sock, uint8_t *data, int len, int to, int protocol, int type, long long txtime, char *id) {
+  if (sock == NULL || len < 0 || (len > 0 && data == NULL) || to < 0 || protocol < 0 || protocol > MAX) return -1;
+  if ((type != TXTIME_CONTROL && type != TXTIME_DATA) || txtime <= 0) return -1;
+  fjage_msg_t msg = fjage_msg_create("org.arl.unet.phy.TxFrameReq", FJAGE_REQUEST);
+  fjage_msg_add_int(msg, "type", type);
+  fjage_msg_add_int(msg, "to", to);
+  fjage_msg_add_int(msg, "protocol", protocol);
+  if (len > 0) fjage_msg_add_byte_array(msg, "data", data, len);
+  unet_msg_add_time(msg, "txTime", txtime);
+  return schedule(sock, "org.arl.unet.Services.PHYSICAL", msg, id);
+}
+
+int unetsocket_ext_wait_tx(unetsocket_t sock, const char *id, long timeout, long long *txtime) {
+  if (sock == NULL || id == NULL) return -1;
+  fjage_msg_t ntf = fjage_receive(unetsocket_get_gateway(sock), "org.arl.unet.phy.TxFrameNtf", id, timeout);
+  if (ntf == NULL) return -1;
+  if (txtime != NULL) *txtime = unet_msg_get_time(ntf, "txTime", 0);
+  fjage_msg_destroy(ntf);
+  return 0;
+}
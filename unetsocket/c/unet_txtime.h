@@ -0,0 +1,58 @@
+#ifndef _UNETTXTIME_H_
+#define _UNETTXTIME_H_
+
+#include "unet.h"
+
+/// Frame types (physical layer channels)
+
+#define TXTIME_CONTROL           1      ///< control channel
+#define TXTIME_DATA              2      ///< data channel
+
+/// Transmit a signal at an exact modem time. The signal is passed to the modem
+/// in a TxBasebandSignalReq with txTime set, so it is transmitted by the modem
+/// at that time, free of host and network scheduling jitter. A host time may
+/// be converted to modem time with unet_clock_to_modem() (unet_clock.h). The
+/// modem refuses times that are already past, so the request should be made
+/// ahead of time.
+///
+/// @param sock             Unet socket
+/// @param signal           Signal, as for unetsocket_ext_tx_signal()
+/// @param nsamples         Number of samples
+/// @param fc               Signal carrier frequency in Hz, 0 for passband
+/// @param txtime           Modem time of the start of the transmission (us)
+/// @param id               Id of the request, to wait for its transmission
+///                         (FRAME_ID_LEN characters), or NULL
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_tx_signal_at(unetsocket_t sock, float *signal, int nsamples, float fc, long long txtime, char *id);
+
+/// Transmit a frame at an exact modem time. The frame is passed directly to
+/// the physical layer in a TxFrameReq with txTime set, so it must fit in one
+/// frame of the chosen type, and is not retransmitted or acknowledged.
+///
+/// @param sock             Unet socket
+/// @param data             Frame payload
+/// @param len              Length of the payload
+/// @param to               Destination node address, 0 for broadcast
+/// @param protocol         Protocol number
+/// @param type             TXTIME_CONTROL or TXTIME_DATA
+/// @param txtime           Modem time of the start of the transmission (us)
+/// @param id               Id of the request, to wait for its transmission
+///                         (FRAME_ID_LEN characters), or NULL
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_ext_send_at(unetsocket_t sock, uint8_t *data, int len, int to, int protocol, int type, long long txtime, char *id);
+
+/// Wait for the TxFrameNtf confirming a scheduled transmission, and get the
+/// modem time it actually started at.
+///
+/// @param sock             Unet socket
+/// @param id               Id of the request
+/// @param timeout          Timeout (ms), from the call, so it should allow for
+///                         the time until the transmission
+/// @param txtime           Modem time of the start of the transmission (us), or NULL
+/// @return                 0 on success, -1 if not confirmed before the timeout
+
+int unetsocket_ext_wait_tx(unetsocket_t sock, const char *id, long timeout, long long *txtime);
+
+#endif
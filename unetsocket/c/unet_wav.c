@@ -0,0 +1,373 @@
+#define _DEFAULT_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include "unet_wav.h"
+#include "unet_conv.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define WAV_TAG_PCM              0x0001
+#define WAV_TAG_FLOAT            0x0003
+#define WAV_TAG_EXTENSIBLE       0xFFFE
+#define WAV_RIFF_MAX             0xFFFFFFFFULL  // largest size in a RIFF chunk header
+#define WAV_DS64                 28             // ds64 chunk body without a table
+#define WAV_FMT_MAX              40             // extensible fmt chunk body
+#define W64_CHUNK                24             // Wave64 chunk header (GUID and size)
+
+// Wave64 chunk GUIDs: "riff" has its own suffix, the other chunk ids share one
+static const uint8_t W64_RIFF[16] = { 'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00 };
+static const uint8_t W64_SUFFIX[12] = { 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+
+typedef struct {
+  FILE *fp;
+  bool writing;
+  int format;
+  int channels;
+  float fs;
+  int bytes;                         // bytes per sample
+  unsigned long long nframes;        // frames in the file, or written so far
+  unsigned long long pos;            // frames read
+  bool failed;
+  uint8_t *raw;                      // WAV_CHUNK frames in the file format
+  float *frames;                     // WAV_CHUNK frames for the sample source
+  float **chans;
+} _unet_wav_t;
+
+static void put16(uint8_t *p, unsigned int v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, unsigned long v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void put64(uint8_t *p, unsigned long long v) {
+  put32(p, (unsigned long)(v & 0xFFFFFFFFULL));
+  put32(p + 4, (unsigned long)(v >> 32));
+}
+
+static unsigned int get16(const uint8_t *p) {
+  return (unsigned int)p[0] | (unsigned int)p[1] << 8;
+}
+
+static unsigned long get32(const uint8_t *p) {
+  return (unsigned long)p[0] | (unsigned long)p[1] << 8 | (unsigned long)p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+static unsigned long long get64(const uint8_t *p) {
+  return (unsigned long long)get32(p) | (unsigned long long)get32(p + 4) << 32;
+}
+
+int unet_wav_sample_bytes(int format) {
+  if (format == WAV_PCM16) return 2;
+  if (format == WAV_PCM24) return 3;
+  return 4;
+}
+
+void unet_wav_header(uint8_t *hdr, int format, float fs, int channels, unsigned long long nframes) {
+  unsigned int bytes = (unsigned int)unet_wav_sample_bytes(format);
+  unsigned long long datalen = nframes * (unsigned)channels * bytes;
+  unsigned long long riffsize = datalen + WAV_HEADER - 8;
+  bool rf64 = riffsize > WAV_RIFF_MAX;
+  memset(hdr, 0, WAV_HEADER);
+  memcpy(hdr, rf64 ? "RF64" : "RIFF", 4);
+  put32(hdr + 4, rf64 ? (unsigned long)WAV_RIFF_MAX : (unsigned long)riffsize);
+  memcpy(hdr + 8, "WAVE", 4);
+  // the JUNK chunk is the same size as a ds64 chunk, which replaces it in RF64
+  memcpy(hdr + 12, rf64 ? "ds64" : "JUNK", 4);
+  put32(hdr + 16, WAV_DS64);
+  if (rf64) {
+    put64(hdr + 20, riffsize);
+    put64(hdr + 28, datalen);
+    put64(hdr + 36, nframes);
+  }
+  memcpy(hdr + 48, "fmt ", 4);
+  put32(hdr + 52, 16);
+  put16(hdr + 56, format == WAV_FLOAT ? WAV_TAG_FLOAT : WAV_TAG_PCM);
+  put16(hdr + 58, (unsigned int)channels);
+  put32(hdr + 60, (unsigned long)fs);
+  put32(hdr + 64, (unsigned long)fs * (unsigned)channels * bytes);
+  put16(hdr + 68, (unsigned int)channels * bytes);
+  put16(hdr + 70, 8 * bytes);
+  memcpy(hdr + 72, "data", 4);
+  put32(hdr + 76, rf64 ? (unsigned long)WAV_RIFF_MAX : (unsigned long)datalen);
+}
+
+static bool big_endian(void) {
+  const uint16_t one = 1;
+  return *(const uint8_t *)&one == 0;
+}
+
+// reverse the bytes of each sample on a big-endian host, where the conversion
+// routines read and write native 16- and 32-bit words; 24-bit samples are
+// packed byte by byte, so they are little-endian already
+static void swap(uint8_t *p, size_t n, int format) {
+  if (format == WAV_PCM24 || !big_endian()) return;
+  size_t size = format == WAV_PCM16 ? 2 : 4;
+  for (size_t i = 0; i < n; i++, p += size) {
+    for (size_t j = 0; j < size / 2; j++) {
+      uint8_t t = p[j];
+      p[j] = p[size - 1 - j];
+      p[size - 1 - j] = t;
+    }
+  }
+}
+
+void unet_wav_encode(uint8_t *dst, const float *src, size_t n, int format) {
+  if (format == WAV_PCM16) unet_conv_f32_s16((int16_t *)(void *)dst, src, n);
+  else if (format == WAV_PCM24) unet_conv_f32_s24(dst, src, n);
+  else if (format == WAV_PCM32) unet_conv_f32_s32((int32_t *)(void *)dst, src, n);
+  else memcpy(dst, src, n * sizeof(float));
+  swap(dst, n, format);
+}
+
+// decode samples, swapping their bytes in place first if need be
+static void decode(float *dst, uint8_t *src, size_t n, int format) {
+  swap(src, n, format);
+  if (format == WAV_PCM16) unet_conv_s16_f32(dst, (const int16_t *)(const void *)src, n);
+  else if (format == WAV_PCM24) unet_conv_s24_f32(dst, src, n);
+  else if (format == WAV_PCM32) unet_conv_s32_f32(dst, (const int32_t *)(const void *)src, n);
+  else memcpy(dst, src, n * sizeof(float));
+}
+
+static int skip(FILE *fp, unsigned long long n) {
+  if (n > 0x7FFFFFFFULL) return -1;
+  return fseek(fp, (long)n, SEEK_CUR);
+}
+
+// read a fmt chunk body, which may be longer than the part we need
+static int parse_fmt(_unet_wav_t *wav, unsigned long long len) {
+  uint8_t p[WAV_FMT_MAX];
+  size_t n = len < WAV_FMT_MAX ? (size_t)len : WAV_FMT_MAX;
+  if (len < 16 || fread(p, 1, n, wav->fp) != n || skip(wav->fp, len - n) < 0) return -1;
+  unsigned int tag = get16(p);
+  unsigned int bits = get16(p + 14);
+  if (tag == WAV_TAG_EXTENSIBLE && n >= 26) tag = get16(p + 24);
+  wav->channels = (int)get16(p + 2);
+  wav->fs = (float)get32(p + 4);
+  if (tag == WAV_TAG_FLOAT && bits == 32) wav->format = WAV_FLOAT;
+  else if (tag == WAV_TAG_PCM && bits == 16) wav->format = WAV_PCM16;
+  else if (tag == WAV_TAG_PCM && bits == 24) wav->format = WAV_PCM24;
+  else if (tag == WAV_TAG_PCM && bits == 32) wav->format = WAV_PCM32;
+  else return -1;
+  return wav->channels > 0 ? 0 : -1;
+}
+
+// walk RIFF/RF64 chunks up to the start of the samples, returning their length
+static int parse_riff(_unet_wav_t *wav, unsigned long long *datalen) {
+  unsigned long long ds64len = 0;
+  uint8_t hdr[8];
+  while (fread(hdr, 1, 8, wav->fp) == 8) {
+    unsigned long long len = get32(hdr + 4);
+    if (memcmp(hdr, "data", 4) == 0) {
+      *datalen = len == WAV_RIFF_MAX && ds64len > 0 ? ds64len : len;
+      return wav->format > 0 ? 0 : -1;
+    }
+    if (memcmp(hdr, "fmt ", 4) == 0) {
+      if (parse_fmt(wav, len) < 0) return -1;
+    } else if (memcmp(hdr, "ds64", 4) == 0 && len >= WAV_DS64) {
+      uint8_t p[WAV_DS64];
+      if (fread(p, 1, WAV_DS64, wav->fp) != WAV_DS64) return -1;
+      ds64len = get64(p + 8);
+      len -= WAV_DS64;
+      if (skip(wav->fp, len) < 0) return -1;
+    } else if (skip(wav->fp, len) < 0) return -1;
+    // chunks are padded to an even length
+    if ((len & 1) && skip(wav->fp, 1) < 0) return -1;
+  }
+  return -1;
+}
+
+// walk Wave64 chunks, which have GUID ids, 64-bit sizes and 8-byte alignment
+static int parse_w64(_unet_wav_t *wav, unsigned long long *datalen) {
+  uint8_t hdr[W64_CHUNK];
+  while (fread(hdr, 1, W64_CHUNK, wav->fp) == W64_CHUNK) {
+    unsigned long long len = get64(hdr + 16);
+    if (len < W64_CHUNK || memcmp(hdr + 4, W64_SUFFIX, 12) != 0) return -1;
+    len -= W64_CHUNK;
+    if (memcmp(hdr, "data", 4) == 0) {
+      *datalen = len;
+      return wav->format > 0 ? 0 : -1;
+    }
+    if (memcmp(hdr, "fmt ", 4) == 0) {
+      if (parse_fmt(wav, len) < 0) return -1;
+    } else if (skip(wav->fp, len) < 0) return -1;
+    if (skip(wav->fp, (8 - (len & 7)) & 7) < 0) return -1;
+  }
+  return -1;
+}
+
+static unet_wav_t wav_free(_unet_wav_t *wav) {
+  if (wav->fp != NULL) fclose(wav->fp);
+  free(wav->raw);
+  free(wav->frames);
+  free(wav->chans);
+  free(wav);
+  return NULL;
+}
+
+static int alloc_buffers(_unet_wav_t *wav) {
+  wav->bytes = unet_wav_sample_bytes(wav->format);
+  wav->raw = malloc((size_t)WAV_CHUNK * (size_t)wav->channels * (size_t)wav->bytes);
+  return wav->raw != NULL ? 0 : -1;
+}
+
+unet_wav_t unet_wav_open(const char *filename) {
+  if (filename == NULL) return NULL;
+  _unet_wav_t *wav = calloc(1, sizeof(_unet_wav_t));
+  if (wav == NULL) return NULL;
+  wav->fp = fopen(filename, "rb");
+  if (wav->fp == NULL) return wav_free(wav);
+  uint8_t hdr[40];
+  unsigned long long datalen = 0;
+  int rv = -1;
+  if (fread(hdr, 1, 12, wav->fp) == 12) {
+    if ((memcmp(hdr, "RIFF", 4) == 0 || memcmp(hdr, "RF64", 4) == 0) && memcmp(hdr + 8, "WAVE", 4) == 0) {
+      rv = parse_riff(wav, &datalen);
+    } else if (memcmp(hdr, W64_RIFF, 12) == 0 && fread(hdr + 12, 1, 28, wav->fp) == 28 &&
+               memcmp(hdr + 12, W64_RIFF + 12, 4) == 0 && memcmp(hdr + 24, "wave", 4) == 0 &&
+               memcmp(hdr + 28, W64_SUFFIX, 12) == 0) {
+      rv = parse_w64(wav, &datalen);
+    }
+  }
+  if (rv < 0 || alloc_buffers(wav) < 0) return wav_free(wav);
+  wav->nframes = datalen / ((unsigned long long)wav->channels * (unsigned)wav->bytes);
+  return wav;
+}
+
+unet_wav_t unet_wav_create(const char *filename, int format, float fs, int channels) {
+  if (filename == NULL || format < WAV_FLOAT || format > WAV_PCM32 || fs <= 0 || channels <= 0) return NULL;
+  _unet_wav_t *wav = calloc(1, sizeof(_unet_wav_t));
+  if (wav == NULL) return NULL;
+  wav->writing = true;
+  wav->format = format;
+  wav->fs = fs;
+  wav->channels = channels;
+  wav->fp = fopen(filename, "wb");
+  if (wav->fp == NULL || alloc_buffers(wav) < 0) return wav_free(wav);
+  uint8_t hdr[WAV_HEADER];
+  unet_wav_header(hdr, format, fs, channels, 0);
+  if (fwrite(hdr, 1, WAV_HEADER, wav->fp) != WAV_HEADER) return wav_free(wav);
+  return wav;
+}
+
+float unet_wav_rate(unet_wav_t wav) {
+  if (wav == NULL) return -1;
+  return ((_unet_wav_t *)wav)->fs;
+}
+
+int unet_wav_channels(unet_wav_t wav) {
+  if (wav == NULL) return -1;
+  return ((_unet_wav_t *)wav)->channels;
+}
+
+int unet_wav_format(unet_wav_t wav) {
+  if (wav == NULL) return -1;
+  return ((_unet_wav_t *)wav)->format;
+}
+
+unsigned long long unet_wav_frames(unet_wav_t wav) {
+  if (wav == NULL) return 0;
+  return ((_unet_wav_t *)wav)->nframes;
+}
+
+int unet_wav_read(unet_wav_t wav, float *buf, int nframes) {
+  if (wav == NULL || buf == NULL || nframes < 0) return -1;
+  _unet_wav_t *uwav = wav;
+  if (uwav->writing) return -1;
+  size_t framelen = (size_t)uwav->channels * (size_t)uwav->bytes;
+  int count = 0;
+  while (count < nframes && uwav->pos < uwav->nframes) {
+    size_t n = (size_t)(nframes - count);
+    if (n > WAV_CHUNK) n = WAV_CHUNK;
+    if (n > uwav->nframes - uwav->pos) n = (size_t)(uwav->nframes - uwav->pos);
+    size_t got = fread(uwav->raw, framelen, n, uwav->fp);
+    decode(buf + (size_t)count * (size_t)uwav->channels, uwav->raw, got * (size_t)uwav->channels, uwav->format);
+    count += (int)got;
+    uwav->pos += got;
+    if (got < n) {
+      // a truncated file ends here
+      uwav->nframes = uwav->pos;
+      if (ferror(uwav->fp)) return -1;
+    }
+  }
+  return count;
+}
+
+int unet_wav_write(unet_wav_t wav, const float *buf, int nframes) {
+  if (wav == NULL || buf == NULL || nframes < 0) return -1;
+  _unet_wav_t *uwav = wav;
+  if (!uwav->writing || uwav->failed) return -1;
+  size_t channels = (size_t)uwav->channels;
+  size_t framelen = channels * (size_t)uwav->bytes;
+  int count = 0;
+  while (count < nframes) {
+    size_t n = (size_t)(nframes - count);
+    if (n > WAV_CHUNK) n = WAV_CHUNK;
+    unet_wav_encode(uwav->raw, buf + (size_t)count * channels, n * channels, uwav->format);
+    if (fwrite(uwav->raw, framelen, n, uwav->fp) != n) {
+      uwav->failed = true;
+      return -1;
+    }
+    count += (int)n;
+    uwav->nframes += n;
+  }
+  return count;
+}
+
+int unet_wav_close(unet_wav_t wav) {
+  if (wav == NULL) return -1;
+  _unet_wav_t *uwav = wav;
+  int rv = 0;
+  if (uwav->writing) {
+    uint8_t hdr[WAV_HEADER];
+    unet_wav_header(hdr, uwav->format, uwav->fs, uwav->channels, uwav->nframes);
+    if (uwav->failed || fseek(uwav->fp, 0, SEEK_SET) != 0 || fwrite(hdr, 1, WAV_HEADER, uwav->fp) != WAV_HEADER) rv = -1;
+    if (fclose(uwav->fp) != 0) rv = -1;
+    uwav->fp = NULL;
+  }
+  wav_free(uwav);
+  return rv;
+}
+
+int unet_wav_source(void *ctx, float *buf, int nsamples) {
+  _unet_wav_t *wav = ctx;
+  if (wav == NULL || buf == NULL || nsamples < 0) return 0;
+  if (wav->channels == 1) return unet_wav_read(wav, buf, nsamples);
+  if (wav->frames == NULL) {
+    wav->frames = malloc(sizeof(float) * WAV_CHUNK * (size_t)wav->channels);
+    wav->chans = calloc((size_t)wav->channels, sizeof(float *));
+    if (wav->frames == NULL || wav->chans == NULL) return 0;
+  }
+  int count = 0;
+  while (count < nsamples) {
+    int n = unet_wav_read(wav, wav->frames, nsamples - count < WAV_CHUNK ? nsamples - count : WAV_CHUNK);
+    if (n <= 0) break;
+    wav->chans[0] = buf + count;
+    unet_conv_deinterleave(wav->chans, wav->frames, wav->channels, (size_t)n);
+    count += n;
+  }
+  return count;
+}
+
+int unet_wav_block(void *ctx, const unet_block_t *blk) {
+  _unet_wav_t *wav = ctx;
+  if (wav == NULL || blk == NULL) return 1;
+  if (blk->gap > 0) {
+    float zeros[WAV_CHUNK];
+    memset(zeros, 0, sizeof(zeros));
+    int step = WAV_CHUNK / wav->channels;
+    long long gap = blk->gap;
+    while (gap > 0) {
+      int n = gap > step ? step : (int)gap;
+      if (unet_wav_write(wav, zeros, n) < n) return 1;
+      gap -= n;
+    }
+  }
+  return unet_wav_write(wav, blk->signal, blk->nsamples) < blk->nsamples ? 1 : 0;
+}
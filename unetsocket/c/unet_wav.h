@@ -0,0 +1,152 @@
+#ifndef _UNETWAV_H_
+#define _UNETWAV_H_
+
+#include <stdint.h>
+#include "unet_stream.h"
+
+typedef void *unet_wav_t;          ///< WAV file being read or written
+
+/// WAV sample formats
+
+#define WAV_FLOAT                1      ///< 32-bit float
+#define WAV_PCM16                2      ///< 16-bit PCM
+#define WAV_PCM24                3      ///< 24-bit PCM
+#define WAV_PCM32                4      ///< 32-bit PCM
+
+/// Size of the header written before the samples (bytes)
+
+#define WAV_HEADER               80
+
+/// Frames converted at a time when reading or writing
+
+#define WAV_CHUNK                4096
+
+/// Open a WAV file for reading. RIFF, RF64 and Wave64 files with 16/24/32-bit
+/// PCM or 32-bit float samples are supported. Samples are read block by block,
+/// so memory use does not depend on the length of the file.
+///
+/// @param filename         File to read
+/// @return                 WAV file, or NULL on error or unsupported format
+
+unet_wav_t unet_wav_open(const char *filename);
+
+/// Create a WAV file for writing. The file is written as RIFF, and changed to
+/// RF64 when it is closed if it has grown beyond 4 GB.
+///
+/// @param filename         File to create (overwritten if it exists)
+/// @param format           WAV_FLOAT, WAV_PCM16, WAV_PCM24 or WAV_PCM32
+/// @param fs               Sampling rate (Hz)
+/// @param channels         Number of channels
+/// @return                 WAV file, or NULL on error
+
+unet_wav_t unet_wav_create(const char *filename, int format, float fs, int channels);
+
+/// Get the sampling rate of a WAV file.
+///
+/// @param wav              WAV file
+/// @return                 Sampling rate (Hz), -1 on error
+
+float unet_wav_rate(unet_wav_t wav);
+
+/// Get the number of channels of a WAV file.
+///
+/// @param wav              WAV file
+/// @return                 Number of channels, -1 on error
+
+int unet_wav_channels(unet_wav_t wav);
+
+/// Get the sample format of a WAV file.
+///
+/// @param wav              WAV file
+/// @return                 WAV_FLOAT, WAV_PCM16, WAV_PCM24 or WAV_PCM32, -1 on error
+
+int unet_wav_format(unet_wav_t wav);
+
+/// Get the number of frames in a WAV file being read, or written so far to a
+/// WAV file being created.
+///
+/// @param wav              WAV file
+/// @return                 Number of frames
+
+unsigned long long unet_wav_frames(unet_wav_t wav);
+
+/// Read frames from a WAV file, converted to floats in the range [-1, 1].
+///
+/// @param wav              WAV file opened for reading
+/// @param buf              Buffer for the samples, interleaved if there is more
+///                         than one channel
+/// @param nframes          Largest number of frames to read
+/// @return                 Number of frames read (0 at the end of the file), -1 on error
+
+int unet_wav_read(unet_wav_t wav, float *buf, int nframes);
+
+/// Write frames to a WAV file.
+///
+/// @param wav              WAV file created for writing
+/// @param buf              Samples in the range [-1, 1], interleaved if there
+///                         is more than one channel
+/// @param nframes          Number of frames
+/// @return                 Number of frames written, -1 on error
+
+int unet_wav_write(unet_wav_t wav, const float *buf, int nframes);
+
+/// Close a WAV file. The header of a file being written is updated with the
+/// number of frames written.
+///
+/// @param wav              WAV file
+/// @return                 0 on success, -1 if any write failed
+
+int unet_wav_close(unet_wav_t wav);
+
+/// Sample source that reads the first channel of a WAV file, for use with
+/// unetsocket_ext_tx_stream().
+///
+/// @param ctx              WAV file opened for reading
+/// @param buf              Buffer for the samples
+/// @param nsamples         Largest number of samples to read
+/// @return                 Number of samples read, 0 at the end of the file
+
+int unet_wav_source(void *ctx, float *buf, int nsamples);
+
+/// Block sink that writes signal blocks to a WAV file, for use with
+/// unetsocket_ext_pbstream() and unetsocket_ext_bbstream(). Samples missed
+/// before a block are written as zeros, so that the recording keeps its
+/// timeline.
+///
+/// @param ctx              WAV file created for writing
+/// @param blk              Signal block
+/// @return                 0 to continue, 1 if a write failed
+
+int unet_wav_block(void *ctx, const unet_block_t *blk);
+
+/// Fill in a WAV_HEADER byte header for nframes frames. Files up to 4 GB get a
+/// RIFF header with a JUNK chunk reserving space for the RF64 ds64 chunk, and
+/// larger files an RF64 header, so the header can be rewritten in place as a
+/// file grows.
+///
+/// @param hdr              Header (WAV_HEADER bytes)
+/// @param format           WAV_FLOAT, WAV_PCM16, WAV_PCM24 or WAV_PCM32
+/// @param fs               Sampling rate (Hz)
+/// @param channels         Number of channels
+/// @param nframes          Number of frames
+
+void unet_wav_header(uint8_t *hdr, int format, float fs, int channels, unsigned long long nframes);
+
+/// Convert samples in the range [-1, 1] to a WAV sample format, in
+/// little-endian byte order.
+///
+/// @param dst              Converted samples
+/// @param src              Samples to convert
+/// @param n                Number of samples
+/// @param format           WAV_FLOAT, WAV_PCM16, WAV_PCM24 or WAV_PCM32
+
+void unet_wav_encode(uint8_t *dst, const float *src, size_t n, int format);
+
+/// Get the size of a sample in a WAV sample format.
+///
+/// @param format           WAV_FLOAT, WAV_PCM16, WAV_PCM24 or WAV_PCM32
+/// @return                 Bytes per sample
+
+int unet_wav_sample_bytes(int format);
+
+#endif
@@ -0,0 +1,843 @@
+#define _DEFAULT_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include <errno.h>
+#include "fjage.h"
+#include "unet.h"
+#include "unet_xfer.h"
+#include "unet_fec.h"
+#include "unet_time.h"
+#include "pthreadwindows.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#define ftello _ftelli64
+#endif
+
+// Transfer datagram types
+#define XFER_OFFER               1
+#define XFER_DATA                2
+#define XFER_SACK                3
+#define XFER_FEC                 4
+#define XFER_ACKREQ              0x80
+
+#define XFER_HDR                 5      // type + id
+#define XFER_OFFER_LEN           (XFER_HDR + 14)
+#define XFER_DATA_HDR            (XFER_HDR + 8)
+#define XFER_SACK_HDR            (XFER_HDR + 6)
+#define XFER_FEC_HDR             (XFER_HDR + 21)
+#define XFER_BUFLEN              (XFER_FEC_HDR + XFER_MAX_CHUNK)
+
+#define XFER_RTO                 (10 * TIMEOUT)
+#define XFER_MIN_RTO             (2 * TIMEOUT)
+#define XFER_MAX_RTO             (60 * TIMEOUT)
+
+#define XFER_STATE_MAGIC         0x55584652   // "UXFR"
+#define XFER_STATE_INTERVAL      64           // chunks between state file updates
+
+#define XFER_FEC_DEPTH           8            // blocks interleaved by the sender
+#define XFER_FEC_SLOTS           (2 * XFER_FEC_DEPTH)
+#define XFER_FEC_RETRIES         30
+
+typedef struct {
+  bool used;
+  uint32_t block;
+  int nrecv;
+  bool present[FEC_MAX_SHARDS];
+  uint8_t *shards;
+} _xfer_fec_slot_t;
+
+typedef struct {
+  unet_xfer_write_t write;
+  void *ctx;
+  FILE *fp;
+  char *statefile;
+  bool active;
+  uint32_t id;
+  unsigned long long size;
+  int chunk;
+  uint32_t nchunks;
+  uint32_t base;
+  uint32_t count;
+  int peer;
+  uint8_t *bitmap;
+  bool fec;
+  int k;
+  int m;
+  _xfer_fec_slot_t *slots;
+  unet_fec_t codec;                 // for k data chunks
+  unet_fec_t codec_last;            // for the shorter last block
+} _unet_xfer_rx_t;
+
+static uint32_t crctable[256];
+static pthread_once_t crcinit = PTHREAD_ONCE_INIT;
+
+static void put_u16(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static void put_u64(uint8_t *p, unsigned long long v) {
+  put_u32(p, (uint32_t)(v >> 32));
+  put_u32(p + 4, (uint32_t)v);
+}
+
+static uint32_t get_u16(const uint8_t *p) {
+  return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static unsigned long long get_u64(const uint8_t *p) {
+  return ((unsigned long long)get_u32(p) << 32) | get_u32(p + 4);
+}
+
+static bool bit_get(const uint8_t *bitmap, uint32_t i) {
+  return (bitmap[i >> 3] >> (i & 7)) & 1;
+}
+
+static void bit_set(uint8_t *bitmap, uint32_t i) {
+  bitmap[i >> 3] = (uint8_t)(bitmap[i >> 3] | (1 << (i & 7)));
+}
+
+static void crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+    crctable[i] = c;
+  }
+}
+
+uint32_t unet_crc32(uint32_t crc, const uint8_t *buf, size_t len) {
+  pthread_once(&crcinit, crc_init);
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) crc = crctable[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static int chunk_len(unsigned long long size, int chunk, uint32_t seq) {
+  unsigned long long offset = (unsigned long long)seq * (unsigned long long)chunk;
+  unsigned long long remaining = size - offset;
+  return remaining > (unsigned long long)chunk ? chunk : (int)remaining;
+}
+
+// receive the next transfer datagram with the given id, or return -1 on timeout
+static int receive_pkt(unetsocket_t sock, int protocol, uint32_t id, long timeout, uint8_t *buf, int *from) {
+  long long deadline = unet_host_time_ms() + timeout;
+  while (true) {
+    long long remaining = deadline - unet_host_time_ms();
+    if (remaining <= 0) return -1;
+    unetsocket_set_timeout(sock, (long)remaining);
+    fjage_msg_t ntf = unetsocket_receive(sock);
+    if (ntf == NULL) return -1;
+    if (strcmp(fjage_msg_get_clazz(ntf), "org.arl.unet.DatagramNtf") == 0 && fjage_msg_get_int(ntf, "protocol", 0) == protocol) {
+      int n = fjage_msg_get_byte_array(ntf, "data", buf, XFER_BUFLEN);
+      if (n > XFER_BUFLEN) n = XFER_BUFLEN;
+      if (from != NULL) *from = fjage_msg_get_int(ntf, "from", 0);
+      fjage_msg_destroy(ntf);
+      if (n >= XFER_HDR && get_u32(buf + 1) == id) return n;
+    } else {
+      fjage_msg_destroy(ntf);
+    }
+  }
+}
+
+////// sender
+
+typedef struct {
+  unetsocket_t sock;
+  int to;
+  int protocol;
+  uint32_t id;
+  unsigned long long size;
+  int chunk;
+  uint32_t nchunks;
+  int window;
+  unet_xfer_read_t read;
+  void *ctx;
+  uint8_t *acked;
+  long long *sent;              // time of last transmission, per window slot
+  unsigned long *order;         // transmission counter at last transmission, per window slot
+  uint8_t *retx;                // retransmitted flag, per window slot
+  unsigned long norder;
+  uint32_t base;
+  uint32_t next;
+  long rto;
+  long srtt;                    // smoothed RTT, -1 until measured
+  long rttvar;
+  uint32_t rttseq;              // chunk timed for the next RTT sample, nchunks if none
+} _unet_xfer_tx_t;
+
+static int send_chunk(_unet_xfer_tx_t *tx, uint32_t seq, bool ackreq) {
+  uint8_t buf[XFER_BUFLEN];
+  int len = chunk_len(tx->size, tx->chunk, seq);
+  if (tx->read(tx->ctx, (unsigned long long)seq * (unsigned long long)tx->chunk, buf + XFER_DATA_HDR, len) < 0) return -1;
+  buf[0] = (uint8_t)(XFER_DATA | (ackreq ? XFER_ACKREQ : 0));
+  put_u32(buf + 1, tx->id);
+  put_u32(buf + 5, seq);
+  put_u32(buf + 9, unet_crc32(0, buf + XFER_DATA_HDR, (size_t)len));
+  int slot = (int)(seq % (uint32_t)tx->window);
+  if (tx->sent[slot] != 0) tx->retx[slot] = 1;
+  if (tx->sent[slot] == 0 && ackreq && tx->rttseq == tx->nchunks) tx->rttseq = seq;
+  tx->sent[slot] = unet_host_time_ms();
+  tx->order[slot] = ++tx->norder;
+  if (unetsocket_send(tx->sock, buf, XFER_DATA_HDR + len, tx->to, tx->protocol) < 0) return -1;
+  return 0;
+}
+
+static void reset_rto(_unet_xfer_tx_t *tx) {
+  if (tx->srtt < 0) return;
+  tx->rto = tx->srtt + 4 * tx->rttvar;
+  if (tx->rto < XFER_MIN_RTO) tx->rto = XFER_MIN_RTO;
+  if (tx->rto > XFER_MAX_RTO) tx->rto = XFER_MAX_RTO;
+}
+
+static void update_rtt(_unet_xfer_tx_t *tx, long rtt) {
+  if (tx->srtt < 0) {
+    tx->srtt = rtt;
+    tx->rttvar = rtt / 2;
+  } else {
+    long err = rtt - tx->srtt;
+    tx->srtt += err / 8;
+    tx->rttvar += ((err < 0 ? -err : err) - tx->rttvar) / 4;
+  }
+  reset_rto(tx);
+}
+
+// process a SACK, returns number of newly acknowledged chunks
+static int process_sack(_unet_xfer_tx_t *tx, const uint8_t *buf, int n, uint32_t *lost, int *nlost) {
+  if (n < XFER_SACK_HDR) return 0;
+  uint32_t base = get_u32(buf + 5);
+  uint32_t nbits = get_u16(buf + 9);
+  if (base > tx->nchunks) return 0;
+  if ((int)(XFER_SACK_HDR + (nbits + 7) / 8) > n) nbits = (uint32_t)(n - XFER_SACK_HDR) * 8;
+  int newly = 0;
+  uint32_t hiack = tx->nchunks;
+  for (uint32_t seq = tx->base; seq < base; seq++) {
+    if (!bit_get(tx->acked, seq)) {
+      bit_set(tx->acked, seq);
+      newly++;
+    }
+    hiack = seq;
+  }
+  for (uint32_t i = 0; i < nbits && base + i < tx->nchunks; i++) {
+    if (!bit_get(buf + XFER_SACK_HDR, i)) continue;
+    uint32_t seq = base + i;
+    if (!bit_get(tx->acked, seq)) {
+      bit_set(tx->acked, seq);
+      newly++;
+    }
+    hiack = seq;
+  }
+  if (tx->rttseq < tx->nchunks && bit_get(tx->acked, tx->rttseq)) {
+    int slot = (int)(tx->rttseq % (uint32_t)tx->window);
+    if (!tx->retx[slot]) update_rtt(tx, (long)(unet_host_time_ms() - tx->sent[slot]));
+    tx->rttseq = tx->nchunks;
+  }
+  if (newly > 0) reset_rto(tx);
+  if (base > tx->base) tx->base = base;
+  while (tx->base < tx->nchunks && bit_get(tx->acked, tx->base)) tx->base++;
+  if (tx->next < tx->base) tx->next = tx->base;
+  // chunks transmitted before the highest acknowledged chunk, and still missing, were lost
+  *nlost = 0;
+  if (hiack < tx->nchunks && hiack >= tx->base && tx->sent[hiack % (uint32_t)tx->window] != 0) {
+    unsigned long horder = tx->order[hiack % (uint32_t)tx->window];
+    for (uint32_t seq = tx->base; seq < tx->next && seq < hiack; seq++) {
+      int slot = (int)(seq % (uint32_t)tx->window);
+      if (!bit_get(tx->acked, seq) && tx->sent[slot] != 0 && tx->order[slot] < horder) lost[(*nlost)++] = seq;
+    }
+  }
+  return newly;
+}
+
+int unetsocket_xfer_send(unetsocket_t sock, int to, int protocol, uint32_t id, unsigned long long size,
+                         unet_xfer_read_t read, void *ctx, int chunk, int window, long timeout) {
+  if (sock == NULL || read == NULL) return -1;
+  if (to <= 0) return -1; // broadcast with ARQ is not allowed
+  if (chunk == 0) chunk = XFER_CHUNK;
+  if (window == 0) window = XFER_WINDOW;
+  if (chunk < 0 || chunk > XFER_MAX_CHUNK || window < 0 || window > XFER_MAX_WINDOW) return -1;
+  unsigned long long nchunks = (size + (unsigned long long)chunk - 1) / (unsigned long long)chunk;
+  if (nchunks > 0xFFFFFFFEULL) return -1;
+  _unet_xfer_tx_t tx;
+  memset(&tx, 0, sizeof(tx));
+  tx.sock = sock;
+  tx.to = to;
+  tx.protocol = protocol;
+  tx.id = id;
+  tx.size = size;
+  tx.chunk = chunk;
+  tx.nchunks = (uint32_t)nchunks;
+  tx.window = window;
+  tx.read = read;
+  tx.ctx = ctx;
+  tx.rto = XFER_RTO;
+  tx.srtt = -1;
+  tx.rttseq = tx.nchunks;
+  tx.acked = calloc(nchunks / 8 + 1, 1);
+  tx.sent = calloc((size_t)window, sizeof(long long));
+  tx.order = calloc((size_t)window, sizeof(unsigned long));
+  tx.retx = calloc((size_t)window, 1);
+  uint32_t *pending = malloc(2 * (size_t)window * sizeof(uint32_t));
+  uint32_t *lost = malloc((size_t)window * sizeof(uint32_t));
+  long savedtimeout = unetsocket_get_timeout(sock);
+  int rv = -1;
+  uint8_t buf[XFER_BUFLEN];
+  if (tx.acked == NULL || tx.sent == NULL || tx.order == NULL || tx.retx == NULL || pending == NULL || lost == NULL) goto done;
+  // offer the transfer and learn which chunks the receiver already has
+  long long progress = unet_host_time_ms();
+  bool accepted = false;
+  while (!accepted) {
+    if (unet_host_time_ms() - progress > timeout) goto done;
+    buf[0] = XFER_OFFER;
+    put_u32(buf + 1, id);
+    put_u64(buf + 5, size);
+    put_u16(buf + 13, (uint32_t)chunk);
+    put_u32(buf + 15, tx.nchunks);
+    if (unetsocket_send(sock, buf, XFER_OFFER_LEN, to, protocol) < 0) goto done;
+    long long t0 = unet_host_time_ms();
+    int n;
+    while ((n = receive_pkt(sock, protocol, id, tx.rto - (long)(unet_host_time_ms() - t0), buf, NULL)) >= 0) {
+      if (buf[0] != XFER_SACK) continue;
+      int nlost;
+      process_sack(&tx, buf, n, lost, &nlost);
+      update_rtt(&tx, (long)(unet_host_time_ms() - t0));
+      accepted = true;
+      break;
+    }
+    if (!accepted && tx.rto < XFER_MAX_RTO) tx.rto *= 2;
+  }
+  progress = unet_host_time_ms();
+  int npending = 0;
+  long long lastsack = unet_host_time_ms();
+  while (tx.base < tx.nchunks) {
+    // queue new chunks within the window
+    while (tx.next < tx.nchunks && tx.next < tx.base + (uint32_t)window && npending < 2 * window) {
+      int slot = (int)(tx.next % (uint32_t)window);
+      tx.sent[slot] = 0;
+      tx.retx[slot] = 0;
+      if (!bit_get(tx.acked, tx.next)) pending[npending++] = tx.next;
+      tx.next++;
+    }
+    // retransmit chunks that timed out, or probe with the oldest missing chunk, if the receiver has been silent for too long
+    if (npending == 0 && unet_host_time_ms() - lastsack >= tx.rto) {
+      long long now = unet_host_time_ms();
+      for (uint32_t seq = tx.base; seq < tx.next && npending < 2 * window; seq++) {
+        int slot = (int)(seq % (uint32_t)window);
+        if (!bit_get(tx.acked, seq) && now - tx.sent[slot] >= tx.rto) pending[npending++] = seq;
+      }
+      if (npending == 0) pending[npending++] = tx.base;
+      if (tx.rto < XFER_MAX_RTO) tx.rto *= 2;
+    }
+    // transmit back to back, requesting acknowledgements every half window and at the end of the burst
+    for (int i = 0; i < npending; i++) {
+      bool ackreq = (i == npending - 1) || (pending[i] % (uint32_t)((window + 1) / 2) == 0);
+      if (send_chunk(&tx, pending[i], ackreq) < 0) goto done;
+    }
+    if (npending > 0) lastsack = unet_host_time_ms();
+    npending = 0;
+    // wait for acknowledgements
+    long wait = tx.rto - (long)(unet_host_time_ms() - lastsack);
+    if (wait < 0) wait = 0;
+    int n = receive_pkt(sock, protocol, id, wait, buf, NULL);
+    if (n >= 0 && buf[0] == XFER_SACK) {
+      int nlost = 0;
+      if (process_sack(&tx, buf, n, lost, &nlost) > 0) progress = unet_host_time_ms();
+      for (int i = 0; i < nlost; i++) pending[npending++] = lost[i];
+      lastsack = unet_host_time_ms();
+    }
+    if (unet_host_time_ms() - progress > timeout) goto done;
+  }
+  rv = 0;
+done:
+  unetsocket_set_timeout(sock, savedtimeout);
+  free(tx.acked);
+  free(tx.sent);
+  free(tx.order);
+  free(tx.retx);
+  free(pending);
+  free(lost);
+  return rv;
+}
+
+static int read_buffer(void *ctx, unsigned long long offset, uint8_t *buf, int len) {
+  memcpy(buf, (const uint8_t *)ctx + offset, (size_t)len);
+  return 0;
+}
+
+int unetsocket_xfer_send_buffer(unetsocket_t sock, int to, int protocol, uint32_t id, const uint8_t *data, size_t len, long timeout) {
+  if (len > 0 && data == NULL) return -1;
+  return unetsocket_xfer_send(sock, to, protocol, id, len, read_buffer, (void *)data, 0, 0, timeout);
+}
+
+static int read_file(void *ctx, unsigned long long offset, uint8_t *buf, int len) {
+  FILE *fp = ctx;
+  if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) return -1;
+  if (fread(buf, 1, (size_t)len, fp) != (size_t)len) return -1;
+  return 0;
+}
+
+int unetsocket_xfer_send_file(unetsocket_t sock, int to, int protocol, uint32_t id, const char *filename, long timeout) {
+  if (filename == NULL) return -1;
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) return -1;
+  if (fseeko(fp, 0, SEEK_END) != 0) {
+    fclose(fp);
+    return -1;
+  }
+  off_t size = ftello(fp);
+  if (size < 0) {
+    fclose(fp);
+    return -1;
+  }
+  int rv = unetsocket_xfer_send(sock, to, protocol, id, (unsigned long long)size, read_file, fp, 0, 0, timeout);
+  fclose(fp);
+  return rv;
+}
+
+////// erasure coded broadcast
+
+static void fec_block_size(uint32_t nchunks, int k, int m, uint32_t block, int *kb, int *mb) {
+  uint32_t remaining = nchunks - block * (uint32_t)k;
+  *kb = remaining < (uint32_t)k ? (int)remaining : k;
+  *mb = *kb == k ? m : (m * *kb + k - 1) / k;
+}
+
+static int send_broadcast(unetsocket_t sock, uint8_t *buf, int len, int protocol) {
+  for (int i = 0; i < XFER_FEC_RETRIES; i++) {
+    if (unetsocket_send(sock, buf, len, 0, protocol) == 0) return 0;
+    Sleep(TIMEOUT);   // wait for the transmit queue to drain
+  }
+  return -1;
+}
+
+int unetsocket_xfer_broadcast(unetsocket_t sock, int protocol, uint32_t id, unsigned long long size,
+                              unet_xfer_read_t read, void *ctx, int chunk, int k, int m) {
+  if (sock == NULL || read == NULL) return -1;
+  if (chunk == 0) chunk = XFER_CHUNK;
+  if (k == 0) k = XFER_FEC_K;
+  if (m < 0) m = XFER_FEC_M;
+  if (chunk < 0 || chunk > XFER_MAX_CHUNK || k >= FEC_MAX_SHARDS || k + m > FEC_MAX_SHARDS) return -1;
+  unsigned long long nchunks = (size + (unsigned long long)chunk - 1) / (unsigned long long)chunk;
+  if (nchunks > 0xFFFFFFFEULL) return -1;
+  uint32_t nblocks = (uint32_t)((nchunks + (unsigned long long)k - 1) / (unsigned long long)k);
+  size_t blklen = (size_t)(k + m) * (size_t)chunk;
+  uint8_t *shards = malloc(XFER_FEC_DEPTH * blklen);
+  unet_fec_t fec = unet_fec_create(k, m);
+  unet_fec_t fec_last = NULL;
+  uint8_t buf[XFER_BUFLEN];
+  const uint8_t *data[FEC_MAX_SHARDS];
+  uint8_t *parity[FEC_MAX_SHARDS];
+  int kb[XFER_FEC_DEPTH];
+  int mb[XFER_FEC_DEPTH];
+  int rv = -1;
+  if (shards == NULL || fec == NULL) goto done;
+  buf[0] = XFER_FEC;
+  put_u32(buf + 1, id);
+  put_u64(buf + 5, size);
+  put_u16(buf + 13, (uint32_t)chunk);
+  buf[15] = (uint8_t)k;
+  buf[16] = (uint8_t)m;
+  for (uint32_t b0 = 0; b0 < nblocks; b0 += XFER_FEC_DEPTH) {
+    uint32_t nb = nblocks - b0 < XFER_FEC_DEPTH ? nblocks - b0 : XFER_FEC_DEPTH;
+    // read and encode a group of blocks
+    for (uint32_t j = 0; j < nb; j++) {
+      uint32_t block = b0 + j;
+      uint8_t *blk = shards + j * blklen;
+      fec_block_size((uint32_t)nchunks, k, m, block, &kb[j], &mb[j]);
+      memset(blk, 0, (size_t)kb[j] * (size_t)chunk);
+      for (int i = 0; i < kb[j]; i++) {
+        uint32_t seq = block * (uint32_t)k + (uint32_t)i;
+        if (read(ctx, (unsigned long long)seq * (unsigned long long)chunk, blk + i * chunk, chunk_len(size, chunk, seq)) < 0) goto done;
+        data[i] = blk + i * chunk;
+      }
+      for (int i = 0; i < mb[j]; i++) parity[i] = blk + (kb[j] + i) * chunk;
+      unet_fec_t codec = fec;
+      if (kb[j] != k) {
+        if (fec_last == NULL) fec_last = unet_fec_create(kb[j], mb[j]);
+        if (fec_last == NULL) goto done;
+        codec = fec_last;
+      }
+      if (unet_fec_encode(codec, data, parity, (size_t)chunk) < 0) goto done;
+    }
+    // transmit interleaved across the group
+    for (int i = 0; i < k + m; i++) {
+      for (uint32_t j = 0; j < nb; j++) {
+        if (i >= kb[j] + mb[j]) continue;
+        const uint8_t *shard = shards + j * blklen + (size_t)i * (size_t)chunk;
+        put_u32(buf + 17, b0 + j);
+        buf[21] = (uint8_t)i;
+        put_u32(buf + 22, unet_crc32(0, shard, (size_t)chunk));
+        memcpy(buf + XFER_FEC_HDR, shard, (size_t)chunk);
+        if (send_broadcast(sock, buf, XFER_FEC_HDR + chunk, protocol) < 0) goto done;
+      }
+    }
+  }
+  rv = 0;
+done:
+  free(shards);
+  unet_fec_destroy(fec);
+  unet_fec_destroy(fec_last);
+  return rv;
+}
+
+int unetsocket_xfer_broadcast_buffer(unetsocket_t sock, int protocol, uint32_t id, const uint8_t *data, size_t len, int k, int m) {
+  if (len > 0 && data == NULL) return -1;
+  return unetsocket_xfer_broadcast(sock, protocol, id, len, read_buffer, (void *)data, 0, k, m);
+}
+
+int unetsocket_xfer_broadcast_file(unetsocket_t sock, int protocol, uint32_t id, const char *filename, int k, int m) {
+  if (filename == NULL) return -1;
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) return -1;
+  if (fseeko(fp, 0, SEEK_END) != 0) {
+    fclose(fp);
+    return -1;
+  }
+  off_t size = ftello(fp);
+  if (size < 0) {
+    fclose(fp);
+    return -1;
+  }
+  int rv = unetsocket_xfer_broadcast(sock, protocol, id, (unsigned long long)size, read_file, fp, 0, k, m);
+  fclose(fp);
+  return rv;
+}
+
+////// receiver
+
+unet_xfer_rx_t unet_xfer_rx_open(unet_xfer_write_t write, void *ctx) {
+  if (write == NULL) return NULL;
+  _unet_xfer_rx_t *rx = calloc(1, sizeof(_unet_xfer_rx_t));
+  if (rx == NULL) return NULL;
+  rx->write = write;
+  rx->ctx = ctx;
+  return rx;
+}
+
+static int write_file(void *ctx, unsigned long long offset, const uint8_t *buf, int len) {
+  FILE *fp = ctx;
+  if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) return -1;
+  if (fwrite(buf, 1, (size_t)len, fp) != (size_t)len) return -1;
+  return 0;
+}
+
+unet_xfer_rx_t unet_xfer_rx_open_file(const char *filename) {
+  if (filename == NULL) return NULL;
+  size_t n = strlen(filename);
+  char *statefile = malloc(n + 6);
+  if (statefile == NULL) return NULL;
+  memcpy(statefile, filename, n);
+  memcpy(statefile + n, ".xfer", 6);
+  FILE *fp = fopen(filename, "r+b");
+  if (fp == NULL) fp = fopen(filename, "w+b");
+  if (fp == NULL) {
+    free(statefile);
+    return NULL;
+  }
+  _unet_xfer_rx_t *rx = unet_xfer_rx_open(write_file, fp);
+  if (rx == NULL) {
+    fclose(fp);
+    free(statefile);
+    return NULL;
+  }
+  rx->fp = fp;
+  rx->statefile = statefile;
+  unet_xfer_rx_load(rx, statefile);
+  return rx;
+}
+
+static void fec_reset(_unet_xfer_rx_t *rx) {
+  rx->fec = false;
+  unet_fec_destroy(rx->codec);
+  unet_fec_destroy(rx->codec_last);
+  rx->codec = NULL;
+  rx->codec_last = NULL;
+  if (rx->slots == NULL) return;
+  for (int i = 0; i < XFER_FEC_SLOTS; i++) free(rx->slots[i].shards);
+  memset(rx->slots, 0, XFER_FEC_SLOTS * sizeof(_xfer_fec_slot_t));
+}
+
+void unet_xfer_rx_close(unet_xfer_rx_t rx) {
+  if (rx == NULL) return;
+  _unet_xfer_rx_t *urx = rx;
+  fec_reset(urx);
+  free(urx->slots);
+  if (urx->fp != NULL) fclose(urx->fp);
+  free(urx->statefile);
+  free(urx->bitmap);
+  free(urx);
+}
+
+static int rx_init(_unet_xfer_rx_t *rx, uint32_t id, unsigned long long size, int chunk, uint32_t nchunks, int peer) {
+  if (chunk <= 0 || chunk > XFER_MAX_CHUNK) return -1;
+  if (nchunks != (size + (unsigned long long)chunk - 1) / (unsigned long long)chunk) return -1;
+  uint8_t *bitmap = calloc((size_t)nchunks / 8 + 1, 1);
+  if (bitmap == NULL) return -1;
+  free(rx->bitmap);
+  rx->bitmap = bitmap;
+  rx->active = true;
+  rx->id = id;
+  rx->size = size;
+  rx->chunk = chunk;
+  rx->nchunks = nchunks;
+  rx->base = 0;
+  rx->count = 0;
+  rx->peer = peer;
+  fec_reset(rx);
+  return 0;
+}
+
+static int rx_write(_unet_xfer_rx_t *rx, uint32_t seq, const uint8_t *buf) {
+  if (rx->write(rx->ctx, (unsigned long long)seq * (unsigned long long)rx->chunk, buf, chunk_len(rx->size, rx->chunk, seq)) < 0) return -1;
+  bit_set(rx->bitmap, seq);
+  rx->count++;
+  while (rx->base < rx->nchunks && bit_get(rx->bitmap, rx->base)) rx->base++;
+  return 0;
+}
+
+// process an erasure coded chunk, returns number of chunks written or -1 on error
+static int rx_fec(_unet_xfer_rx_t *rx, const uint8_t *buf, int n) {
+  uint32_t id = get_u32(buf + 1);
+  unsigned long long size = get_u64(buf + 5);
+  int chunk = (int)get_u16(buf + 13);
+  int k = buf[15];
+  int m = buf[16];
+  uint32_t block = get_u32(buf + 17);
+  int index = buf[21];
+  const uint8_t *payload = buf + XFER_FEC_HDR;
+  if (chunk <= 0 || chunk > XFER_MAX_CHUNK || n != XFER_FEC_HDR + chunk || k < 1 || k + m > FEC_MAX_SHARDS) return 0;
+  if (get_u32(buf + 22) != unet_crc32(0, payload, (size_t)chunk)) return 0;
+  unsigned long long nchunks = (size + (unsigned long long)chunk - 1) / (unsigned long long)chunk;
+  if (nchunks > 0xFFFFFFFEULL) return 0;
+  if (!rx->active || rx->id != id || rx->size != size || rx->chunk != chunk) {
+    if (rx_init(rx, id, size, chunk, (uint32_t)nchunks, 0) < 0) return 0;
+  }
+  if (!rx->fec || rx->k != k || rx->m != m) {
+    fec_reset(rx);
+    if (rx->slots == NULL) rx->slots = calloc(XFER_FEC_SLOTS, sizeof(_xfer_fec_slot_t));
+    if (rx->slots == NULL) return -1;
+    rx->codec = unet_fec_create(k, m);
+    if (rx->codec == NULL) return -1;
+    rx->fec = true;
+    rx->k = k;
+    rx->m = m;
+  }
+  if (block >= (rx->nchunks + (uint32_t)k - 1) / (uint32_t)k) return 0;
+  int kb, mb;
+  fec_block_size(rx->nchunks, k, m, block, &kb, &mb);
+  if (index >= kb + mb) return 0;
+  uint32_t first = block * (uint32_t)k;
+  int written = 0;
+  if (index < kb && !bit_get(rx->bitmap, first + (uint32_t)index)) {
+    if (rx_write(rx, first + (uint32_t)index, payload) < 0) return -1;
+    written++;
+  }
+  bool done = true;
+  for (int i = 0; i < kb && done; i++) if (!bit_get(rx->bitmap, first + (uint32_t)i)) done = false;
+  _xfer_fec_slot_t *slot = NULL;
+  for (int i = 0; i < XFER_FEC_SLOTS && slot == NULL; i++)
+    if (rx->slots[i].used && rx->slots[i].block == block) slot = &rx->slots[i];
+  if (done) {
+    if (slot != NULL) slot->used = false;
+    return written;
+  }
+  if (slot == NULL) {
+    // take a free slot, or evict the block with the fewest chunks
+    for (int i = 0; i < XFER_FEC_SLOTS; i++)
+      if (slot == NULL || !rx->slots[i].used || (slot->used && rx->slots[i].nrecv < slot->nrecv)) slot = &rx->slots[i];
+    if (slot->shards == NULL) slot->shards = malloc((size_t)(k + m) * (size_t)chunk);
+    if (slot->shards == NULL) return -1;
+    slot->used = true;
+    slot->block = block;
+    slot->nrecv = 0;
+    memset(slot->present, 0, sizeof(slot->present));
+  }
+  if (!slot->present[index]) {
+    memcpy(slot->shards + index * chunk, payload, (size_t)chunk);
+    slot->present[index] = true;
+    slot->nrecv++;
+  }
+  if (slot->nrecv < kb) return written;
+  // enough chunks to reconstruct the block
+  uint8_t *shards[FEC_MAX_SHARDS];
+  for (int i = 0; i < kb + mb; i++) shards[i] = slot->shards + i * chunk;
+  unet_fec_t codec = rx->codec;
+  if (kb < k) {
+    if (rx->codec_last == NULL) rx->codec_last = unet_fec_create(kb, mb);
+    if (rx->codec_last == NULL) return -1;
+    codec = rx->codec_last;
+  }
+  int rv = unet_fec_decode(codec, shards, slot->present, (size_t)chunk);
+  slot->used = false;
+  if (rv < 0) return written;
+  for (int i = 0; i < kb; i++) {
+    if (bit_get(rx->bitmap, first + (uint32_t)i)) continue;
+    if (rx_write(rx, first + (uint32_t)i, shards[i]) < 0) return -1;
+    written++;
+  }
+  return written;
+}
+
+static int send_sack(unetsocket_t sock, _unet_xfer_rx_t *rx, int protocol) {
+  uint8_t buf[XFER_SACK_HDR + XFER_MAX_WINDOW / 8];
+  uint32_t nbits = rx->nchunks - rx->base;
+  if (nbits > XFER_MAX_WINDOW) nbits = XFER_MAX_WINDOW;
+  buf[0] = XFER_SACK;
+  put_u32(buf + 1, rx->id);
+  put_u32(buf + 5, rx->base);
+  put_u16(buf + 9, nbits);
+  memset(buf + XFER_SACK_HDR, 0, (nbits + 7) / 8);
+  for (uint32_t i = 0; i < nbits; i++)
+    if (bit_get(rx->bitmap, rx->base + i)) bit_set(buf + XFER_SACK_HDR, i);
+  return unetsocket_send(sock, buf, (int)(XFER_SACK_HDR + (nbits + 7) / 8), rx->peer, protocol);
+}
+
+static void save_state(_unet_xfer_rx_t *rx) {
+  if (rx->statefile == NULL || !rx->active) return;
+  fflush(rx->fp);
+  if (rx->base == rx->nchunks) remove(rx->statefile);
+  else unet_xfer_rx_save(rx, rx->statefile);
+}
+
+int unetsocket_xfer_receive(unetsocket_t sock, unet_xfer_rx_t rx, int protocol, long timeout) {
+  if (sock == NULL || rx == NULL) return -1;
+  _unet_xfer_rx_t *urx = rx;
+  long savedtimeout = unetsocket_get_timeout(sock);
+  uint8_t buf[XFER_BUFLEN];
+  uint32_t unsaved = 0;
+  // moved forward by every datagram of the transfer, so that timeout bounds
+  // the time between datagrams and not the whole transfer
+  long long deadline = unet_host_time_ms() + timeout;
+  int rv = -1;
+  while (true) {
+    bool complete = urx->active && urx->base == urx->nchunks;
+    if (complete) rv = 0;
+    long wait = complete ? (urx->fec ? 0 : XFER_LINGER) : (long)(deadline - unet_host_time_ms());
+    if (wait <= 0) break;
+    unetsocket_set_timeout(sock, wait);
+    fjage_msg_t ntf = unetsocket_receive(sock);
+    if (ntf == NULL) break;
+    if (strcmp(fjage_msg_get_clazz(ntf), "org.arl.unet.DatagramNtf") != 0 || fjage_msg_get_int(ntf, "protocol", 0) != protocol) {
+      fjage_msg_destroy(ntf);
+      continue;
+    }
+    int n = fjage_msg_get_byte_array(ntf, "data", buf, XFER_BUFLEN);
+    if (n > XFER_BUFLEN) n = XFER_BUFLEN;
+    int from = fjage_msg_get_int(ntf, "from", 0);
+    fjage_msg_destroy(ntf);
+    if (n < XFER_HDR) continue;
+    uint32_t id = get_u32(buf + 1);
+    int type = buf[0] & ~XFER_ACKREQ;
+    if (type == XFER_OFFER && n >= XFER_OFFER_LEN) {
+      unsigned long long size = get_u64(buf + 5);
+      int chunk = (int)get_u16(buf + 13);
+      uint32_t nchunks = get_u32(buf + 15);
+      if (!urx->active || urx->id != id || urx->size != size || urx->chunk != chunk) {
+        if (rx_init(urx, id, size, chunk, nchunks, from) < 0) continue;
+        if (urx->fp != NULL && size == 0) fflush(urx->fp);
+      }
+      deadline = unet_host_time_ms() + timeout;
+      urx->peer = from;
+      send_sack(sock, urx, protocol);
+    } else if (type == XFER_DATA && n >= XFER_DATA_HDR && urx->active && urx->id == id) {
+      uint32_t seq = get_u32(buf + 5);
+      if (seq >= urx->nchunks) continue;
+      int len = chunk_len(urx->size, urx->chunk, seq);
+      if (n - XFER_DATA_HDR != len || get_u32(buf + 9) != unet_crc32(0, buf + XFER_DATA_HDR, (size_t)len)) continue;
+      deadline = unet_host_time_ms() + timeout;
+      if (!bit_get(urx->bitmap, seq)) {
+        if (rx_write(urx, seq, buf + XFER_DATA_HDR) < 0) break;
+        if (++unsaved >= XFER_STATE_INTERVAL) {
+          save_state(urx);
+          unsaved = 0;
+        }
+      }
+      if ((buf[0] & XFER_ACKREQ) || urx->base == urx->nchunks) send_sack(sock, urx, protocol);
+    } else if (type == XFER_FEC && n >= XFER_FEC_HDR) {
+      int written = rx_fec(urx, buf, n);
+      if (written < 0) break;
+      if (urx->active && urx->id == id) deadline = unet_host_time_ms() + timeout;
+      unsaved += (uint32_t)written;
+      if (unsaved >= XFER_STATE_INTERVAL) {
+        save_state(urx);
+        unsaved = 0;
+      }
+    }
+  }
+  save_state(urx);
+  unetsocket_set_timeout(sock, savedtimeout);
+  return rv;
+}
+
+int unet_xfer_rx_status(unet_xfer_rx_t rx, uint32_t *id, unsigned long long *size, unsigned long long *received) {
+  if (rx == NULL) return -1;
+  _unet_xfer_rx_t *urx = rx;
+  if (!urx->active) return -1;
+  if (id != NULL) *id = urx->id;
+  if (size != NULL) *size = urx->size;
+  if (received != NULL) {
+    unsigned long long bytes = (unsigned long long)urx->count * (unsigned long long)urx->chunk;
+    if (urx->count > 0 && bit_get(urx->bitmap, urx->nchunks - 1)) bytes -= (unsigned long long)(urx->chunk - chunk_len(urx->size, urx->chunk, urx->nchunks - 1));
+    *received = bytes;
+  }
+  return 0;
+}
+
+int unet_xfer_rx_save(unet_xfer_rx_t rx, const char *filename) {
+  if (rx == NULL || filename == NULL) return -1;
+  _unet_xfer_rx_t *urx = rx;
+  if (!urx->active) return -1;
+  uint8_t hdr[28];
+  put_u32(hdr, XFER_STATE_MAGIC);
+  put_u32(hdr + 4, urx->id);
+  put_u64(hdr + 8, urx->size);
+  put_u32(hdr + 16, (uint32_t)urx->chunk);
+  put_u32(hdr + 20, urx->nchunks);
+  put_u32(hdr + 24, (uint32_t)urx->peer);
+  FILE *fp = fopen(filename, "wb");
+  if (fp == NULL) return -1;
+  size_t nbytes = (size_t)urx->nchunks / 8 + 1;
+  int rv = (fwrite(hdr, 1, sizeof(hdr), fp) == sizeof(hdr) && fwrite(urx->bitmap, 1, nbytes, fp) == nbytes) ? 0 : -1;
+  if (fclose(fp) != 0) rv = -1;
+  return rv;
+}
+
+int unet_xfer_rx_load(unet_xfer_rx_t rx, const char *filename) {
+  if (rx == NULL || filename == NULL) return -1;
+  _unet_xfer_rx_t *urx = rx;
+  uint8_t hdr[28];
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) return -1;
+  if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) || get_u32(hdr) != XFER_STATE_MAGIC) {
+    fclose(fp);
+    return -1;
+  }
+  if (rx_init(urx, get_u32(hdr + 4), get_u64(hdr + 8), (int)get_u32(hdr + 16), get_u32(hdr + 20), (int)get_u32(hdr + 24)) < 0) {
+    fclose(fp);
+    return -1;
+  }
+  size_t nbytes = (size_t)urx->nchunks / 8 + 1;
+  if (fread(urx->bitmap, 1, nbytes, fp) != nbytes) {
+    fclose(fp);
+    urx->active = false;
+    return -1;
+  }
+  fclose(fp);
+  for (uint32_t i = 0; i < urx->nchunks; i++)
+    if (bit_get(urx->bitmap, i)) urx->count++;
+  while (urx->base < urx->nchunks && bit_get(urx->bitmap, urx->base)) urx->base++;
+  return 0;
+}
@@ -0,0 +1,238 @@
+#ifndef _UNETXFER_H_
+#define _UNETXFER_H_
+
+#include <stddef.h>
+#include "fjage.h"
+#include "unet.h"
+
+typedef void *unet_xfer_rx_t;      ///< bulk transfer receiver state
+
+/// Default payload size of a transfer chunk (bytes)
+
+#define XFER_CHUNK               256
+
+/// Largest allowed payload size of a transfer chunk (bytes)
+
+#define XFER_MAX_CHUNK           4096
+
+/// Default number of unacknowledged chunks in flight
+
+#define XFER_WINDOW              64
+
+/// Largest allowed number of unacknowledged chunks in flight
+
+#define XFER_MAX_WINDOW          256
+
+/// Time a receiver keeps acknowledging retransmissions after completion
+
+#define XFER_LINGER              (10 * TIMEOUT)
+
+/// Default number of data chunks per erasure coded block
+
+#define XFER_FEC_K               32
+
+/// Default number of parity chunks per erasure coded block
+
+#define XFER_FEC_M               8
+
+/// Data source for a bulk transfer. Reads len bytes starting at offset into buf.
+///
+/// @param ctx              User context
+/// @param offset           Byte offset into the transferred object
+/// @param buf              Buffer to fill
+/// @param len              Number of bytes to read
+/// @return                 0 on success, -1 otherwise
+
+typedef int (*unet_xfer_read_t)(void *ctx, unsigned long long offset, uint8_t *buf, int len);
+
+/// Data sink for a bulk transfer. Writes len bytes from buf starting at offset.
+///
+/// @param ctx              User context
+/// @param offset           Byte offset into the transferred object
+/// @param buf              Data to write
+/// @param len              Number of bytes to write
+/// @return                 0 on success, -1 otherwise
+
+typedef int (*unet_xfer_write_t)(void *ctx, unsigned long long offset, const uint8_t *buf, int len);
+
+/// Compute (or continue) a CRC-32 (IEEE 802.3) over a buffer.
+///
+/// @param crc              CRC of the preceding data, 0 to start
+/// @param buf              Data
+/// @param len              Number of bytes
+/// @return                 Updated CRC
+
+uint32_t unet_crc32(uint32_t crc, const uint8_t *buf, size_t len);
+
+/// Transfer a large object to a remote node using a selective-repeat ARQ.
+///
+/// The object is split into chunks that are sent as datagrams without waiting
+/// for each to be acknowledged. Up to window chunks are kept in flight and the
+/// receiver acknowledges them selectively, so only lost or corrupted chunks are
+/// retransmitted. If the transfer is restarted with the same id, chunks
+/// already held by the receiver are skipped.
+///
+/// The socket must be unbound or bound to the transfer protocol, and the call
+/// consumes all datagrams received on that protocol while it runs.
+///
+/// @param sock             Unet socket
+/// @param to               Destination node address (must not be 0)
+/// @param protocol         Protocol number to use for the transfer
+/// @param id               Transfer identifier, shared with the receiver
+/// @param size             Size of the object in bytes
+/// @param read             Data source
+/// @param ctx              Context passed to the data source
+/// @param chunk            Payload bytes per chunk, or 0 for XFER_CHUNK
+/// @param window           Chunks in flight, or 0 for XFER_WINDOW
+/// @param timeout          Give up if no progress is made for this long (ms)
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_xfer_send(unetsocket_t sock, int to, int protocol, uint32_t id, unsigned long long size,
+                         unet_xfer_read_t read, void *ctx, int chunk, int window, long timeout);
+
+/// Transfer a buffer to a remote node using a selective-repeat ARQ.
+/// See unetsocket_xfer_send().
+///
+/// @param sock             Unet socket
+/// @param to               Destination node address (must not be 0)
+/// @param protocol         Protocol number to use for the transfer
+/// @param id               Transfer identifier, shared with the receiver
+/// @param data             Data to send across
+/// @param len              Number of bytes in the data
+/// @param timeout          Give up if no progress is made for this long (ms)
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_xfer_send_buffer(unetsocket_t sock, int to, int protocol, uint32_t id, const uint8_t *data, size_t len, long timeout);
+
+/// Transfer a file to a remote node using a selective-repeat ARQ.
+/// See unetsocket_xfer_send().
+///
+/// @param sock             Unet socket
+/// @param to               Destination node address (must not be 0)
+/// @param protocol         Protocol number to use for the transfer
+/// @param id               Transfer identifier, shared with the receiver
+/// @param filename         File to send
+/// @param timeout          Give up if no progress is made for this long (ms)
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_xfer_send_file(unetsocket_t sock, int to, int protocol, uint32_t id, const char *filename, long timeout);
+
+/// Broadcast a large object to all nodes in range using forward erasure coding.
+///
+/// The object is split into blocks of k chunks, and m parity chunks are added
+/// to each block using a Reed-Solomon code. A receiver reconstructs a block
+/// from any k of its k+m chunks, so no acknowledgements or retransmissions are
+/// needed. Chunks of several blocks are interleaved to spread burst losses.
+/// Broadcasting again with the same id fills in blocks that receivers missed.
+///
+/// @param sock             Unet socket
+/// @param protocol         Protocol number to use for the transfer
+/// @param id               Transfer identifier, shared with the receivers
+/// @param size             Size of the object in bytes
+/// @param read             Data source
+/// @param ctx              Context passed to the data source
+/// @param chunk            Payload bytes per chunk, or 0 for XFER_CHUNK
+/// @param k                Data chunks per block (1-255), or 0 for XFER_FEC_K
+/// @param m                Parity chunks per block, or -1 for XFER_FEC_M
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_xfer_broadcast(unetsocket_t sock, int protocol, uint32_t id, unsigned long long size,
+                              unet_xfer_read_t read, void *ctx, int chunk, int k, int m);
+
+/// Broadcast a buffer using forward erasure coding.
+/// See unetsocket_xfer_broadcast().
+///
+/// @param sock             Unet socket
+/// @param protocol         Protocol number to use for the transfer
+/// @param id               Transfer identifier, shared with the receivers
+/// @param data             Data to send across
+/// @param len              Number of bytes in the data
+/// @param k                Data chunks per block, or 0 for XFER_FEC_K
+/// @param m                Parity chunks per block, or -1 for XFER_FEC_M
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_xfer_broadcast_buffer(unetsocket_t sock, int protocol, uint32_t id, const uint8_t *data, size_t len, int k, int m);
+
+/// Broadcast a file using forward erasure coding.
+/// See unetsocket_xfer_broadcast().
+///
+/// @param sock             Unet socket
+/// @param protocol         Protocol number to use for the transfer
+/// @param id               Transfer identifier, shared with the receivers
+/// @param filename         File to send
+/// @param k                Data chunks per block, or 0 for XFER_FEC_K
+/// @param m                Parity chunks per block, or -1 for XFER_FEC_M
+/// @return                 0 on success, -1 otherwise
+
+int unetsocket_xfer_broadcast_file(unetsocket_t sock, int protocol, uint32_t id, const char *filename, int k, int m);
+
+/// Create a bulk transfer receiver writing to a user supplied sink.
+///
+/// @param write            Data sink
+/// @param ctx              Context passed to the data sink
+/// @return                 Receiver, or NULL on error
+
+unet_xfer_rx_t unet_xfer_rx_open(unet_xfer_write_t write, void *ctx);
+
+/// Create a bulk transfer receiver writing to a file. If a partially received
+/// file and its state file (filename with ".xfer" appended) exist, the transfer
+/// is resumed from where it stopped. The state file is kept up to date while
+/// the transfer is incomplete, and removed once it completes.
+///
+/// @param filename         File to write
+/// @return                 Receiver, or NULL on error
+
+unet_xfer_rx_t unet_xfer_rx_open_file(const char *filename);
+
+/// Close a bulk transfer receiver.
+///
+/// @param rx               Receiver
+
+void unet_xfer_rx_close(unet_xfer_rx_t rx);
+
+/// Receive a bulk transfer sent with unetsocket_xfer_send() or
+/// unetsocket_xfer_broadcast(). The call returns once the transfer is complete,
+/// or when no transfer datagram has been received for timeout ms. An incomplete
+/// transfer is resumed by calling this function again with the same receiver.
+/// After an ARQ transfer completes, retransmissions are acknowledged until none
+/// has been received for XFER_LINGER ms.
+///
+/// The socket must be unbound or bound to the transfer protocol, and the call
+/// consumes all datagrams received on that protocol while it runs.
+///
+/// @param sock             Unet socket
+/// @param rx               Receiver
+/// @param protocol         Protocol number used for the transfer
+/// @param timeout          Timeout in milliseconds
+/// @return                 0 on completion, -1 otherwise
+
+int unetsocket_xfer_receive(unetsocket_t sock, unet_xfer_rx_t rx, int protocol, long timeout);
+
+/// Get the progress of a bulk transfer.
+///
+/// @param rx               Receiver
+/// @param id               Transfer identifier (may be NULL)
+/// @param size             Size of the object in bytes (may be NULL)
+/// @param received         Bytes received so far (may be NULL)
+/// @return                 0 if a transfer is in progress or complete, -1 otherwise
+
+int unet_xfer_rx_status(unet_xfer_rx_t rx, uint32_t *id, unsigned long long *size, unsigned long long *received);
+
+/// Save the state of a bulk transfer receiver, so that the transfer can be
+/// resumed after a restart using unet_xfer_rx_load().
+///
+/// @param rx               Receiver
+/// @param filename         State file
+/// @return                 0 on success, -1 otherwise
+
+int unet_xfer_rx_save(unet_xfer_rx_t rx, const char *filename);
+
+/// Restore the state of a bulk transfer receiver saved with unet_xfer_rx_save().
+///
+/// @param rx               Receiver
+/// @param filename         State file
+/// @return                 0 on success, -1 otherwise
+
+int unet_xfer_rx_load(unet_xfer_rx_t rx, const char *filename);
+
+#endif